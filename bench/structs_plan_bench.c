@@ -0,0 +1,345 @@
+/*******************************************************************************
+ * HEADERS
+ ******************************************************************************/
+
+/*
+ * Benchmark of structure execution plans against recursive method
+ * dispatch, on a nested configuration type.
+ *
+ * Each type is described twice: once with the standard structure
+ * methods, which are compiled into execution plans, and once with an
+ * "init" method of its own, which keeps the library from compiling a
+ * plan so that every operation recurses through the field methods.
+ * Both versions have identical layouts and contents.
+ *
+ * Build by compiling this file together with the library sources, e.g.:
+ *
+ *	cc -O2 -I../src -o structs_plan_bench structs_plan_bench.c \
+ *	    ../src/structs*.c -lexpat -lpthread
+ *
+ * Usage: structs_plan_bench [iterations]
+ */
+
+/* Standard Includes */
+#include <sys/types.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+/* Module Includes */
+#include "structs.h"
+#include "structs_type_array.h"
+#include "structs_type_int.h"
+#include "structs_type_string.h"
+#include "structs_type_struct.h"
+
+/*******************************************************************************
+ * MACROS/VARIABLES
+ ******************************************************************************/
+
+/* Default number of iterations */
+#define BENCH_ITERATIONS	200000
+
+/* Same as STRUCTS_STRUCT_TYPE(), but without an execution plan */
+#define BENCH_RECURSIVE_TYPE(sname, flist) {			\
+		sizeof(struct sname),                           \
+			"structure",				\
+			STRUCTS_TYPE_STRUCTURE,			\
+			bench_struct_init,			\
+			structs_struct_copy,			\
+			structs_struct_equal,			\
+			structs_notsupp_ascify,			\
+			structs_notsupp_binify,			\
+			structs_struct_encode,			\
+			structs_struct_decode,			\
+			structs_struct_free,			\
+		{ { (void *)(flist) }, { NULL }, { NULL } },	\
+			NULL,					\
+			NULL,					\
+			structs_struct_compare,			\
+			structs_struct_hash,			\
+			structs_struct_encode_into		\
+	}
+
+static structs_init_t bench_struct_init;
+
+/* The configuration */
+struct limits {
+	u_int32_t max_conn;
+	u_int32_t max_rate;
+	int32_t backlog;
+	int16_t retries;
+	u_int8_t flags;
+};
+
+struct endpoint {
+	char *host;
+	u_int16_t port;
+	struct limits limits;
+	char *cert;
+	int32_t timeout;
+};
+
+DEFINE_STRUCTS_ARRAY(bench_tags, char *);
+
+struct config {
+	char *name;
+	struct endpoint listen;
+	struct endpoint upstream;
+	struct bench_tags tags;
+	u_int32_t workers;
+	char *log_file;
+	struct limits global;
+};
+
+/* Field lists, used by both versions of each type */
+#define BENCH_LIMITS_FIELDS(prefix)					\
+static const struct structs_field prefix ## _limits_fields[] = {	\
+	STRUCTS_STRUCT_FIELD(limits, max_conn, &structs_type_uint32),	\
+	STRUCTS_STRUCT_FIELD(limits, max_rate, &structs_type_uint32),	\
+	STRUCTS_STRUCT_FIELD(limits, backlog, &structs_type_int32),	\
+	STRUCTS_STRUCT_FIELD(limits, retries, &structs_type_int16),	\
+	STRUCTS_STRUCT_FIELD(limits, flags, &structs_type_uint8),	\
+	STRUCTS_STRUCT_FIELD_END					\
+}
+
+#define BENCH_ENDPOINT_FIELDS(prefix)					\
+static const struct structs_field prefix ## _endpoint_fields[] = {	\
+	STRUCTS_STRUCT_FIELD(endpoint, host, &structs_type_string),	\
+	STRUCTS_STRUCT_FIELD(endpoint, port, &structs_type_uint16),	\
+	STRUCTS_STRUCT_FIELD(endpoint, limits, &prefix ## _limits_type),\
+	STRUCTS_STRUCT_FIELD(endpoint, cert, &structs_type_string),	\
+	STRUCTS_STRUCT_FIELD(endpoint, timeout, &structs_type_int32),	\
+	STRUCTS_STRUCT_FIELD_END					\
+}
+
+#define BENCH_CONFIG_FIELDS(prefix)					\
+static const struct structs_field prefix ## _config_fields[] = {	\
+	STRUCTS_STRUCT_FIELD(config, name, &structs_type_string),	\
+	STRUCTS_STRUCT_FIELD(config, listen, &prefix ## _endpoint_type),\
+	STRUCTS_STRUCT_FIELD(config, upstream, &prefix ## _endpoint_type),\
+	STRUCTS_STRUCT_FIELD(config, tags, &bench_tags_type),		\
+	STRUCTS_STRUCT_FIELD(config, workers, &structs_type_uint32),	\
+	STRUCTS_STRUCT_FIELD(config, log_file, &structs_type_string),	\
+	STRUCTS_STRUCT_FIELD(config, global, &prefix ## _limits_type),	\
+	STRUCTS_STRUCT_FIELD_END					\
+}
+
+static const struct structs_type bench_tags_type =
+	STRUCTS_ARRAY_TYPE(&structs_type_string, "tag");
+
+/* Versions with execution plans */
+BENCH_LIMITS_FIELDS(plan);
+static const struct structs_type plan_limits_type =
+	STRUCTS_STRUCT_TYPE(limits, &plan_limits_fields);
+BENCH_ENDPOINT_FIELDS(plan);
+static const struct structs_type plan_endpoint_type =
+	STRUCTS_STRUCT_TYPE(endpoint, &plan_endpoint_fields);
+BENCH_CONFIG_FIELDS(plan);
+static const struct structs_type plan_config_type =
+	STRUCTS_STRUCT_TYPE(config, &plan_config_fields);
+
+/* Versions using recursive dispatch */
+BENCH_LIMITS_FIELDS(rec);
+static const struct structs_type rec_limits_type =
+	BENCH_RECURSIVE_TYPE(limits, &rec_limits_fields);
+BENCH_ENDPOINT_FIELDS(rec);
+static const struct structs_type rec_endpoint_type =
+	BENCH_RECURSIVE_TYPE(endpoint, &rec_endpoint_fields);
+BENCH_CONFIG_FIELDS(rec);
+static const struct structs_type rec_config_type =
+	BENCH_RECURSIVE_TYPE(config, &rec_config_fields);
+
+/* Values to fill in */
+static const char *const bench_values[][2] = {
+	{ "name",			"frontend" },
+	{ "listen.host",		"0.0.0.0" },
+	{ "listen.port",		"443" },
+	{ "listen.limits.max_conn",	"10000" },
+	{ "listen.limits.backlog",	"512" },
+	{ "listen.cert",		"/etc/ssl/frontend.pem" },
+	{ "listen.timeout",		"30" },
+	{ "upstream.host",		"backend.example.com" },
+	{ "upstream.port",		"8080" },
+	{ "upstream.limits.max_rate",	"2500" },
+	{ "upstream.limits.retries",	"3" },
+	{ "upstream.timeout",		"5" },
+	{ "workers",			"8" },
+	{ "log_file",			"/var/log/frontend.log" },
+	{ "global.max_conn",		"50000" },
+	{ "global.flags",		"7" },
+};
+
+/* Operations timed */
+enum bench_op {
+	BENCH_INIT_FREE,
+	BENCH_COPY_FREE,
+	BENCH_EQUAL,
+	BENCH_MAX
+};
+
+static const char *const bench_op_names[BENCH_MAX] = {
+	"init+free",
+	"copy+free",
+	"equal",
+};
+
+/*******************************************************************************
+ * FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+static void bench_fill(const struct structs_type *type, void *data);
+static double bench_run(const struct structs_type *type, const void *data,
+			enum bench_op op, unsigned long iterations);
+static double bench_now(void);
+
+/*******************************************************************************
+ * FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+int main(int argc, char **argv)
+{
+	struct config plan_cfg;
+	struct config rec_cfg;
+	unsigned long iterations = BENCH_ITERATIONS;
+	double plan_ns;
+	double rec_ns;
+	int op;
+
+	if (argc > 1 && (iterations = strtoul(argv[1], NULL, 10)) == 0) {
+		fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+		return (1);
+	}
+
+	/* Build identical configurations */
+	bench_fill(&plan_config_type, &plan_cfg);
+	bench_fill(&rec_config_type, &rec_cfg);
+
+	/* Time each operation both ways */
+	printf("%-10s %16s %16s %8s\n", "operation", "plan ns/op",
+	       "recursive ns/op", "speedup");
+	for (op = 0; op < BENCH_MAX; op++) {
+		plan_ns = bench_run(&plan_config_type, &plan_cfg, op,
+				    iterations);
+		rec_ns = bench_run(&rec_config_type, &rec_cfg, op, iterations);
+		printf("%-10s %16.1f %16.1f %7.2fx\n", bench_op_names[op],
+		       plan_ns, rec_ns, rec_ns / plan_ns);
+	}
+
+	/* Done */
+	structs_free(&plan_config_type, NULL, &plan_cfg);
+	structs_free(&rec_config_type, NULL, &rec_cfg);
+	return (0);
+}
+
+/*
+ * Structure "init" method that is not structs_struct_init(), so the
+ * type gets no execution plan.
+ */
+static int bench_struct_init(const struct structs_type *type, void *data)
+{
+	return (structs_struct_init(type, data));
+}
+
+/*
+ * Initialize a configuration and fill in its values.
+ */
+static void bench_fill(const struct structs_type *type, void *data)
+{
+	char ebuf[128];
+	unsigned int i;
+
+	if (structs_init(type, NULL, data) == -1) {
+		perror("structs_init");
+		exit(1);
+	}
+	for (i = 0; i < sizeof(bench_values) / sizeof(*bench_values); i++) {
+		if (structs_set_string(type, bench_values[i][0],
+				       bench_values[i][1], data,
+				       ebuf, sizeof(ebuf)) == -1) {
+			fprintf(stderr, "%s: %s\n", bench_values[i][0], ebuf);
+			exit(1);
+		}
+	}
+	for (i = 0; i < 4; i++) {
+		char name[32];
+
+		snprintf(name, sizeof(name), "tags.%u", i);
+		if (structs_array_insert(type, "tags", i, data) == -1
+		    || structs_set_string(type, name, "tag", data,
+					  ebuf, sizeof(ebuf)) == -1) {
+			perror("tags");
+			exit(1);
+		}
+	}
+}
+
+/*
+ * Run an operation "iterations" times and return nanoseconds per run.
+ */
+static double bench_run(const struct structs_type *type, const void *data,
+			enum bench_op op, unsigned long iterations)
+{
+	struct config temp;
+	unsigned long equal = 0;
+	unsigned long i;
+	double elapsed;
+	double start;
+
+	/* Compare against a separate but equal instance */
+	if (op == BENCH_EQUAL && structs_get(type, NULL, data, &temp) == -1)
+		goto fail;
+
+	start = bench_now();
+	for (i = 0; i < iterations; i++) {
+		switch (op) {
+		case BENCH_INIT_FREE:
+			if (structs_init(type, NULL, &temp) == -1)
+				goto fail;
+			structs_free(type, NULL, &temp);
+			break;
+		case BENCH_COPY_FREE:
+			if (structs_get(type, NULL, data, &temp) == -1)
+				goto fail;
+			structs_free(type, NULL, &temp);
+			break;
+		case BENCH_EQUAL:
+			equal += structs_equal(type, NULL, data, &temp);
+			break;
+		default:
+			break;
+		}
+	}
+	elapsed = bench_now() - start;
+	if (op == BENCH_EQUAL) {
+		structs_free(type, NULL, &temp);
+		if (equal != iterations) {
+			fprintf(stderr, "instances differ\n");
+			exit(1);
+		}
+	}
+	return (elapsed * 1e9 / iterations);
+
+fail:
+	perror(bench_op_names[op]);
+	exit(1);
+}
+
+/*
+ * Get the current time in seconds.
+ */
+static double bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+/*******************************************************************************
+ * END OF FILE
+ ******************************************************************************/
@@ -4,6 +4,7 @@
 
 /* Standard Includes */
 #include <sys/types.h>
+#include <sys/param.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
@@ -14,18 +15,23 @@
 
 /* Module Includes */
 #include "structs.h"
+#include "structs_alloc.h"
 #include "structs_type_int.h"
 #include "structs_type_array.h"
 #include "structs_type_string.h"
 #include "structs_type_struct.h"
 #include "structs_type_union.h"
+#include "structs_internal.h"
 
 /*******************************************************************************
  * MACROS/VARIABLES
  ******************************************************************************/
 
+/* Items up to this size are reset or moved without allocating a temporary */
+#define STRUCTS_RESET_BUFSIZE	256
+
 /* Special handling for array length as a read-only field */
-static const struct structs_type structs_type_array_length = {
+const struct structs_type structs_type_array_length = {
 	sizeof(unsigned int),
 	"uint",
 	STRUCTS_TYPE_PRIMITIVE,
@@ -37,11 +43,16 @@ static const struct structs_type structs_type_array_length = {
 	structs_region_encode_netorder,
 	structs_notsupp_decode,
 	structs_nothing_free,
-	{ { (void *)2}, { (void *)0} }	/* args for structs_int_ascify */
+	{ { (void *)2}, { (void *)0} },	/* args for structs_int_ascify */
+	structs_int_ascify_into,
+	NULL,
+	structs_int_compare,
+	structs_region_hash,
+	structs_region_encode_netorder_into
 };
 
 /* Special handling for union field name as a read-only field */
-static const struct structs_type structs_type_union_field_name = {
+const struct structs_type structs_type_union_field_name = {
 	sizeof(char *),
 	"string",
 	STRUCTS_TYPE_PRIMITIVE,
@@ -54,7 +65,12 @@ static const struct structs_type structs_type_union_field_name = {
 	structs_notsupp_decode,
 	structs_nothing_free,
 	{ { (void *)"union field_name"},	/* args for structs_type_string */
-	 { (void *)0} }
+	 { (void *)0} },
+	structs_string_ascify_into,
+	NULL,
+	structs_string_compare,
+	structs_string_hash,
+	NULL
 };
 
 /*******************************************************************************
@@ -71,7 +87,8 @@ static const struct structs_type structs_type_union_field_name = {
 int structs_init(const struct structs_type *type, const char *name, void *data)
 {
 	/* Find item */
-	if ((type = structs_find(type, name, (const void **)&data, 0)) == NULL)
+	if ((type = structs_find_flags(type, name, (const void **)&data,
+				       STRUCTS_FIND_UNSHARE)) == NULL)
 		return (-1);
 
 	/* Initialize it */
@@ -83,25 +100,43 @@ int structs_init(const struct structs_type *type, const char *name, void *data)
  */
 int structs_reset(const struct structs_type *type, const char *name, void *data)
 {
+	union {
+		char buf[STRUCTS_RESET_BUFSIZE];
+		void *ptr;		/* for alignment */
+		long double ld;		/* for alignment */
+	} local;
+	const void *dflt;
 	void *temp;
 
 	/* Find item */
-	if ((type = structs_find(type, name, (const void **)&data, 0)) == NULL)
+	if ((type = structs_find_flags(type, name, (const void **)&data,
+				       STRUCTS_FIND_UNSHARE)) == NULL)
 		return (-1);
 
-	/* Make a temporary new copy */
-	if ((temp = calloc(1, type->size)) == NULL)
+	/* Plain memory just gets zeroed */
+	if ((structs_pod_flags(type) & STRUCTS_POD_INIT) != 0) {
+		memset(data, 0, type->size);
+		return (0);
+	}
+
+	/* Make a temporary copy of the default value */
+	if ((dflt = structs_default(type)) == NULL)
 		return (-1);
-	memset(temp, 0, type->size);
-	if ((*type->init) (type, temp) == -1) {
-		free(temp);
+	if (type->size <= sizeof(local.buf))
+		temp = local.buf;
+	else if ((temp = structs_mem_calloc(1, type->size)) == NULL)
+		return (-1);
+	if ((*type->copy) (type, dflt, temp) == -1) {
+		if (temp != local.buf)
+			structs_mem_free(temp);
 		return (-1);
 	}
 
 	/* Replace existing item, freeing it first */
 	(*type->uninit) (type, data);
 	memcpy(data, temp, type->size);
-	free(temp);
+	if (temp != local.buf)
+		structs_mem_free(temp);
 	return (0);
 }
 
@@ -115,7 +150,8 @@ int structs_free(const struct structs_type *type, const char *name, void *data)
 	const int errno_save = errno;
 
 	/* Find item */
-	if ((type = structs_find(type, name, (const void **)&data, 0)) == NULL)
+	if ((type = structs_find_flags(type, name, (const void **)&data,
+				       STRUCTS_FIND_UNSHARE)) == NULL)
 		return (-1);
 
 	/* Free it */
@@ -163,14 +199,15 @@ int structs_set(const struct structs_type *type,
 	void *copy;
 
 	/* Find item */
-	if ((type = structs_find(type, name, (const void **)&to, 0)) == NULL)
+	if ((type = structs_find_flags(type, name, (const void **)&to,
+				       STRUCTS_FIND_UNSHARE)) == NULL)
 		return (-1);
 
 	/* Make a new copy of 'from' */
-	if ((copy = calloc(1, type->size)) == NULL)
+	if ((copy = structs_mem_calloc(1, type->size)) == NULL)
 		return (-1);
 	if ((*type->copy) (type, from, copy) == -1) {
-		free(copy);
+		structs_mem_free(copy);
 		return (-1);
 	}
 
@@ -181,7 +218,95 @@ int structs_set(const struct structs_type *type,
 	memcpy(to, copy, type->size);
 
 	/* Done */
-	free(copy);
+	structs_mem_free(copy);
+	return (0);
+}
+
+/*
+ * Move an item into a structure.
+ *
+ * If "name" is NULL or empty string, the entire structure is moved.
+ *
+ * It is assumed that "from" and "to" are both initialized. "from"
+ * is left in its initialized state.
+ *
+ * Note: "name" is only applied to "to". The structs types of
+ * "from" and "to.<name>" must be the same.
+ */
+int structs_move(const struct structs_type *type,
+		 void *from, const char *name, void *to)
+{
+	union {
+		char buf[STRUCTS_RESET_BUFSIZE];
+		void *ptr;		/* for alignment */
+		long double ld;		/* for alignment */
+	} local;
+	char *temp;
+
+	/* Find item */
+	if ((type = structs_find_flags(type, name, (const void **)&to,
+				       STRUCTS_FIND_UNSHARE)) == NULL)
+		return (-1);
+	if (from == to)
+		return (0);
+
+	/* Get room for a new item and for 'from' */
+	if (2 * type->size <= sizeof(local.buf))
+		temp = local.buf;
+	else if ((temp = structs_mem_malloc(2 * type->size)) == NULL)
+		return (-1);
+
+	/* Initialize the item that will replace 'from' */
+	if ((structs_pod_flags(type) & STRUCTS_POD_INIT) != 0)
+		memset(temp, 0, type->size);
+	else if ((*type->init) (type, temp) == -1) {
+		if (temp != local.buf)
+			structs_mem_free(temp);
+		return (-1);
+	}
+
+	/*
+	 * Take 'from' out before freeing the overwritten item in 'to',
+	 * in case 'from' is part of it, then move it into place.
+	 */
+	memcpy(temp + type->size, from, type->size);
+	memcpy(from, temp, type->size);
+	(*type->uninit) (type, to);
+	memcpy(to, temp + type->size, type->size);
+
+	/* Done */
+	if (temp != local.buf)
+		structs_mem_free(temp);
+	return (0);
+}
+
+/*
+ * Swap an item in a structure with another.
+ *
+ * If "name" is NULL or empty string, the entire structure is swapped.
+ *
+ * Note: "name" is only applied to "a". The structs types of
+ * "a.<name>" and "b" must be the same.
+ */
+int structs_swap(const struct structs_type *type,
+		 const char *name, void *a, void *b)
+{
+	char buf[STRUCTS_RESET_BUFSIZE];
+	size_t off;
+	size_t len;
+
+	/* Find item */
+	if ((type = structs_find_flags(type, name, (const void **)&a,
+				       STRUCTS_FIND_UNSHARE)) == NULL)
+		return (-1);
+
+	/* Swap them a piece at a time */
+	for (off = 0; off < type->size; off += len) {
+		len = MIN(type->size - off, sizeof(buf));
+		memcpy(buf, (char *)a + off, len);
+		memcpy((char *)a + off, (char *)b + off, len);
+		memcpy((char *)b + off, buf, len);
+	}
 	return (0);
 }
 
@@ -199,6 +324,135 @@ char *structs_get_string(const struct structs_type *type,
 	return ((*type->ascify) (type, data));
 }
 
+/*
+ * Get the ASCII form of an item into a buffer.
+ */
+int structs_get_string_buf(const struct structs_type *type,
+			   const char *name, const void *data,
+			   char *buf, size_t bufmax)
+{
+	/* Find item */
+	if ((type = structs_find(type, name, (const void **)&data, 0)) == NULL)
+		return (-1);
+
+	/* Ascify it */
+	return (structs_ascify_into(type, data, buf, bufmax));
+}
+
+/*
+ * Ascify an item into a buffer, using the "ascify" method if
+ * the type has no "ascify_into" method.
+ */
+int structs_ascify_into(const struct structs_type *type,
+			const void *data, char *buf, size_t bufmax)
+{
+	char *ascii;
+	int len;
+
+	if (type->ascify_into != NULL)
+		return ((*type->ascify_into) (type, data, buf, bufmax));
+	if ((ascii = (*type->ascify) (type, data)) == NULL)
+		return (-1);
+	len = snprintf(buf, bufmax, "%s", ascii);
+	structs_mem_free(ascii);
+	return (len);
+}
+
+/*
+ * Encode an item into an encoder, using the "encode" method if
+ * the type has no "encode_into" method.
+ */
+int structs_encode_into(const struct structs_type *type,
+			struct structs_encoder *enc, const void *data)
+{
+	struct structs_data code;
+	int r;
+
+	if (type->encode_into != NULL)
+		return ((*type->encode_into) (type, enc, data));
+	if ((*type->encode) (type, &code, data) == -1)
+		return (-1);
+	r = structs_encoder_append(enc, code.data, code.length);
+	structs_mem_free(code.data);
+	return (r);
+}
+
+/*
+ * Compare two items, using their binary encodings if the type
+ * has no "compare" method.
+ */
+int structs_compare_item(const struct structs_type *type,
+			 const void *data1, const void *data2)
+{
+	struct structs_data code1;
+	struct structs_data code2;
+	int r;
+
+	if (type->compare != NULL)
+		return ((*type->compare) (type, data1, data2));
+	if ((*type->encode) (type, &code1, data1) == -1)
+		return (0);
+	if ((*type->encode) (type, &code2, data2) == -1) {
+		structs_mem_free(code1.data);
+		return (0);
+	}
+	if ((r = memcmp(code1.data, code2.data,
+			MIN(code1.length, code2.length))) == 0)
+		r = (code1.length > code2.length)
+		    - (code1.length < code2.length);
+	structs_mem_free(code1.data);
+	structs_mem_free(code2.data);
+	return (r);
+}
+
+/*
+ * Hash an item, using its binary encoding if the type
+ * has no "hash" method.
+ */
+uint64_t structs_hash_item(const struct structs_type *type, const void *data)
+{
+	struct structs_data code;
+	uint64_t hash;
+
+	if (type->hash != NULL)
+		return ((*type->hash) (type, data));
+	if ((*type->encode) (type, &code, data) == -1)
+		return (0);
+	hash = structs_hash_bytes(STRUCTS_HASH_INIT, code.data, code.length);
+	structs_mem_free(code.data);
+	return (hash);
+}
+
+/*
+ * Ascify an item into "buf" if it fits, otherwise into an allocated
+ * buffer. The caller must free the result if it is not "buf".
+ */
+char *structs_ascify_buf(const struct structs_type *type,
+			 const void *data, char *buf, size_t bufmax)
+{
+	char *mem = NULL;
+	char *s = buf;
+	size_t size = bufmax;
+	int len;
+
+	/* Without an "ascify_into" method, just use "ascify" */
+	if (type->ascify_into == NULL)
+		return ((*type->ascify) (type, data));
+
+	/* Try the caller's buffer first, then allocate one big enough */
+	while ((len = (*type->ascify_into) (type, data, s, size)) != -1) {
+		if ((size_t)len < size)
+			return (s);
+		structs_mem_free(mem);
+		size = len + 1;
+		if ((mem = structs_mem_malloc(size)) == NULL)
+			return (NULL);
+		s = mem;
+	}
+	structs_mem_free(mem);
+	return (NULL);
+}
+
 /*
  * Set an item's value from a string.
  *
@@ -224,17 +478,19 @@ int structs_set_string(const struct structs_type *type, const char *name,
 		*ebuf = '\0';
 
 	/* Find item */
-	if ((type = structs_find(type, name, (const void **)&data, 1)) == NULL) {
+	if ((type = structs_find_flags(type, name, (const void **)&data,
+				       STRUCTS_FIND_UNION
+				       | STRUCTS_FIND_UNSHARE)) == NULL) {
 		strncpy(ebuf, strerror(errno), emax);
 		return (-1);
 	}
 
 	/* Binify item into temporary storage */
-	if ((temp = calloc(1, type->size)) == NULL)
+	if ((temp = structs_mem_calloc(1, type->size)) == NULL)
 		return (-1);
 	memset(temp, 0, type->size);
 	if ((*type->binify) (type, ascii, temp, ebuf, emax) == -1) {
-		free(temp);
+		structs_mem_free(temp);
 		if (emax > 0 && *ebuf == '\0')
 			strncpy(ebuf, strerror(errno), emax);
 		return (-1);
@@ -243,7 +499,7 @@ int structs_set_string(const struct structs_type *type, const char *name,
 	/* Replace existing item, freeing it first */
 	(*type->uninit) (type, data);
 	memcpy(data, temp, type->size);
-	free(temp);
+	structs_mem_free(temp);
 	return (0);
 }
 
@@ -260,7 +516,7 @@ int structs_get_binary(const struct structs_type *type, const char *name,
 	}
 
 	/* Encode it */
-	if ((*type->encode) (type, code, data) == -1) {
+	if (structs_encoder_encode(type, code, data) == -1) {
 		memset(code, 0, sizeof(*code));
 		return (-1);
 	}
@@ -284,18 +540,19 @@ int structs_set_binary(const struct structs_type *type, const char *name,
 		*ebuf = '\0';
 
 	/* Find item */
-	if ((type = structs_find(type, name, (const void **)&data, 0)) == NULL) {
+	if ((type = structs_find_flags(type, name, (const void **)&data,
+				       STRUCTS_FIND_UNSHARE)) == NULL) {
 		strncpy(ebuf, strerror(errno), emax);
 		return (-1);
 	}
 
 	/* Decode item into temporary storage */
-	if ((temp = calloc(1, type->size)) == NULL)
+	if ((temp = structs_mem_calloc(1, type->size)) == NULL)
 		return (-1);
 	memset(temp, 0, type->size);
 	if ((clen = (*type->decode) (type, code->data,
 				     code->length, temp, ebuf, emax)) == -1) {
-		free(temp);
+		structs_mem_free(temp);
 		if (emax > 0 && *ebuf == '\0')
 			strncpy(ebuf, strerror(errno), emax);
 		return (-1);
@@ -305,7 +562,7 @@ int structs_set_binary(const struct structs_type *type, const char *name,
 	/* Replace existing item, freeing it first */
 	(*type->uninit) (type, data);
 	memcpy(data, temp, type->size);
-	free(temp);
+	structs_mem_free(temp);
 
 	/* Done */
 	return (clen);
@@ -327,12 +584,53 @@ int structs_equal(const struct structs_type *type,
 	return ((*type->equal) (type, data1, data2));
 }
 
+/*
+ * Compare two structures for ordering.
+ */
+int structs_compare(const struct structs_type *type,
+		    const char *name, const void *data1, const void *data2)
+{
+	/* Find items */
+	if (structs_find(type, name, (const void **)&data1, 0) == NULL)
+		return (0);
+	if ((type = structs_find(type, name, (const void **)&data2, 0)) == NULL)
+		return (0);
+
+	/* Compare them */
+	return (structs_compare_item(type, data1, data2));
+}
+
+/*
+ * Hash a structure.
+ */
+uint64_t structs_hash(const struct structs_type *type,
+		      const char *name, const void *data)
+{
+	/* Find item */
+	if ((type = structs_find(type, name, (const void **)&data, 0)) == NULL)
+		return (0);
+
+	/* Hash it */
+	return (structs_hash_item(type, data));
+}
+
 /*
  * Find an item in a structure.
  */
 const struct structs_type *structs_find(const struct structs_type *type,
 					const char *name, const void **datap,
 					int set_union)
+{
+	return (structs_find_flags(type, name, datap,
+				   set_union ? STRUCTS_FIND_UNION : 0));
+}
+
+/*
+ * Find an item in a structure, with STRUCTS_FIND_* flags.
+ */
+const struct structs_type *structs_find_flags(const struct structs_type *type,
+					      const char *name,
+					      const void **datap, int flags)
 {
 	const void *data = *datap;
 	const char *next;
@@ -347,8 +645,11 @@ const struct structs_type *structs_find(const struct structs_type *type,
 		return (NULL);
 	}
 
-	/* Dereference through pointer(s) */
+	/* Dereference through pointer(s), unsharing them if asked */
 	while (type->tclass == STRUCTS_TYPE_POINTER) {
+		if ((flags & STRUCTS_FIND_UNSHARE) != 0
+		    && structs_cow_pointer_unshare(type, (void *)data) == -1)
+			return (NULL);
 		type = type->args[0].v;
 		data = *((void **)data);
 	}
@@ -400,8 +701,8 @@ const struct structs_type *structs_find(const struct structs_type *type,
 
 			/* Special handling for "length" */
 			if (strcmp(name, "length") == 0) {
-				type = &structs_type_array_length;
 				data = (void *)&type->args[2].i;
+				type = &structs_type_array_length;
 				break;
 			}
 
@@ -424,25 +725,12 @@ const struct structs_type *structs_find(const struct structs_type *type,
 	case STRUCTS_TYPE_STRUCTURE:
 		{
 			const struct structs_field *field;
+			int i;
 
 			/* Find the field */
-			for (field = type->args[0].v; field->name != NULL;
-			     field++) {
-				const size_t fnlen = strlen(field->name);
-
-				/* Handle field names with separator in them */
-				if (strncmp(name, field->name, fnlen) == 0
-				    && (name[fnlen] == '\0'
-					|| name[fnlen] == STRUCTS_SEPARATOR)) {
-					next = (name[fnlen] != '\0') ?
-					    name + fnlen + 1 : NULL;
-					break;
-				}
-			}
-			if (field->name == NULL) {
-				errno = ENOENT;
+			if ((i = structs_field_find(type, name, &next)) == -1)
 				return (NULL);
-			}
+			field = (const struct structs_field *)type->args[0].v + i;
 			type = field->type;
 			data = (char *)data + field->offset;
 			break;
@@ -451,97 +739,76 @@ const struct structs_type *structs_find(const struct structs_type *type,
 		{
 			const struct structs_ufield *const fields =
 			    type->args[0].v;
-			struct structs_union *const un = (void *)data;
-			const size_t oflen = strlen(un->field_name);
 			const struct structs_ufield *ofield;
 			const struct structs_ufield *field;
+			structs_union_buf_t ubuf;
+			size_t oflen;
 			void *new_un;
 			void *data2;
+			int i;
 
 			/* Special handling for "field_name" */
 			if (strcmp(name, "field_name") == 0) {
+				if ((data = (void *)structs_union_namep(type,
+				    data)) == NULL)
+					return (NULL);
 				type = &structs_type_union_field_name;
-				data = (void *)&un->field_name;
 				break;
 			}
 
 			/* Find the old field */
-			for (ofield = fields; ofield->name != NULL; ofield++) {
-				if (strcmp(ofield->name, un->field_name) == 0)
-					break;
-			}
-			if (ofield->name == NULL) {
-				assert(0);
-				errno = EINVAL;
+			if ((ofield = structs_union_field(type, data)) == NULL)
 				return (NULL);
-			}
+			oflen = strlen(ofield->name);
 
 			/*
 			 * Check if the union is already set to the desired field,
 			 * handling field names with the separator char in them.
 			 */
-			if (strncmp(name, un->field_name, oflen) == 0
+			if (strncmp(name, ofield->name, oflen) == 0
 			    && (name[oflen] == '\0'
 				|| name[oflen] == STRUCTS_SEPARATOR)) {
 				next =
 				    (name[oflen] !=
 				     '\0') ? name + oflen + 1 : NULL;
 				field = ofield;
+				data = structs_union_body(type, data);
 				goto union_done;
 			}
 
 			/* Is modifying the union to get the right name acceptable? */
-			if (!set_union) {
+			if ((flags & STRUCTS_FIND_UNION) == 0) {
 				errno = ENOENT;
 				return (NULL);
 			}
 
 			/* Find the new field */
-			for (field = fields; field->name != NULL; field++) {
-				const size_t fnlen = strlen(field->name);
-
-				/* Handle field names with separator in them */
-				if (strncmp(name, field->name, fnlen) == 0
-				    && (name[fnlen] == '\0'
-					|| name[fnlen] == STRUCTS_SEPARATOR)) {
-					next = (name[fnlen] != '\0') ?
-					    name + fnlen + 1 : NULL;
-					break;
-				}
-			}
-			if (field->name == NULL) {
-				errno = ENOENT;
+			if ((i = structs_field_find(type, name, &next)) == -1)
 				return (NULL);
-			}
+			field = fields + i;
 
 			/* Create a new union with the new field type */
-			if ((new_un = calloc(1, field->type->size)) == NULL)
+			if ((new_un = structs_union_new(type, field,
+							&ubuf)) == NULL)
 				return (NULL);
-			if ((*field->type->init) (field->type, new_un) == -1) {
-				free(new_un);
-				return (NULL);
-			}
 
 			/* See if name would be found with new union instead of old */
 			data2 = new_un;
 			if (next != NULL
-			    && structs_find(field->type, next,
-					    (const void **)&data2, 1) == NULL) {
-				(*field->type->uninit) (field->type, new_un);
-				free(new_un);
+			    && structs_find_flags(field->type, next,
+						  (const void **)&data2,
+						  STRUCTS_FIND_UNION) == NULL) {
+				structs_union_discard(field, new_un, &ubuf);
 				return (NULL);
 			}
 
 			/* Replace existing union with new one having desired type */
-			(*ofield->type->uninit) (ofield->type, un->un);
-			free(un->un);
-			un->un = new_un;
-			*((const char **)&un->field_name) = field->name;
+			data = structs_union_replace(type, (void *)data,
+						     field, new_un, &ubuf);
 
 union_done:
 			/* Continue recursing */
 			type = field->type;
-			data = un->un;
 			break;
 		}
 	default:
@@ -550,8 +817,8 @@ union_done:
 	}
 
 	/* Recurse on sub-element */
-	if ((type =
-	     structs_find(type, next, (const void **)&data, set_union)) == NULL)
+	if ((type = structs_find_flags(type, next,
+				       (const void **)&data, flags)) == NULL)
 		return (NULL);
 
 	/* Done */
@@ -560,45 +827,53 @@ union_done:
 }
 
 /*
- * Traverse a structure.
+ * Walk a data structure.
  */
 
-struct structs_trav {
-	char **list;
-	unsigned int len;
-	unsigned int alloc;
+struct structs_walk_info {
+	structs_visitor_t *visitor;	/* visitor function */
+	void *arg;		/* visitor argument */
+	char *path;		/* name of the current item */
+	size_t len;		/* length of "path" */
+	size_t alloc;		/* allocated size of "path" */
 };
 
-static int structs_trav(struct structs_trav *t, const char *name,
-			const struct structs_type *type, const void *data);
+static int structs_walk_sub(struct structs_walk_info *w,
+			    const struct structs_type *type, const void *data);
 
-int structs_traverse(const struct structs_type *type,
-		     const void *data, char ***listp)
+int structs_walk(const struct structs_type *type, const void *data,
+		 structs_visitor_t *visitor, void *arg)
 {
-	struct structs_trav t;
-
-	/* Initialize traversal structure */
-	memset(&t, 0, sizeof(t));
-
-	/* Recurse */
-	if (structs_trav(&t, "", type, data) == -1) {
-		while (t.len > 0)
-			free(t.list[--t.len]);
-		free(t.list);
+	struct structs_walk_info w;
+	int r;
+
+	/* Initialize walk info */
+	memset(&w, 0, sizeof(w));
+	w.visitor = visitor;
+	w.arg = arg;
+	w.alloc = 64;
+	if ((w.path = structs_mem_malloc(w.alloc)) == NULL)
 		return (-1);
-	}
+	*w.path = '\0';
 
-	/* Return the result */
-	*listp = t.list;
-	return (t.len);
+	/* Walk */
+	r = structs_walk_sub(&w, type, data);
+
+	/* Done */
+	structs_mem_free(w.path);
+	return (r);
 }
 
-static int structs_trav(struct structs_trav *t, const char *name,
-			const struct structs_type *type, const void *data)
+static int structs_walk_sub(struct structs_walk_info *w,
+			    const struct structs_type *type, const void *data)
 {
-	const char *const dot = (*name == '\0' ? "" : ".");
-	char *ename;
-	int i;
+	const size_t plen = w->len;
+	char nbuf[STRUCTS_INDEX_BUFSIZE];
+	const struct structs_type *etype;
+	const void *edata;
+	const char *ename;
+	unsigned int i;
+	int r;
 
 	/* Dereference through pointer(s) */
 	while (type->tclass == STRUCTS_TYPE_POINTER) {
@@ -606,32 +881,70 @@ static int structs_trav(struct structs_trav *t, const char *name,
 		data = *((void **)data);
 	}
 
-	switch (type->tclass) {
-	case STRUCTS_TYPE_PRIMITIVE:
-		{
-			/* Grow list as necessary */
-			if (t->len == t->alloc) {
-				unsigned int new_alloc;
-				char **new_list;
-
-				new_alloc = (t->alloc + 32) * 2;
-				if ((new_list =
-				     realloc(t->list,
-					     new_alloc * sizeof(*t->list))) ==
-				    NULL)
-					return (-1);
-				t->list = new_list;
-				t->alloc = new_alloc;
-			}
+	/* Visit this item */
+	switch ((*w->visitor) (w->arg, w->path, type, data)) {
+	case STRUCTS_WALK_CONTINUE:
+		break;
+	case STRUCTS_WALK_PRUNE:
+		return (0);
+	case STRUCTS_WALK_STOP:
+		return (1);
+	default:
+		return (-1);
+	}
+
+	/* Visit sub-elements */
+	for (i = 0; (r = structs_child(type, data, i, nbuf, &ename,
+				       &etype, &edata)) == 1; i++) {
+		const size_t elen = strlen(ename);
+
+		/* Append sub-element name to path */
+		if (plen + 1 + elen + 1 > w->alloc) {
+			size_t new_alloc;
+			char *new_path;
 
-			/* Add new name to list */
-			if ((t->list[t->len] = strdup(name)) == NULL)
+			for (new_alloc = w->alloc * 2;
+			     plen + 1 + elen + 1 > new_alloc; new_alloc *= 2) ;
+			if ((new_path = structs_mem_realloc(w->path, new_alloc))
+			    == NULL)
 				return (-1);
-			t->len++;
+			w->path = new_path;
+			w->alloc = new_alloc;
+		}
+		w->len = plen;
+		if (plen > 0)
+			w->path[w->len++] = STRUCTS_SEPARATOR;
+		memcpy(w->path + w->len, ename, elen + 1);
+		w->len += elen;
+
+		/* Recurse, then truncate path back to this item */
+		r = structs_walk_sub(w, etype, edata);
+		w->len = plen;
+		w->path[plen] = '\0';
+		if (r != 0)
+			return (r);
+	}
+	return (r);
+}
 
-			/* Done */
+/*
+ * Get the "index"th sub-element of an item.
+ */
+int structs_child(const struct structs_type *type, const void *data,
+		  unsigned int index, char *nbuf, const char **namep,
+		  const struct structs_type **typep, const void **datap)
+{
+	switch (type->tclass) {
+	case STRUCTS_TYPE_PRIMITIVE:
+		return (0);
+
+	case STRUCTS_TYPE_POINTER:
+		if (index > 0)
 			return (0);
-		}
+		*namep = "";
+		*typep = type->args[0].v;
+		*datap = *((void **)data);
+		return (1);
 
 	case STRUCTS_TYPE_ARRAY:
 		{
@@ -639,23 +952,13 @@ static int structs_trav(struct structs_trav *t, const char *name,
 			    type->args[0].v;
 			const struct structs_array *const ary = data;
 
-			/* Iterate over array elements */
-			for (i = 0; i < ary->length; i++) {
-				const void *const edata
-				    = (char *)ary->elems + (i * etype->size);
-
-				if (asprintf(&ename, "%s%s%d", name, dot, i) ==
-				    -1)
-					return (-1);
-				if (structs_trav(t, ename, etype, edata) == -1) {
-					free(ename);
-					return (-1);
-				}
-				free(ename);
-			}
-
-			/* Done */
-			return (0);
+			if (index >= ary->length)
+				return (0);
+			snprintf(nbuf, STRUCTS_INDEX_BUFSIZE, "%u", index);
+			*namep = nbuf;
+			*typep = etype;
+			*datap = (char *)ary->elems + (index * etype->size);
+			return (1);
 		}
 
 	case STRUCTS_TYPE_FIXEDARRAY:
@@ -664,80 +967,42 @@ static int structs_trav(struct structs_trav *t, const char *name,
 			    type->args[0].v;
 			const unsigned int length = type->args[2].i;
 
-			/* Iterate over array elements */
-			for (i = 0; i < length; i++) {
-				const void *const edata
-				    = (char *)data + (i * etype->size);
-
-				if (asprintf(&ename, "%s%s%d", name, dot, i) ==
-				    -1)
-					return (-1);
-				if (structs_trav(t, ename, etype, edata) == -1) {
-					free(ename);
-					return (-1);
-				}
-				free(ename);
-			}
-
-			/* Done */
-			return (0);
+			if (index >= length)
+				return (0);
+			snprintf(nbuf, STRUCTS_INDEX_BUFSIZE, "%u", index);
+			*namep = nbuf;
+			*typep = etype;
+			*datap = (char *)data + (index * etype->size);
+			return (1);
 		}
 
 	case STRUCTS_TYPE_STRUCTURE:
 		{
-			const struct structs_field *field;
-
-			/* Iterate over structure fields */
-			for (field = type->args[0].v; field->name != NULL;
-			     field++) {
-				const void *const edata =
-				    (char *)data + field->offset;
-
-				if (asprintf
-				    (&ename, "%s%s%s", name, dot,
-				     field->name) == -1)
-					return (-1);
-				if (structs_trav(t, ename, field->type, edata)
-				    == -1) {
-					free(ename);
-					return (-1);
-				}
-				free(ename);
-			}
-
-			/* Done */
-			return (0);
+			const struct structs_field *const field =
+			    (const struct structs_field *)type->args[0].v
+			    + index;
+
+			if (field->name == NULL)
+				return (0);
+			*namep = field->name;
+			*typep = field->type;
+			*datap = (char *)data + field->offset;
+			return (1);
 		}
 
 	case STRUCTS_TYPE_UNION:
 		{
-			const struct structs_ufield *const fields =
-			    type->args[0].v;
-			const struct structs_union *const un = data;
 			const struct structs_ufield *field;
 
-			/* Find field */
-			for (field = fields; field->name != NULL
-			     && strcmp(un->field_name, field->name) != 0;
-			     field++) ;
-			if (field->name == NULL) {
-				assert(0);
-				errno = EINVAL;
-				return (-1);
-			}
-
-			/* Do selected union field */
-			if (asprintf(&ename, "%s%s%s", name, dot, field->name)
-			    == -1)
-				return (-1);
-			if (structs_trav(t, ename, field->type, un->un) == -1) {
-				free(ename);
+			/* Only the selected field is a sub-element */
+			if (index > 0)
+				return (0);
+			if ((field = structs_union_field(type, data)) == NULL)
 				return (-1);
-			}
-			free(ename);
-
-			/* Done */
-			return (0);
+			*namep = field->name;
+			*typep = field->type;
+			*datap = structs_union_body(type, data);
+			return (1);
 		}
 
 	default:
@@ -747,6 +1012,70 @@ static int structs_trav(struct structs_trav *t, const char *name,
 	}
 }
 
+/*
+ * Traverse a structure.
+ */
+
+struct structs_trav {
+	char **list;
+	unsigned int len;
+	unsigned int alloc;
+};
+
+static structs_visitor_t structs_trav;
+
+int structs_traverse(const struct structs_type *type,
+		     const void *data, char ***listp)
+{
+	struct structs_trav t;
+
+	/* Initialize traversal structure */
+	memset(&t, 0, sizeof(t));
+
+	/* Walk, collecting leaf names */
+	if (structs_walk(type, data, structs_trav, &t) == -1) {
+		while (t.len > 0)
+			structs_mem_free(t.list[--t.len]);
+		structs_mem_free(t.list);
+		return (-1);
+	}
+
+	/* Return the result */
+	*listp = t.list;
+	return (t.len);
+}
+
+static int structs_trav(void *arg, const char *name,
+			const struct structs_type *type, const void *data)
+{
+	struct structs_trav *const t = arg;
+
+	/* Only primitive types are added */
+	if (type->tclass != STRUCTS_TYPE_PRIMITIVE)
+		return (STRUCTS_WALK_CONTINUE);
+
+	/* Grow list as necessary */
+	if (t->len == t->alloc) {
+		unsigned int new_alloc;
+		char **new_list;
+
+		new_alloc = (t->alloc + 32) * 2;
+		if ((new_list = structs_mem_realloc(t->list,
+					new_alloc * sizeof(*t->list))) == NULL)
+			return (-1);
+		t->list = new_list;
+		t->alloc = new_alloc;
+	}
+
+	/* Add new name to list */
+	if ((t->list[t->len] = structs_mem_strdup(name)) == NULL)
+		return (-1);
+	t->len++;
+
+	/* Done */
+	return (STRUCTS_WALK_CONTINUE);
+}
+
 /*******************************************************************************
  * BUILT-IN LOGGERS
  ******************************************************************************/
@@ -43,8 +43,10 @@
     of memory so that the operations listed above may be peformed
     in an automated fashion.
 
-    Arrays must be defined using the "structs_array" structure.
-    Unions must be defined using the "structs_union" structure.
+    Arrays must be defined using the "structs_array" structure,
+    or the "structs_varray" structure if they should track capacity.
+    Unions must be defined using the "structs_union" structure,
+    or DEFINE_STRUCTS_INLINE_UNION() to store the field contents inline.
 
     Nested items in a data structure can be identified by names,
     where each name component is either the name of a structure or
@@ -127,6 +129,13 @@ typedef struct structs_data {
 	unsigned char *data;	/* bytes */
 } structs_data;
 
+/* A growable buffer that binary encodings are appended to */
+typedef struct structs_encoder {
+	size_t length;		/* number of bytes encoded so far */
+	size_t size;		/* allocated size of "data" */
+	unsigned char *data;	/* bytes */
+} structs_encoder;
+
 /*******************************************************************************
  * STRUCTS TYPE METHODS
  ******************************************************************************/
@@ -268,6 +277,101 @@ typedef int structs_decode_t(const struct structs_type *type,
  */
 typedef void structs_uninit_t(const struct structs_type *type, void *data);
 
+/*
+ * The structs type "ascify_into" method (optional).
+ *
+ * This is the same as the "ascify" method, except that the ASCII string
+ * is written into the caller-supplied buffer "buf", which has total size
+ * "bufmax", instead of into a dynamically allocated buffer. As with
+ * snprintf(3), the string is truncated (but still NUL-terminated if
+ * "bufmax" is not zero) if it does not fit.
+ *
+ * Returns the length of the entire ASCII string, not counting the NUL,
+ * even if it was truncated; or -1 (and sets errno) if error.
+ *
+ * Types that don't have this method leave it NULL; in that case,
+ * the "ascify" method is used instead.
+ */
+typedef int structs_ascify_into_t(const struct structs_type *type,
+				  const void *data, char *buf, size_t bufmax);
+
+/*
+ * The structs type "memsize" method (optional).
+ *
+ * The region of memory pointed to by "data" contains a valid instance
+ * of the type described by "type".
+ *
+ * This method should call "block" once for each dynamically allocated
+ * block of memory the instance holds, passing "arg", the address of the
+ * block and the number of bytes that were requested for it. This includes
+ * the blocks containing an instance's sub-elements (e.g., an array's
+ * element buffer), but not the blocks held by the sub-elements themselves,
+ * which their own types report. Blocks shared by several instances
+ * are reported by each of them.
+ *
+ * Types that don't hold any dynamically allocated memory leave it NULL.
+ */
+typedef void structs_memblock_t(void *arg, const void *block, size_t size);
+typedef void structs_memsize_t(const struct structs_type *type,
+			       const void *data, structs_memblock_t *block,
+			       void *arg);
+
+/*
+ * The structs type "compare" method (optional).
+ *
+ * The regions of memory pointed to by "data1" and "data2" contain valid
+ * instances of the type described by "type".
+ *
+ * Returns a negative value, zero, or a positive value if "data1" is less
+ * than, equal to, or greater than "data2", respectively. This must be a
+ * total order, and it must find two instances equal exactly when the
+ * "equal" method does (values never equal to anything, such as NaN, may
+ * compare as equal to each other).
+ *
+ * If there was an error, this method should set errno and return zero.
+ *
+ * Types that don't have this method leave it NULL; in that case,
+ * the instances' binary encodings are compared instead.
+ */
+typedef int structs_compare_t(const struct structs_type *type,
+			      const void *data1, const void *data2);
+
+/*
+ * The structs type "hash" method (optional).
+ *
+ * The region of memory pointed to by "data" contains a valid instance
+ * of the type described by "type".
+ *
+ * Returns a 64 bit hash of the instance. Instances that the "equal" method
+ * finds equal must have the same hash. structs_hash_bytes() (see below)
+ * may be used to compute it.
+ *
+ * If there was an error, this method should set errno and return zero.
+ *
+ * Types that don't have this method leave it NULL; in that case,
+ * the instance's binary encoding is hashed instead.
+ */
+typedef uint64_t structs_hash_t(const struct structs_type *type,
+				const void *data);
+
+/*
+ * The structs type "encode_into" method (optional).
+ *
+ * This is the same as the "encode" method, except that the encoding is
+ * appended to "enc" (see structs_encoder_reserve() below) instead of
+ * being put into a buffer of its own, so that a data structure can be
+ * encoded in a single pass with no intermediate copies.
+ *
+ * Returns 0 if successful, or -1 (and sets errno) if there was an error,
+ * in which case the caller discards whatever was appended to "enc".
+ *
+ * Types that don't have this method leave it NULL; in that case,
+ * the "encode" method is used instead.
+ */
+typedef int structs_encode_into_t(const struct structs_type *type,
+				  struct structs_encoder *enc,
+				  const void *data);
+
 /*******************************************************************************
  * STRUCTS TYPE DEFINITION
  ******************************************************************************/
@@ -292,6 +396,11 @@ typedef struct structs_type {
 		const char *s;
 		int i;
 	} args[3];
+	structs_ascify_into_t *ascify_into;	/* optional "ascify_into" method */
+	structs_memsize_t *memsize;	/* optional "memsize" method */
+	structs_compare_t *compare;	/* optional "compare" method */
+	structs_hash_t *hash;	/* optional "hash" method */
+	structs_encode_into_t *encode_into;	/* optional "encode_into" method */
 } structs_type;
 
 /* Classes of types */
@@ -329,6 +438,20 @@ extern structs_encode_t structs_region_encode;
 extern structs_decode_t structs_region_decode;
 extern structs_encode_t structs_region_encode_netorder;
 extern structs_decode_t structs_region_decode_netorder;
+extern structs_encode_into_t structs_region_encode_into;
+extern structs_encode_into_t structs_region_encode_netorder_into;
+extern structs_compare_t structs_region_compare;
+extern structs_hash_t structs_region_hash;
+
+/*
+ * Continue a hash with "len" more bytes of data. A hash is started
+ * with STRUCTS_HASH_INIT, and the hashes of sub-elements may be added
+ * to it like any other data.
+ */
+#define STRUCTS_HASH_INIT	0xcbf29ce484222325ULL
+
+extern uint64_t structs_hash_bytes(uint64_t hash, const void *data,
+				   size_t len);
 
 /* These always return an error with errno set to EOPNOTSUPP */
 extern structs_init_t structs_notsupp_init;
@@ -342,6 +465,30 @@ extern structs_decode_t structs_notsupp_decode;
 /* This copies any type that is ascifyable by converting to ASCII and back */
 extern structs_copy_t structs_ascii_copy;
 
+/* This encodes any type that has an "encode_into" method using it */
+extern structs_encode_t structs_encoder_encode;
+
+/*
+ * Append "len" bytes to an encoder and return a pointer to them, for
+ * the caller to fill in, or NULL (and set errno) if there was an error.
+ * An encoder starts out zeroed and its buffer is allocated using the
+ * current allocator, so "data" must be freed using structs_mem_free().
+ *
+ * The buffer may move when more bytes are appended, so space reserved
+ * for something that is filled in later (such as a header giving the
+ * length of what follows) should be found again by its offset.
+ */
+extern unsigned char *structs_encoder_reserve(struct structs_encoder *enc,
+					      size_t len);
+
+/*
+ * Append a copy of "len" bytes at "data" to an encoder.
+ *
+ * Returns 0 if successful, or -1 (and sets errno) if there was an error.
+ */
+extern int structs_encoder_append(struct structs_encoder *enc,
+				  const void *data, size_t len);
+
 /* This does nothing */
 extern structs_uninit_t structs_nothing_free;
 
@@ -395,6 +542,44 @@ extern int structs_equal(const struct structs_type *type,
 			 const char *name, const void *data1,
 			 const void *data2);
 
+/*
+ * Compare two data structures of the same type for ordering.
+ *
+ * If "name" is NULL or empty string, the entire structures are compared.
+ * Otherwise, the "name" sub-elements of both structures are compared.
+ *
+ * Returns a negative value, zero, or a positive value if "data1" is less
+ * than, equal to, or greater than "data2", respectively, in a total order
+ * that agrees with structs_equal() except for floating point NaNs: these
+ * sort after all numbers and compare equal to each other, although
+ * structs_equal() never finds a NaN equal to anything. Primitive items
+ * are ordered by value, arrays element by element (shorter first if one
+ * is a prefix of the other), structures field by field, and unions by
+ * field (in the order the fields are declared) and then by the field's
+ * value.
+ *
+ * If there was an error, zero is returned and errno is set; to detect
+ * errors, set errno to zero before calling.
+ */
+extern int structs_compare(const struct structs_type *type,
+			   const char *name, const void *data1,
+			   const void *data2);
+
+/*
+ * Compute a 64 bit hash of a data structure.
+ *
+ * If "name" is NULL or empty string, the entire structure is hashed.
+ * Otherwise, the "name" sub-element of the structure is hashed.
+ *
+ * Items that structs_equal() finds equal have the same hash. Hashes
+ * do not change from one run of a program to the next.
+ *
+ * If there was an error, zero is returned and errno is set; to detect
+ * errors, set errno to zero before calling.
+ */
+extern uint64_t structs_hash(const struct structs_type *type,
+			     const char *name, const void *data);
+
 /*
  * Find an item in a data structure structure.
  *
@@ -446,6 +631,45 @@ extern int structs_get(const struct structs_type *type,
 extern int structs_set(const struct structs_type *type,
 		       const void *from, const char *name, void *to);
 
+/*
+ * Move an item into a data structure. This is the same as structs_set(),
+ * followed by resetting "from" to its initialized state, except that the
+ * item itself is moved rather than copied.
+ *
+ * If "name" is NULL or empty string, the entire structure is moved.
+ *
+ * It is assumed that "from" and "to" are both initialized. The item
+ * being overwritten in "to" is free'd; "from" may be part of it. The
+ * contents of "from" must have been allocated with the same allocator
+ * as those of "to" (see structs_alloc.h).
+ *
+ * Note: "name" is only applied to "to". The structs types of
+ * "from" and "to.<name>" must be the same.
+ *
+ * Returns 0 if successful, otherwise -1 and sets errno; in that case,
+ * neither "from" nor "to" is changed.
+ */
+extern int structs_move(const struct structs_type *type,
+			void *from, const char *name, void *to);
+
+/*
+ * Swap an item in a data structure with another item, without copying
+ * either one's contents.
+ *
+ * If "name" is NULL or empty string, the entire structure is swapped.
+ *
+ * It is assumed that "a" and "b" are both initialized; neither may be
+ * part of the other. Their contents must have been allocated with the
+ * same allocator.
+ *
+ * Note: "name" is only applied to "a". The structs types of
+ * "a.<name>" and "b" must be the same.
+ *
+ * Returns 0 if successful, otherwise -1 and sets errno.
+ */
+extern int structs_swap(const struct structs_type *type,
+			const char *name, void *a, void *b);
+
 /*
  * Get the ASCII form of an item, in a string allocated.
  *
@@ -456,6 +680,19 @@ extern int structs_set(const struct structs_type *type,
 extern char *structs_get_string(const struct structs_type *type,
 				const char *name, const void *data);
 
+/*
+ * Get the ASCII form of an item into the caller-supplied buffer "buf",
+ * which has total size "bufmax". No memory is allocated if the item's
+ * type has an "ascify_into" method.
+ *
+ * Returns the length of the ASCII string as with snprintf(3), i.e., if
+ * the return value is "bufmax" or more, the string was truncated.
+ * Returns -1 and sets errno if there was an error.
+ */
+extern int structs_get_string_buf(const struct structs_type *type,
+				  const char *name, const void *data,
+				  char *buf, size_t bufmax);
+
 /*
  * Set the value of an item in a data structure from an ASCII string.
  *
@@ -506,6 +743,47 @@ extern int structs_set_binary(const struct structs_type *type,
 extern int structs_traverse(const struct structs_type *type,
 			    const void *data, char ***listp);
 
+/*
+ * Visitor function type for structs_walk().
+ *
+ * "path" is the name of the item being visited (the empty string for
+ * the top level item) relative to the walk's starting point; it is only
+ * valid during the call. "type" and "data" describe the item itself.
+ * Pointers are followed transparently, so "type" is never a pointer type.
+ *
+ * Returns one of the values below, or -1 (and sets errno) to abort
+ * the walk with an error.
+ */
+typedef int structs_visitor_t(void *arg, const char *path,
+			      const struct structs_type *type,
+			      const void *data);
+
+#define STRUCTS_WALK_CONTINUE	0	/* continue into sub-elements */
+#define STRUCTS_WALK_PRUNE	1	/* skip this item's sub-elements */
+#define STRUCTS_WALK_STOP	2	/* stop the walk now */
+
+/*
+ * Walk a data structure, calling "visitor" for every item in it,
+ * including aggregates, in depth first order: each item is visited
+ * before its sub-elements. Only the selected field of a union is visited.
+ *
+ * Returns 0 if the walk completed, 1 if the visitor stopped it early,
+ * or -1 and errno if there was an error.
+ */
+extern int structs_walk(const struct structs_type *type, const void *data,
+			structs_visitor_t *visitor, void *arg);
+
+/*
+ * Free all memory the structs library has cached internally, such as
+ * the field name indicies built for structure and union types and the
+ * default instances used to omit default values when encoding.
+ *
+ * This is only useful for leak checkers and for programs that unload
+ * the types they define. It must not be called while any other thread
+ * is using the structs library; the caches are rebuilt as needed.
+ */
+extern void structs_cleanup(void);
+
 #endif /* _STRUCTS_H_ */
 /*******************************************************************************
  * END OF FILE
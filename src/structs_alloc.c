@@ -0,0 +1,195 @@
+/*******************************************************************************
+ * HEADERS
+ ******************************************************************************/
+
+/* Standard Includes */
+#include <sys/types.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+/* Module Includes */
+#include "structs.h"
+#include "structs_alloc.h"
+#include "structs_internal.h"
+
+/*******************************************************************************
+ * MACROS/VARIABLES
+ ******************************************************************************/
+
+/* Global allocator */
+static const struct structs_allocator *structs_allocator_global
+    = &structs_allocator_default;
+
+/* Per-thread allocator, if any */
+static __thread const struct structs_allocator *structs_allocator_thread;
+
+/*******************************************************************************
+ * FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+static void *structs_default_malloc(void *arg, size_t size);
+static void *structs_default_calloc(void *arg, size_t nmemb, size_t size);
+static void *structs_default_realloc(void *arg, void *ptr, size_t size);
+static void structs_default_free(void *arg, void *ptr);
+static char *structs_default_strdup(void *arg, const char *s);
+
+/*******************************************************************************
+ * FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+const struct structs_allocator structs_allocator_default = {
+	structs_default_malloc,
+	structs_default_calloc,
+	structs_default_realloc,
+	structs_default_free,
+	structs_default_strdup,
+	NULL
+};
+
+void structs_set_allocator(const struct structs_allocator *alloc)
+{
+	if (alloc == NULL)
+		alloc = &structs_allocator_default;
+	__atomic_store_n(&structs_allocator_global, alloc, __ATOMIC_RELEASE);
+}
+
+const struct structs_allocator
+*structs_set_thread_allocator(const struct structs_allocator *alloc)
+{
+	const struct structs_allocator *const prev = structs_allocator_thread;
+
+	structs_allocator_thread = alloc;
+	return (prev);
+}
+
+const struct structs_allocator *structs_get_allocator(void)
+{
+	if (structs_allocator_thread != NULL)
+		return (structs_allocator_thread);
+	return (__atomic_load_n(&structs_allocator_global, __ATOMIC_ACQUIRE));
+}
+
+void *structs_mem_malloc(size_t size)
+{
+	const struct structs_allocator *const alloc = structs_get_allocator();
+
+	return ((*alloc->malloc) (alloc->arg, size));
+}
+
+void *structs_mem_calloc(size_t nmemb, size_t size)
+{
+	const struct structs_allocator *const alloc = structs_get_allocator();
+	void *mem;
+
+	/* Use the allocator's calloc() if it has one */
+	if (alloc->calloc != NULL)
+		return ((*alloc->calloc) (alloc->arg, nmemb, size));
+
+	/* Otherwise, do it ourselves */
+	if (size != 0 && nmemb > SIZE_MAX / size) {
+		errno = ENOMEM;
+		return (NULL);
+	}
+	if ((mem = (*alloc->malloc) (alloc->arg, nmemb * size)) == NULL)
+		return (NULL);
+	memset(mem, 0, nmemb * size);
+	return (mem);
+}
+
+void *structs_mem_realloc(void *ptr, size_t size)
+{
+	const struct structs_allocator *const alloc = structs_get_allocator();
+
+	return ((*alloc->realloc) (alloc->arg, ptr, size));
+}
+
+char *structs_mem_strdup(const char *s)
+{
+	const struct structs_allocator *const alloc = structs_get_allocator();
+	const size_t len = strlen(s);
+	char *copy;
+
+	/* Use the allocator's strdup() if it has one */
+	if (alloc->strdup != NULL)
+		return ((*alloc->strdup) (alloc->arg, s));
+
+	/* Otherwise, do it ourselves */
+	if ((copy = (*alloc->malloc) (alloc->arg, len + 1)) == NULL)
+		return (NULL);
+	memcpy(copy, s, len + 1);
+	return (copy);
+}
+
+void structs_mem_free(void *ptr)
+{
+	const struct structs_allocator *const alloc = structs_get_allocator();
+
+	if (ptr != NULL)
+		(*alloc->free) (alloc->arg, ptr);
+}
+
+/*
+ * Like asprintf(3), but using the current allocator.
+ */
+int structs_mem_asprintf(char **ret, const char *fmt, ...)
+{
+	va_list args;
+	char *buf;
+	int len;
+
+	/* Get length */
+	va_start(args, fmt);
+	len = vsnprintf(NULL, 0, fmt, args);
+	va_end(args);
+	if (len < 0)
+		goto fail;
+
+	/* Format string */
+	if ((buf = structs_mem_malloc(len + 1)) == NULL)
+		goto fail;
+	va_start(args, fmt);
+	vsnprintf(buf, len + 1, fmt, args);
+	va_end(args);
+	*ret = buf;
+	return (len);
+
+fail:
+	*ret = NULL;
+	return (-1);
+}
+
+/*
+ * Default allocator methods.
+ */
+static void *structs_default_malloc(void *arg, size_t size)
+{
+	return (malloc(size));
+}
+
+static void *structs_default_calloc(void *arg, size_t nmemb, size_t size)
+{
+	return (calloc(nmemb, size));
+}
+
+static void *structs_default_realloc(void *arg, void *ptr, size_t size)
+{
+	return (realloc(ptr, size));
+}
+
+static void structs_default_free(void *arg, void *ptr)
+{
+	free(ptr);
+}
+
+static char *structs_default_strdup(void *arg, const char *s)
+{
+	return (strdup(s));
+}
+
+/*******************************************************************************
+ * END OF FILE
+ ******************************************************************************/
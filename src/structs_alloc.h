@@ -0,0 +1,83 @@
+#ifndef _STRUCTS_ALLOC_H_
+#define _STRUCTS_ALLOC_H_
+
+/*******************************************************************************
+ * MEMORY ALLOCATORS
+ ******************************************************************************/
+
+/*
+ * All memory the structs library allocates comes from the current
+ * allocator. This includes memory owned by data structures (strings,
+ * array elements, pointer referents, union fields, etc.), memory
+ * returned to the caller (e.g., by structs_get_string()), and memory
+ * used internally by the type methods and XML, JSON and msgpack
+ * serializers, including the expat parser.
+ *
+ * The current allocator is the calling thread's allocator if one has
+ * been set, otherwise the global allocator, which is initially
+ * structs_allocator_default. To use a different allocator for a
+ * single call, set the thread's allocator before the call and restore
+ * it afterward.
+ *
+ * Memory must be released using the same allocator that allocated it.
+ * In particular, a data structure must be free'd with the allocator
+ * that was current when its contents were allocated, and memory returned
+ * by the library must be released with structs_mem_free() (instead of
+ * free(3)) when the allocator is not structs_allocator_default.
+ *
+ * Information the library caches internally for each structs type lives
+ * for the rest of the program and always uses structs_allocator_default.
+ */
+struct structs_allocator {
+	void *(*malloc) (void *arg, size_t size);
+	void *(*calloc) (void *arg, size_t nmemb, size_t size);	/* optional */
+	void *(*realloc) (void *arg, void *ptr, size_t size);
+	void (*free) (void *arg, void *ptr);
+	char *(*strdup) (void *arg, const char *s);	/* optional */
+	void *arg;		/* opaque argument passed to the above */
+};
+
+/*
+ * The allocator that uses the C library's malloc(3), etc.
+ */
+extern const struct structs_allocator structs_allocator_default;
+
+/*
+ * Set the global allocator.
+ *
+ * If "alloc" is NULL, structs_allocator_default is used.
+ */
+extern void structs_set_allocator(const struct structs_allocator *alloc);
+
+/*
+ * Set the calling thread's allocator.
+ *
+ * If "alloc" is NULL, the thread uses the global allocator.
+ *
+ * Returns the thread's previous allocator (possibly NULL).
+ */
+extern const struct structs_allocator
+*structs_set_thread_allocator(const struct structs_allocator *alloc);
+
+/*
+ * Get the calling thread's current allocator.
+ */
+extern const struct structs_allocator *structs_get_allocator(void);
+
+/*
+ * Allocate and free memory using the current allocator.
+ *
+ * These behave like their C library counterparts (structs_mem_free()
+ * corresponds to free(3)). Type methods must use them for all memory
+ * they allocate or free.
+ */
+extern void *structs_mem_malloc(size_t size);
+extern void *structs_mem_calloc(size_t nmemb, size_t size);
+extern void *structs_mem_realloc(void *ptr, size_t size);
+extern char *structs_mem_strdup(const char *s);
+extern void structs_mem_free(void *ptr);
+
+#endif /* _STRUCTS_ALLOC_H_ */
+/*******************************************************************************
+ * END OF FILE
+ ******************************************************************************/
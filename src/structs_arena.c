@@ -0,0 +1,280 @@
+/*******************************************************************************
+ * HEADERS
+ ******************************************************************************/
+
+/* Standard Includes */
+#include <sys/types.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+/* Module Includes */
+#include "structs.h"
+#include "structs_alloc.h"
+#include "structs_arena.h"
+
+/*******************************************************************************
+ * MACROS/VARIABLES
+ ******************************************************************************/
+
+/* Default chunk size */
+#define STRUCTS_ARENA_CHUNK	(64 * 1024)
+
+/* Alignment of all allocations */
+#define STRUCTS_ARENA_ALIGN	16
+#define STRUCTS_ARENA_ROUND(x)						\
+	(((x) + STRUCTS_ARENA_ALIGN - 1) & ~(size_t)(STRUCTS_ARENA_ALIGN - 1))
+
+/* A chunk of memory; allocations follow the header */
+struct structs_arena_chunk {
+	struct structs_arena_chunk *next;	/* next older chunk */
+	size_t size;		/* bytes available for allocations */
+	size_t used;		/* bytes allocated so far */
+};
+#define STRUCTS_ARENA_CHUNK_HDR						\
+	STRUCTS_ARENA_ROUND(sizeof(struct structs_arena_chunk))
+#define STRUCTS_ARENA_CHUNK_DATA(ch)					\
+	((char *)(ch) + STRUCTS_ARENA_CHUNK_HDR)
+
+/* Each allocation is preceded by its capacity */
+#define STRUCTS_ARENA_BLOCK_HDR	STRUCTS_ARENA_ROUND(sizeof(size_t))
+#define STRUCTS_ARENA_BLOCK_CAP(ptr)					\
+	(*(size_t *)((char *)(ptr) - STRUCTS_ARENA_BLOCK_HDR))
+
+/* Largest allocation, so sizes can't overflow */
+#define STRUCTS_ARENA_MAX						\
+	(SIZE_MAX / 2 - STRUCTS_ARENA_CHUNK_HDR - STRUCTS_ARENA_BLOCK_HDR)
+
+/* Arena state */
+struct structs_arena {
+	struct structs_allocator alloc;	/* allocator using this arena */
+	const struct structs_allocator *parent;	/* where chunks come from */
+	struct structs_arena_chunk *chunks;	/* chunks, current one first */
+	size_t chunk_size;	/* size of normal chunks */
+	size_t total;		/* bytes obtained from "parent" */
+};
+
+/*******************************************************************************
+ * FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+static void *structs_arena_malloc(void *arg, size_t size);
+static void *structs_arena_calloc(void *arg, size_t nmemb, size_t size);
+static void *structs_arena_realloc(void *arg, void *ptr, size_t size);
+static void structs_arena_free(void *arg, void *ptr);
+static struct structs_arena_chunk *structs_arena_chunk(struct structs_arena
+						       *arena, size_t need);
+static int structs_arena_is_last(const struct structs_arena *arena,
+				 const void *ptr);
+
+/*******************************************************************************
+ * FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+struct structs_arena *structs_arena_create(size_t chunk_size)
+{
+	const struct structs_allocator *const parent = structs_get_allocator();
+	struct structs_arena *arena;
+
+	/* Allocate arena */
+	if ((arena = (*parent->malloc) (parent->arg, sizeof(*arena))) == NULL)
+		return (NULL);
+	memset(arena, 0, sizeof(*arena));
+	arena->alloc.malloc = structs_arena_malloc;
+	arena->alloc.calloc = structs_arena_calloc;
+	arena->alloc.realloc = structs_arena_realloc;
+	arena->alloc.free = structs_arena_free;
+	arena->alloc.arg = arena;
+	arena->parent = parent;
+	if (chunk_size == 0)
+		chunk_size = STRUCTS_ARENA_CHUNK;
+	if (chunk_size > STRUCTS_ARENA_MAX)
+		chunk_size = STRUCTS_ARENA_MAX;
+	arena->chunk_size = STRUCTS_ARENA_ROUND(chunk_size);
+	return (arena);
+}
+
+const struct structs_allocator *structs_arena_allocator(struct structs_arena
+							*arena)
+{
+	return (&arena->alloc);
+}
+
+void structs_arena_release(struct structs_arena *arena)
+{
+	const struct structs_allocator *const parent = arena->parent;
+	struct structs_arena_chunk *ch;
+
+	while ((ch = arena->chunks) != NULL) {
+		arena->chunks = ch->next;
+		(*parent->free) (parent->arg, ch);
+	}
+	arena->total = 0;
+}
+
+void structs_arena_destroy(struct structs_arena **arenap)
+{
+	struct structs_arena *const arena = *arenap;
+	const struct structs_allocator *parent;
+
+	if (arena == NULL)
+		return;
+	*arenap = NULL;
+	structs_arena_release(arena);
+	parent = arena->parent;
+	(*parent->free) (parent->arg, arena);
+}
+
+size_t structs_arena_size(const struct structs_arena *arena)
+{
+	return (arena->total);
+}
+
+/*
+ * Allocate from the current chunk, getting a new one if it's full.
+ */
+static void *structs_arena_malloc(void *arg, size_t size)
+{
+	struct structs_arena *const arena = arg;
+	struct structs_arena_chunk *ch;
+	size_t need;
+	char *ptr;
+
+	/* Get chunk with enough room */
+	if (size > STRUCTS_ARENA_MAX) {
+		errno = ENOMEM;
+		return (NULL);
+	}
+	size = STRUCTS_ARENA_ROUND(size);
+	need = STRUCTS_ARENA_BLOCK_HDR + size;
+	if ((ch = arena->chunks) == NULL || ch->size - ch->used < need) {
+		if ((ch = structs_arena_chunk(arena, need)) == NULL)
+			return (NULL);
+	}
+
+	/* Carve out new block */
+	ptr = STRUCTS_ARENA_CHUNK_DATA(ch) + ch->used + STRUCTS_ARENA_BLOCK_HDR;
+	ch->used += need;
+	STRUCTS_ARENA_BLOCK_CAP(ptr) = size;
+	return (ptr);
+}
+
+static void *structs_arena_calloc(void *arg, size_t nmemb, size_t size)
+{
+	void *ptr;
+
+	if (size != 0 && nmemb > STRUCTS_ARENA_MAX / size) {
+		errno = ENOMEM;
+		return (NULL);
+	}
+	if ((ptr = structs_arena_malloc(arg, nmemb * size)) == NULL)
+		return (NULL);
+	memset(ptr, 0, nmemb * size);
+	return (ptr);
+}
+
+/*
+ * Blocks are grown in place when they are the most recent allocation,
+ * otherwise they are moved to a block with at least double the capacity,
+ * so that growing an array one element at a time wastes at most
+ * a constant factor of memory.
+ */
+static void *structs_arena_realloc(void *arg, void *ptr, size_t size)
+{
+	struct structs_arena *const arena = arg;
+	size_t cap;
+	void *mem;
+
+	/* Handle trivial cases */
+	if (ptr == NULL)
+		return (structs_arena_malloc(arg, size));
+	if (size > STRUCTS_ARENA_MAX) {
+		errno = ENOMEM;
+		return (NULL);
+	}
+	cap = STRUCTS_ARENA_BLOCK_CAP(ptr);
+	size = STRUCTS_ARENA_ROUND(size);
+	if (size <= cap)
+		return (ptr);
+
+	/* Grow in place if possible */
+	if (structs_arena_is_last(arena, ptr)
+	    && arena->chunks->size - arena->chunks->used >= size - cap) {
+		arena->chunks->used += size - cap;
+		STRUCTS_ARENA_BLOCK_CAP(ptr) = size;
+		return (ptr);
+	}
+
+	/* Move to a bigger block */
+	if (size < cap * 2 && cap * 2 <= STRUCTS_ARENA_MAX)
+		size = cap * 2;
+	if ((mem = structs_arena_malloc(arg, size)) == NULL)
+		return (NULL);
+	memcpy(mem, ptr, cap);
+	return (mem);
+}
+
+/*
+ * Memory is only reclaimed when it's the most recent allocation.
+ */
+static void structs_arena_free(void *arg, void *ptr)
+{
+	struct structs_arena *const arena = arg;
+
+	if (structs_arena_is_last(arena, ptr)) {
+		arena->chunks->used -= STRUCTS_ARENA_BLOCK_HDR
+		    + STRUCTS_ARENA_BLOCK_CAP(ptr);
+	}
+}
+
+/*
+ * Get a new chunk with at least "need" bytes available. Allocations
+ * too big to share a chunk get their own, which is placed behind the
+ * current chunk so the space left in the current chunk isn't wasted.
+ */
+static struct structs_arena_chunk *structs_arena_chunk(struct structs_arena
+						       *arena, size_t need)
+{
+	const struct structs_allocator *const parent = arena->parent;
+	const int dedicated = need > arena->chunk_size / 4;
+	const size_t size = dedicated ? need : arena->chunk_size;
+	struct structs_arena_chunk *ch;
+
+	/* Allocate chunk */
+	if ((ch = (*parent->malloc) (parent->arg,
+				     STRUCTS_ARENA_CHUNK_HDR + size)) == NULL)
+		return (NULL);
+	ch->size = size;
+	ch->used = 0;
+	arena->total += STRUCTS_ARENA_CHUNK_HDR + size;
+
+	/* Link it in */
+	if (dedicated && arena->chunks != NULL) {
+		ch->next = arena->chunks->next;
+		arena->chunks->next = ch;
+	} else {
+		ch->next = arena->chunks;
+		arena->chunks = ch;
+	}
+	return (ch);
+}
+
+/*
+ * Determine whether a block is the most recent one in the current chunk.
+ */
+static int structs_arena_is_last(const struct structs_arena *arena,
+				 const void *ptr)
+{
+	const struct structs_arena_chunk *const ch = arena->chunks;
+
+	return (ch != NULL
+		&& (const char *)ptr + STRUCTS_ARENA_BLOCK_CAP(ptr)
+		== STRUCTS_ARENA_CHUNK_DATA(ch) + ch->used);
+}
+
+/*******************************************************************************
+ * END OF FILE
+ ******************************************************************************/
@@ -0,0 +1,77 @@
+#ifndef _STRUCTS_ARENA_H_
+#define _STRUCTS_ARENA_H_
+
+/*******************************************************************************
+ * MEMORY ARENAS
+ ******************************************************************************/
+
+/*
+ * An arena is an allocator (see structs_alloc.h) that carves memory out
+ * of large chunks and never frees anything individually. Everything
+ * allocated from an arena is released at once by structs_arena_release(),
+ * without visiting the data structures that used it.
+ *
+ * To decode into an arena, make its allocator the thread's allocator
+ * for the duration of the decode:
+ *
+ *	prev = structs_set_thread_allocator(structs_arena_allocator(arena));
+ *	r = structs_json_input(type, ..., &data, ...);
+ *	structs_set_thread_allocator(prev);
+ *	...
+ *	structs_arena_release(arena);		(instead of structs_free())
+ *
+ * Any other operation that allocates memory for an arena-owned data
+ * structure (e.g., structs_set() or structs_array_insert()) must also be
+ * done with the arena's allocator current, so that all of its memory
+ * stays in the arena. To keep (part of) it beyond the arena's lifetime,
+ * copy it out with structs_get() using some other allocator.
+ *
+ * Memory used temporarily during an operation also comes from the arena.
+ * It is mostly reclaimed, but not entirely until the arena is released.
+ *
+ * An arena may only be used by one thread at a time.
+ */
+struct structs_arena;
+
+/*
+ * Create a new arena that allocates memory in chunks of "chunk_size"
+ * bytes (or a reasonable default if "chunk_size" is zero). The chunks
+ * themselves come from the allocator that is current when this is called.
+ *
+ * Returns NULL (and sets errno) if there was an error.
+ */
+extern struct structs_arena *structs_arena_create(size_t chunk_size);
+
+/*
+ * Get the allocator that allocates from an arena.
+ */
+extern const struct structs_allocator *structs_arena_allocator(struct
+							       structs_arena
+							       *arena);
+
+/*
+ * Release all memory allocated from an arena. Every data structure
+ * using the arena becomes invalid and must not be free'd.
+ *
+ * The arena may then be used again.
+ */
+extern void structs_arena_release(struct structs_arena *arena);
+
+/*
+ * Release all memory allocated from an arena, destroy it, and set
+ * *arenap to NULL.
+ *
+ * If *arenap is already NULL, this does nothing.
+ */
+extern void structs_arena_destroy(struct structs_arena **arenap);
+
+/*
+ * Get the total number of bytes currently obtained from the arena's
+ * underlying allocator.
+ */
+extern size_t structs_arena_size(const struct structs_arena *arena);
+
+#endif /* _STRUCTS_ARENA_H_ */
+/*******************************************************************************
+ * END OF FILE
+ ******************************************************************************/
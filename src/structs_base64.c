@@ -16,6 +16,7 @@
 
 /* Module Includes */
 #include "structs.h"
+#include "structs_alloc.h"
 #include "structs_type_array.h"
 #include "structs_base64.h"
 #include "structs_filter.h"
@@ -66,20 +67,20 @@ struct filter *b64_encoder_create(const char *cmap)
 		return (NULL);
 
 	/* Create object */
-	if ((enc = calloc(1, sizeof(*enc))) == NULL)
+	if ((enc = structs_mem_calloc(1, sizeof(*enc))) == NULL)
 		return (NULL);
 	memset(enc, 0, sizeof(*enc));
 
 	/* Copy character map */
-	if ((enc->cmap = strdup(cmap)) == NULL) {
-		free(enc);
+	if ((enc->cmap = structs_mem_strdup(cmap)) == NULL) {
+		structs_mem_free(enc);
 		return (NULL);
 	}
 
 	/* Create mutex */
 	if ((errno = pthread_mutex_init(&enc->mutex, NULL)) != 0) {
-		free(enc->cmap);
-		free(enc);
+		structs_mem_free(enc->cmap);
+		structs_mem_free(enc);
 		return (NULL);
 	}
 
@@ -104,9 +105,9 @@ void b64_encoder_destroy(struct filter **filterp)
 
 	if (enc != NULL) {
 		pthread_mutex_destroy(&enc->mutex);
-		free(enc->cmap);
-		free(enc->obuf);
-		free(enc);
+		structs_mem_free(enc->cmap);
+		structs_mem_free(enc->obuf);
+		structs_mem_free(enc);
 		*encp = NULL;
 	}
 }
@@ -268,7 +269,8 @@ static int b64_encoder_output(struct b64_encoder *enc, const char *buf)
 		const int new_osize = (enc->olen * 2) + 31;
 		char *new_obuf;
 
-		if ((new_obuf = realloc(enc->obuf, new_osize)) == NULL)
+		if ((new_obuf = structs_mem_realloc(enc->obuf, new_osize))
+		    == NULL)
 			return (-1);
 		enc->obuf = new_obuf;
 		enc->osize = new_osize;
@@ -346,7 +348,7 @@ struct filter *b64_decoder_create(const char *cmap, int strict)
 		return (NULL);
 
 	/* Create object */
-	if ((dec = calloc(1, sizeof(*dec))) == NULL)
+	if ((dec = structs_mem_calloc(1, sizeof(*dec))) == NULL)
 		return (NULL);
 	memset(dec, 0, sizeof(*dec));
 	dec->strict = !!strict;
@@ -354,7 +356,7 @@ struct filter *b64_decoder_create(const char *cmap, int strict)
 
 	/* Create mutex */
 	if ((errno = pthread_mutex_init(&dec->mutex, NULL)) != 0) {
-		free(dec);
+		structs_mem_free(dec);
 		return (NULL);
 	}
 
@@ -388,8 +390,8 @@ void b64_decoder_destroy(struct filter **filterp)
 
 	if (dec != NULL) {
 		pthread_mutex_destroy(&dec->mutex);
-		free(dec->obuf);
-		free(dec);
+		structs_mem_free(dec->obuf);
+		structs_mem_free(dec);
 		*decp = NULL;
 	}
 }
@@ -566,7 +568,8 @@ static int b64_decoder_output(struct b64_decoder *dec, unsigned char *buf,
 		const int new_osize = (dec->olen * 2) + 31;
 		unsigned char *new_obuf;
 
-		if ((new_obuf = realloc(dec->obuf, new_osize)) == NULL)
+		if ((new_obuf = structs_mem_realloc(dec->obuf, new_osize))
+		    == NULL)
 			return (-1);
 		dec->obuf = new_obuf;
 		dec->osize = new_osize;
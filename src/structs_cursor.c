@@ -0,0 +1,234 @@
+/*******************************************************************************
+ * HEADERS
+ ******************************************************************************/
+
+/* Standard Includes */
+#include <sys/types.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+
+/* Module Includes */
+#include "structs.h"
+#include "structs_alloc.h"
+#include "structs_cursor.h"
+#include "structs_internal.h"
+
+/*******************************************************************************
+ * MACROS/VARIABLES
+ ******************************************************************************/
+
+/* An aggregate item whose sub-elements are being iterated */
+struct structs_cursor_frame {
+	const struct structs_type *type;	/* type of item */
+	const void *data;	/* item */
+	unsigned int index;	/* next sub-element */
+	size_t plen;		/* length of the item's name */
+};
+
+/* Cursor state */
+struct structs_cursor {
+	const struct structs_type *type;	/* top level type */
+	const void *data;	/* top level item */
+	int leaf;		/* top level item is a leaf not yet returned */
+	struct structs_cursor_frame *stack;	/* aggregates being iterated */
+	unsigned int depth;	/* number of frames in use */
+	unsigned int salloc;	/* number of frames allocated */
+	char *path;		/* name of the current item */
+	size_t palloc;		/* allocated size of "path" */
+};
+
+/*******************************************************************************
+ * FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+static int structs_cursor_push(struct structs_cursor *c,
+			       const struct structs_type *type,
+			       const void *data, size_t plen);
+static int structs_cursor_name(struct structs_cursor *c, size_t plen,
+			       const char *name);
+
+/*******************************************************************************
+ * FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+struct structs_cursor *structs_cursor_create(const struct structs_type *type,
+					     const void *data)
+{
+	struct structs_cursor *c;
+
+	/* Dereference through pointer(s) */
+	while (type->tclass == STRUCTS_TYPE_POINTER) {
+		type = type->args[0].v;
+		data = *((void **)data);
+	}
+
+	/* Create cursor */
+	if ((c = structs_mem_calloc(1, sizeof(*c))) == NULL)
+		return (NULL);
+	c->type = type;
+	c->data = data;
+	c->palloc = 64;
+	if ((c->path = structs_mem_malloc(c->palloc)) == NULL)
+		goto fail;
+	*c->path = '\0';
+
+	/* Start with the top level item */
+	if (type->tclass == STRUCTS_TYPE_PRIMITIVE)
+		c->leaf = 1;
+	else if (structs_cursor_push(c, type, data, 0) == -1)
+		goto fail;
+
+	/* Done */
+	return (c);
+
+fail:
+	structs_cursor_destroy(&c);
+	return (NULL);
+}
+
+int structs_cursor_next(struct structs_cursor *c, const char **pathp,
+			const struct structs_type **typep, const void **datap)
+{
+	char nbuf[STRUCTS_INDEX_BUFSIZE];
+	const struct structs_type *etype;
+	const void *edata;
+	const char *ename;
+	int r;
+
+	/* Special case: the top level item is itself a leaf */
+	if (c->leaf) {
+		c->leaf = 0;
+		etype = c->type;
+		edata = c->data;
+		goto found;
+	}
+
+	/* Find the next leaf */
+	while (c->depth > 0) {
+		struct structs_cursor_frame *const f = &c->stack[c->depth - 1];
+
+		/* Get next sub-element; if none, go back up a level */
+		if ((r = structs_child(f->type, f->data, f->index, nbuf,
+				       &ename, &etype, &edata)) == -1)
+			return (-1);
+		if (r == 0) {
+			c->path[f->plen] = '\0';
+			c->depth--;
+			continue;
+		}
+		f->index++;
+
+		/* Set the sub-element's name */
+		if (structs_cursor_name(c, f->plen, ename) == -1) {
+			f->index--;
+			return (-1);
+		}
+
+		/* Dereference through pointer(s) */
+		while (etype->tclass == STRUCTS_TYPE_POINTER) {
+			edata = *((void **)edata);
+			etype = etype->args[0].v;
+		}
+
+		/* Is it a leaf? */
+		if (etype->tclass == STRUCTS_TYPE_PRIMITIVE)
+			goto found;
+
+		/* Iterate over its sub-elements next */
+		if (structs_cursor_push(c, etype, edata,
+					strlen(c->path)) == -1) {
+			f->index--;
+			return (-1);
+		}
+	}
+	return (0);
+
+found:
+	if (pathp != NULL)
+		*pathp = c->path;
+	if (typep != NULL)
+		*typep = etype;
+	if (datap != NULL)
+		*datap = edata;
+	return (1);
+}
+
+void structs_cursor_destroy(struct structs_cursor **cp)
+{
+	struct structs_cursor *const c = *cp;
+
+	if (c == NULL)
+		return;
+	structs_mem_free(c->stack);
+	structs_mem_free(c->path);
+	structs_mem_free(c);
+	*cp = NULL;
+}
+
+/*
+ * Push a new frame for an aggregate item.
+ */
+static int structs_cursor_push(struct structs_cursor *c,
+			       const struct structs_type *type,
+			       const void *data, size_t plen)
+{
+	struct structs_cursor_frame *f;
+
+	/* Grow stack as necessary */
+	if (c->depth == c->salloc) {
+		const unsigned int new_alloc = (c->salloc + 8) * 2;
+		void *mem;
+
+		if ((mem = structs_mem_realloc(c->stack,
+				   new_alloc * sizeof(*c->stack))) == NULL)
+			return (-1);
+		c->stack = mem;
+		c->salloc = new_alloc;
+	}
+
+	/* Add frame */
+	f = &c->stack[c->depth++];
+	f->type = type;
+	f->data = data;
+	f->index = 0;
+	f->plen = plen;
+	return (0);
+}
+
+/*
+ * Set the current name to the first "plen" characters of the
+ * current name, followed by a separator and "name".
+ */
+static int structs_cursor_name(struct structs_cursor *c, size_t plen,
+			       const char *name)
+{
+	const size_t nlen = strlen(name);
+	size_t len = plen;
+
+	/* Grow buffer as necessary */
+	if (plen + 1 + nlen + 1 > c->palloc) {
+		size_t new_alloc;
+		char *mem;
+
+		for (new_alloc = c->palloc * 2;
+		     plen + 1 + nlen + 1 > new_alloc; new_alloc *= 2) ;
+		if ((mem = structs_mem_realloc(c->path, new_alloc)) == NULL)
+			return (-1);
+		c->path = mem;
+		c->palloc = new_alloc;
+	}
+
+	/* Append name */
+	if (len > 0)
+		c->path[len++] = STRUCTS_SEPARATOR;
+	memcpy(c->path + len, name, nlen + 1);
+	return (0);
+}
+
+/*******************************************************************************
+ * END OF FILE
+ ******************************************************************************/
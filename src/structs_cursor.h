@@ -0,0 +1,54 @@
+#ifndef _STRUCTS_CURSOR_H_
+#define _STRUCTS_CURSOR_H_
+
+/*******************************************************************************
+ * TRAVERSAL CURSORS
+ ******************************************************************************/
+
+/*
+ * A cursor iterates over the primitive items (the "leaves") of a data
+ * structure one at a time, in the same order as structs_traverse().
+ * Unlike structs_walk(), the caller drives the iteration and may stop
+ * between any two items and resume later, e.g., to export a very large
+ * structure in bounded time slices.
+ *
+ * The data structure must not be modified while a cursor is in use,
+ * except for the values of the primitive items themselves.
+ */
+struct structs_cursor;
+
+/*
+ * Create a cursor positioned before the first leaf of "data".
+ *
+ * Returns the new cursor, or NULL (and sets errno) if there was an error.
+ */
+extern struct structs_cursor *structs_cursor_create(const struct
+						    structs_type *type,
+						    const void *data);
+
+/*
+ * Advance the cursor to the next leaf.
+ *
+ * If "pathp" is not NULL, *pathp is set to the name of the leaf, which
+ * remains valid until the next call using the same cursor. If "typep"
+ * and "datap" are not NULL, they are set to the leaf's type and data.
+ *
+ * Returns 1 if a leaf was returned, 0 if there are no more leaves,
+ * or -1 (and sets errno) if there was an error.
+ */
+extern int structs_cursor_next(struct structs_cursor *cursor,
+			       const char **pathp,
+			       const struct structs_type **typep,
+			       const void **datap);
+
+/*
+ * Destroy a cursor and set *cursorp to NULL.
+ *
+ * If *cursorp is already NULL, this does nothing.
+ */
+extern void structs_cursor_destroy(struct structs_cursor **cursorp);
+
+#endif /* _STRUCTS_CURSOR_H_ */
+/*******************************************************************************
+ * END OF FILE
+ ******************************************************************************/
@@ -0,0 +1,465 @@
+/*******************************************************************************
+ * HEADERS
+ ******************************************************************************/
+
+/* Standard Includes */
+#include <sys/types.h>
+#include <sys/param.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <assert.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <errno.h>
+
+/* Module Includes */
+#include "structs.h"
+#include "structs_alloc.h"
+#include "structs_type_array.h"
+#include "structs_type_data.h"
+#include "structs_type_id.h"
+#include "structs_type_string.h"
+#include "structs_type_struct.h"
+#include "structs_type_union.h"
+#include "structs_diff.h"
+#include "structs_internal.h"
+
+/*******************************************************************************
+ * MACROS/VARIABLES
+ ******************************************************************************/
+
+/* Diff state */
+struct structs_diff_info {
+	struct structs_diff *diff;	/* diff being built */
+	char *path;		/* name of the current item */
+	size_t palloc;		/* allocated size of "path" */
+};
+
+static const struct structs_id structs_diff_ops[] = {
+	{ "set", STRUCTS_DIFF_SET, 0 },
+	{ "insert", STRUCTS_DIFF_INSERT, 0 },
+	{ "delete", STRUCTS_DIFF_DELETE, 0 },
+	{ NULL, 0, 0 }
+};
+
+static const struct structs_type structs_diff_op_type =
+STRUCTS_ID_TYPE(structs_diff_ops, sizeof(u_int8_t));
+
+static const struct structs_field structs_change_fields[] = {
+	STRUCTS_STRUCT_FIELD(structs_change, name, &structs_type_string),
+	STRUCTS_STRUCT_FIELD(structs_change, op, &structs_diff_op_type),
+	STRUCTS_STRUCT_FIELD(structs_change, value, &structs_type_data),
+	STRUCTS_STRUCT_FIELD_END
+};
+
+static const struct structs_type structs_change_type =
+STRUCTS_STRUCT_TYPE(structs_change, &structs_change_fields);
+
+const struct structs_type structs_type_diff =
+STRUCTS_VARRAY_TYPE(&structs_change_type, "change");
+
+/*******************************************************************************
+ * FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+static int structs_diff_sub(struct structs_diff_info *d,
+			    const struct structs_type *type,
+			    const void *odata, const void *ndata, size_t plen);
+static int structs_diff_array(struct structs_diff_info *d,
+			      const struct structs_type *type,
+			      const void *odata, const void *ndata,
+			      size_t plen);
+static int structs_diff_elem(struct structs_diff_info *d,
+			     const struct structs_type *type,
+			     const void *odata, const void *ndata,
+			     size_t plen, const char *name);
+static int structs_diff_add(struct structs_diff_info *d, int op,
+			    const struct structs_type *type,
+			    const void *data);
+static int structs_diff_name(struct structs_diff_info *d, size_t plen,
+			     const char *name);
+static char *structs_patch_array(const char *name, unsigned int *indexp);
+
+/*******************************************************************************
+ * FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+int structs_diff(const struct structs_type *type, const void *odata,
+		 const void *ndata, struct structs_diff *diff)
+{
+	struct structs_diff_info d;
+	int r;
+
+	/* Initialize diff */
+	if (structs_init(&structs_type_diff, NULL, diff) == -1)
+		return (-1);
+	memset(&d, 0, sizeof(d));
+	d.diff = diff;
+	d.palloc = 64;
+	if ((d.path = structs_mem_malloc(d.palloc)) == NULL) {
+		r = -1;
+		goto done;
+	}
+	*d.path = '\0';
+
+	/* Find changes */
+	r = structs_diff_sub(&d, type, odata, ndata, 0);
+
+done:
+	structs_mem_free(d.path);
+	if (r == -1) {
+		const int errno_save = errno;
+
+		structs_free(&structs_type_diff, NULL, diff);
+		errno = errno_save;
+	}
+	return (r);
+}
+
+int structs_patch(const struct structs_type *type, void *data,
+		  const struct structs_diff *diff, char *ebuf, size_t emax)
+{
+	const struct structs_change *change;
+	unsigned int index;
+	unsigned int i;
+	char *aname;
+	int r;
+
+	/* Initialize error buffer */
+	if (emax > 0)
+		*ebuf = '\0';
+
+	/* Apply changes in order */
+	for (i = 0; i < diff->length; i++) {
+		change = &diff->elems[i];
+		switch (change->op) {
+		case STRUCTS_DIFF_SET:
+			if (structs_set_binary(type, change->name,
+					       &change->value, data,
+					       ebuf, emax) == -1)
+				return (-1);
+			break;
+
+		case STRUCTS_DIFF_INSERT:
+		case STRUCTS_DIFF_DELETE:
+			if ((aname = structs_patch_array(change->name,
+							 &index)) == NULL)
+				goto fail;
+			if (change->op == STRUCTS_DIFF_DELETE) {
+				r = structs_array_delete(type, aname,
+							 index, data);
+				structs_mem_free(aname);
+				if (r == -1)
+					goto fail;
+				break;
+			}
+			if (structs_array_insert(type, aname,
+						 index, data) == -1) {
+				structs_mem_free(aname);
+				goto fail;
+			}
+			if (structs_set_binary(type, change->name,
+					       &change->value, data,
+					       ebuf, emax) == -1) {
+				const int errno_save = errno;
+
+				structs_array_delete(type, aname, index, data);
+				structs_mem_free(aname);
+				errno = errno_save;
+				return (-1);
+			}
+			structs_mem_free(aname);
+			break;
+
+		default:
+			errno = EINVAL;
+			goto fail;
+		}
+	}
+	return (0);
+
+fail:
+	strncpy(ebuf, strerror(errno), emax);
+	return (-1);
+}
+
+/*
+ * Find the changes that turn one item into another. The item's
+ * name is in d->path and is "plen" characters long.
+ */
+static int structs_diff_sub(struct structs_diff_info *d,
+			    const struct structs_type *type,
+			    const void *odata, const void *ndata, size_t plen)
+{
+	/* Follow pointers */
+	while (type->tclass == STRUCTS_TYPE_POINTER) {
+		type = type->args[0].v;
+		odata = *((void **)odata);
+		ndata = *((void **)ndata);
+	}
+
+	switch (type->tclass) {
+	case STRUCTS_TYPE_PRIMITIVE:
+		if ((*type->equal) (type, odata, ndata))
+			return (0);
+		return (structs_diff_add(d, STRUCTS_DIFF_SET, type, ndata));
+
+	case STRUCTS_TYPE_ARRAY:
+		return (structs_diff_array(d, type, odata, ndata, plen));
+
+	case STRUCTS_TYPE_FIXEDARRAY:
+		{
+			const struct structs_type *const etype =
+			    type->args[0].v;
+			const unsigned int length = type->args[2].i;
+			char nbuf[STRUCTS_INDEX_BUFSIZE];
+			unsigned int i;
+
+			for (i = 0; i < length; i++) {
+				snprintf(nbuf, sizeof(nbuf), "%u", i);
+				if (structs_diff_elem(d, etype,
+						      (char *)odata +
+						      (i * etype->size),
+						      (char *)ndata +
+						      (i * etype->size),
+						      plen, nbuf) == -1)
+					return (-1);
+			}
+			return (0);
+		}
+
+	case STRUCTS_TYPE_STRUCTURE:
+		{
+			const struct structs_field *field;
+
+			for (field = type->args[0].v;
+			     field->name != NULL; field++) {
+				if (structs_diff_elem(d, field->type,
+						      (char *)odata +
+						      field->offset,
+						      (char *)ndata +
+						      field->offset,
+						      plen, field->name) == -1)
+					return (-1);
+			}
+			return (0);
+		}
+
+	case STRUCTS_TYPE_UNION:
+		{
+			const struct structs_ufield *ofield;
+			const struct structs_ufield *nfield;
+
+			if ((ofield = structs_union_field(type, odata)) == NULL
+			    || (nfield = structs_union_field(type,
+							     ndata)) == NULL)
+				return (-1);
+
+			/* A different field means a whole new union */
+			if (ofield != nfield) {
+				return (structs_diff_add(d, STRUCTS_DIFF_SET,
+							 type, ndata));
+			}
+			return (structs_diff_elem(d, nfield->type,
+						  structs_union_body(type,
+								     odata),
+						  structs_union_body(type,
+								     ndata),
+						  plen, nfield->name));
+		}
+
+	default:
+		assert(0);
+		errno = EDOM;
+		return (-1);
+	}
+}
+
+/*
+ * Find the changes that turn one variable length array into another.
+ */
+static int structs_diff_array(struct structs_diff_info *d,
+			      const struct structs_type *type,
+			      const void *odata, const void *ndata,
+			      size_t plen)
+{
+	const struct structs_type *const etype = type->args[0].v;
+	const struct structs_array *const oary = odata;
+	const struct structs_array *const nary = ndata;
+	const unsigned int min = MIN(oary->length, nary->length);
+	char nbuf[STRUCTS_INDEX_BUFSIZE];
+	unsigned int prefix;
+	unsigned int suffix;
+	unsigned int olen;
+	unsigned int nlen;
+	unsigned int i;
+
+#define OELEM(i)	((char *)oary->elems + ((i) * etype->size))
+#define NELEM(i)	((char *)nary->elems + ((i) * etype->size))
+
+	/* Skip unchanged elements at both ends */
+	for (prefix = 0; prefix < min
+	     && (*etype->equal) (etype, OELEM(prefix), NELEM(prefix)) == 1;
+	     prefix++) ;
+	for (suffix = 0; suffix < min - prefix
+	     && (*etype->equal) (etype,
+				 OELEM(oary->length - 1 - suffix),
+				 NELEM(nary->length - 1 - suffix)) == 1;
+	     suffix++) ;
+	olen = oary->length - prefix - suffix;
+	nlen = nary->length - prefix - suffix;
+
+	/* Diff the elements that remain in both */
+	for (i = prefix; i < prefix + MIN(olen, nlen); i++) {
+		snprintf(nbuf, sizeof(nbuf), "%u", i);
+		if (structs_diff_elem(d, etype, OELEM(i), NELEM(i),
+				      plen, nbuf) == -1)
+			return (-1);
+	}
+
+	/* Delete old elements, or insert new ones */
+	for (; olen > nlen; olen--) {
+		snprintf(nbuf, sizeof(nbuf), "%u", i);
+		if (structs_diff_name(d, plen, nbuf) == -1
+		    || structs_diff_add(d, STRUCTS_DIFF_DELETE,
+					NULL, NULL) == -1)
+			return (-1);
+	}
+	for (; nlen > olen; nlen--, i++) {
+		snprintf(nbuf, sizeof(nbuf), "%u", i);
+		if (structs_diff_name(d, plen, nbuf) == -1
+		    || structs_diff_add(d, STRUCTS_DIFF_INSERT,
+					etype, NELEM(i)) == -1)
+			return (-1);
+	}
+	d->path[plen] = '\0';
+
+#undef OELEM
+#undef NELEM
+
+	/* Done */
+	return (0);
+}
+
+/*
+ * Find the changes that turn one sub-element into another.
+ */
+static int structs_diff_elem(struct structs_diff_info *d,
+			     const struct structs_type *type,
+			     const void *odata, const void *ndata,
+			     size_t plen, const char *name)
+{
+	int r;
+
+	if (structs_diff_name(d, plen, name) == -1)
+		return (-1);
+	r = structs_diff_sub(d, type, odata, ndata, strlen(d->path));
+	d->path[plen] = '\0';
+	return (r);
+}
+
+/*
+ * Add a change for the item named by d->path to the diff.
+ */
+static int structs_diff_add(struct structs_diff_info *d, int op,
+			    const struct structs_type *type,
+			    const void *data)
+{
+	struct structs_diff *const diff = d->diff;
+	struct structs_change *change;
+	char *name;
+
+	/* Add a new change to the end of the list */
+	if ((name = structs_mem_strdup(d->path)) == NULL)
+		return (-1);
+	if (structs_array_insert(&structs_type_diff, NULL,
+				 diff->length, diff) == -1) {
+		structs_mem_free(name);
+		return (-1);
+	}
+	change = &diff->elems[diff->length - 1];
+	structs_mem_free(change->name);
+	change->name = name;
+	change->op = op;
+
+	/* Encode the new value */
+	if (data != NULL
+	    && (*type->encode) (type, &change->value, data) == -1) {
+		const int errno_save = errno;
+
+		structs_array_delete(&structs_type_diff, NULL,
+				     diff->length - 1, diff);
+		errno = errno_save;
+		return (-1);
+	}
+	return (0);
+}
+
+/*
+ * Set d->path to the first "plen" characters of itself followed
+ * by the name of a sub-element.
+ */
+static int structs_diff_name(struct structs_diff_info *d, size_t plen,
+			     const char *name)
+{
+	const size_t nlen = strlen(name);
+	size_t len = plen;
+
+	/* Grow buffer as necessary */
+	if (plen + 1 + nlen + 1 > d->palloc) {
+		size_t new_alloc;
+		char *mem;
+
+		for (new_alloc = d->palloc * 2;
+		     plen + 1 + nlen + 1 > new_alloc; new_alloc *= 2) ;
+		if ((mem = structs_mem_realloc(d->path, new_alloc)) == NULL)
+			return (-1);
+		d->path = mem;
+		d->palloc = new_alloc;
+	}
+
+	/* Append name */
+	if (plen > 0)
+		d->path[len++] = STRUCTS_SEPARATOR;
+	memcpy(d->path + len, name, nlen + 1);
+	return (0);
+}
+
+/*
+ * Split the name of an array element into the name of the array,
+ * which is returned in an allocated buffer, and the element's index.
+ *
+ * Returns NULL (and sets errno) if there was an error.
+ */
+static char *structs_patch_array(const char *name, unsigned int *indexp)
+{
+	const char *s;
+	unsigned long index;
+	char *aname;
+	char *eptr;
+
+	/* The index is the last name component */
+	if ((s = strrchr(name, STRUCTS_SEPARATOR)) == NULL)
+		s = name;
+	else
+		s++;
+	index = strtoul(s, &eptr, 10);
+	if (!isdigit((unsigned char)*s) || *eptr != '\0' || index > UINT_MAX) {
+		errno = EINVAL;
+		return (NULL);
+	}
+
+	/* The array is everything before it */
+	if ((aname = structs_mem_malloc(s - name + 1)) == NULL)
+		return (NULL);
+	memcpy(aname, name, s - name);
+	aname[s > name ? s - name - 1 : 0] = '\0';
+	*indexp = index;
+	return (aname);
+}
+
+/*******************************************************************************
+ * END OF FILE
+ ******************************************************************************/
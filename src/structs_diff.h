@@ -0,0 +1,85 @@
+#ifndef _STRUCTS_DIFF_H_
+#define _STRUCTS_DIFF_H_
+
+/*******************************************************************************
+ * STRUCTURAL DIFF AND PATCH
+ ******************************************************************************/
+
+/*
+ * structs_diff() finds the changes that turn one instance of a type into
+ * another, and structs_patch() applies them, so that an updated data
+ * structure can be replicated by sending only what changed.
+ *
+ * A diff is a list of changes, each naming one item (in the same way as
+ * structs_get() and friends do) and carrying the item's new value in its
+ * binary encoding (see structs_get_binary()). The changes are:
+ *
+ *  STRUCTS_DIFF_SET     Set item "name" to "value"
+ *  STRUCTS_DIFF_INSERT  Insert array element "name" (e.g., "list.3")
+ *                       and set it to "value"
+ *  STRUCTS_DIFF_DELETE  Delete array element "name"; "value" is empty
+ *
+ * Changes are applied in order, and array indicies refer to the array
+ * as it is when the change is applied.
+ *
+ * Only primitive items, unions that select a different field, and array
+ * elements that were inserted are sent in full; structures, fixed length
+ * arrays and unions that select the same field are compared item by item.
+ * Array elements are matched up by skipping the longest unchanged prefix
+ * and suffix, so inserting or deleting a run of elements anywhere in an
+ * array costs only the elements inserted or deleted.
+ *
+ * A diff is itself a structs data structure of type "structs_type_diff",
+ * so it may be encoded for transmission using structs_get_binary() (or
+ * XML, etc.) and decoded with structs_set_binary() into a diff that was
+ * initialized using structs_init().
+ */
+
+/* Change operations */
+#define STRUCTS_DIFF_SET	0	/* set item to new value */
+#define STRUCTS_DIFF_INSERT	1	/* insert array element */
+#define STRUCTS_DIFF_DELETE	2	/* delete array element */
+
+/* One change in a diff */
+struct structs_change {
+	char *name;		/* name of item changed */
+	u_int8_t op;		/* STRUCTS_DIFF_* */
+	struct structs_data value;	/* new value, binary encoded */
+};
+
+/* A diff: the list of changes */
+DEFINE_STRUCTS_VARRAY(structs_diff, struct structs_change);
+
+/* The structs type for a 'struct structs_diff' */
+extern const struct structs_type structs_type_diff;
+
+/*
+ * Find the changes that turn "odata" into "ndata", both of which are
+ * instances of "type", and put them in "diff", which this initializes.
+ * Pointers are followed transparently, as with structs_walk().
+ *
+ * Returns 0 if successful, or -1 (and sets errno) if there was an error.
+ * The caller must free "diff" using structs_free() when done.
+ */
+extern int structs_diff(const struct structs_type *type, const void *odata,
+			const void *ndata, struct structs_diff *diff);
+
+/*
+ * Apply the changes in "diff" to "data", an instance of "type".
+ *
+ * If "data" is equal to the "odata" the diff was made from, it will be
+ * equal to "ndata" afterwards; otherwise the result is unspecified, but
+ * "data" is still a valid instance of "type".
+ *
+ * Returns 0 if successful, or -1 (and sets errno, and puts an error
+ * message in "ebuf") if there was an error, in which case some of the
+ * changes may have been applied.
+ */
+extern int structs_patch(const struct structs_type *type, void *data,
+			 const struct structs_diff *diff,
+			 char *ebuf, size_t emax);
+
+#endif /* _STRUCTS_DIFF_H_ */
+/*******************************************************************************
+ * END OF FILE
+ ******************************************************************************/
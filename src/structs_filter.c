@@ -17,6 +17,7 @@
 
 /* Module Includes */
 #include "structs.h"
+#include "structs_alloc.h"
 #include "structs_type_array.h"
 #include "structs_filter.h"
 
@@ -62,7 +63,7 @@ FILE *filter_fopen(struct filter *filter, int flags, FILE * fp,
 		return (NULL);
 	}
 
-	if ((fs = calloc(1, sizeof(*fs))) == NULL)
+	if ((fs = structs_mem_calloc(1, sizeof(*fs))) == NULL)
 		return (NULL);
 
 	memset(fs, 0, sizeof(*fs));
@@ -73,7 +74,7 @@ FILE *filter_fopen(struct filter *filter, int flags, FILE * fp,
 
 	fp = fopencookie(fs, mode, io_funcs);
 	if (fp == NULL) {
-		free(fs);
+		structs_mem_free(fs);
 		return (NULL);
 	}
 
@@ -166,7 +167,7 @@ static int filter_stream_close(void *cookie)
 		filter_destroy(&fs->filter);
 
 	/* Done */
-	free(fs);
+	structs_mem_free(fs);
 	return (0);
 }
 
@@ -186,7 +187,7 @@ int filter_process(struct filter *filter, const void *input, int ilen,
 
 	/* Allocate buffer big enough to hold filter output */
 	olen = filter_convert(filter, ilen, 1) + 10;
-	if ((*outputp = calloc(1, olen)) == NULL)
+	if ((*outputp = structs_mem_calloc(1, olen)) == NULL)
 		return (-1);
 
 	/* Filter data */
@@ -215,7 +216,7 @@ int filter_process(struct filter *filter, const void *input, int ilen,
 	return (r);
 
 fail:
-	free(*outputp);
+	structs_mem_free(*outputp);
 	*outputp = NULL;
 	return (-1);
 }
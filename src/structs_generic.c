@@ -4,16 +4,21 @@
 
 /* Standard Includes */
 #include <sys/types.h>
+#include <sys/param.h>
 #include <endian.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <stdint.h>
+#include <limits.h>
 #include <string.h>
 #include <errno.h>
 
 /* Module Includes */
 #include "structs.h"
+#include "structs_alloc.h"
 #include "structs_type_array.h"
+#include "structs_internal.h"
 
 /*******************************************************************************
  * MACROS/VARIABLES
@@ -23,6 +28,9 @@
 #error BYTE_ORDER is undefined
 #endif
 
+/* Smallest buffer allocated by an encoder */
+#define STRUCTS_ENCODER_MINSIZE	64
+
 /*******************************************************************************
  * FUNCTION DEFINITIONS
  ******************************************************************************/
@@ -46,10 +54,36 @@ int structs_region_equal(const struct structs_type *type,
 	return (memcmp(v1, v2, type->size) == 0);
 }
 
+int structs_region_compare(const struct structs_type *type,
+			   const void *v1, const void *v2)
+{
+	return (memcmp(v1, v2, type->size));
+}
+
+uint64_t structs_region_hash(const struct structs_type *type,
+			     const void *data)
+{
+	return (structs_hash_bytes(STRUCTS_HASH_INIT, data, type->size));
+}
+
+/*
+ * FNV-1a hash.
+ */
+uint64_t structs_hash_bytes(uint64_t hash, const void *data, size_t len)
+{
+	const unsigned char *p = data;
+
+	while (len-- > 0) {
+		hash ^= *p++;
+		hash *= 0x100000001b3ULL;
+	}
+	return (hash);
+}
+
 int structs_region_encode(const struct structs_type *type,
 			  struct structs_data *code, const void *data)
 {
-	if ((code->data = calloc(1, type->size)) == NULL)
+	if ((code->data = structs_mem_calloc(1, type->size)) == NULL)
 		return (-1);
 	memcpy(code->data, data, type->size);
 	code->length = type->size;
@@ -89,6 +123,34 @@ int structs_region_encode_netorder(const struct structs_type *type,
 	return (0);
 }
 
+int structs_region_encode_into(const struct structs_type *type,
+			       struct structs_encoder *enc, const void *data)
+{
+	return (structs_encoder_append(enc, data, type->size));
+}
+
+int structs_region_encode_netorder_into(const struct structs_type *type,
+					struct structs_encoder *enc,
+					const void *data)
+{
+	unsigned char *code;
+
+	if ((code = structs_encoder_reserve(enc, type->size)) == NULL)
+		return (-1);
+#if BYTE_ORDER == LITTLE_ENDIAN
+	{
+		const unsigned char *const bytes = data;
+		unsigned int i;
+
+		for (i = 0; i < type->size; i++)
+			code[i] = bytes[type->size - 1 - i];
+	}
+#else
+	memcpy(code, data, type->size);
+#endif
+	return (0);
+}
+
 int structs_region_decode_netorder(const struct structs_type *type,
 				   const unsigned char *code, size_t cmax,
 				   void *data, char *ebuf, size_t emax)
@@ -177,16 +239,77 @@ void structs_nothing_free(const struct structs_type *type, void *data)
 int structs_ascii_copy(const struct structs_type *type,
 		       const void *from, void *to)
 {
+	char buf[STRUCTS_ASCII_BUFSIZE];
 	char *ascii;
 	int rtn;
 
-	if ((ascii = (*type->ascify) (type, from)) == NULL)
+	if ((ascii = structs_ascify_buf(type, from, buf, sizeof(buf))) == NULL)
 		return (-1);
 	rtn = (*type->binify) (type, ascii, to, NULL, 0);
-	free(ascii);
+	if (ascii != buf)
+		structs_mem_free(ascii);
 	return (rtn);
 }
 
+int structs_encoder_encode(const struct structs_type *type,
+			   struct structs_data *code, const void *data)
+{
+	struct structs_encoder enc;
+
+	memset(&enc, 0, sizeof(enc));
+	if (structs_encode_into(type, &enc, data) == -1
+	    || structs_encoder_reserve(&enc, 0) == NULL) {
+		structs_mem_free(enc.data);
+		return (-1);
+	}
+	if (enc.length > UINT_MAX) {
+		structs_mem_free(enc.data);
+		errno = E2BIG;
+		return (-1);
+	}
+	code->data = enc.data;
+	code->length = enc.length;
+	return (0);
+}
+
+unsigned char *structs_encoder_reserve(struct structs_encoder *enc,
+				       size_t len)
+{
+	unsigned char *data;
+	size_t size;
+
+	/* Grow the buffer geometrically if needed */
+	if (len > SIZE_MAX - enc->length) {
+		errno = ENOMEM;
+		return (NULL);
+	}
+	if (enc->data == NULL || enc->length + len > enc->size) {
+		size = enc->size <= SIZE_MAX / 2 ? enc->size * 2 : SIZE_MAX;
+		size = MAX(size, enc->length + len);
+		size = MAX(size, STRUCTS_ENCODER_MINSIZE);
+		if ((data = structs_mem_realloc(enc->data, size)) == NULL)
+			return (NULL);
+		enc->data = data;
+		enc->size = size;
+	}
+
+	/* Take the next "len" bytes */
+	data = enc->data + enc->length;
+	enc->length += len;
+	return (data);
+}
+
+int structs_encoder_append(struct structs_encoder *enc,
+			   const void *data, size_t len)
+{
+	unsigned char *code;
+
+	if ((code = structs_encoder_reserve(enc, len)) == NULL)
+		return (-1);
+	memcpy(code, data, len);
+	return (0);
+}
+
 /*******************************************************************************
  * END OF FILE
  ******************************************************************************/
@@ -0,0 +1,325 @@
+#ifndef _STRUCTS_INTERNAL_H_
+#define _STRUCTS_INTERNAL_H_
+
+/*******************************************************************************
+ * LIBRARY PRIVATE DEFINITIONS
+ ******************************************************************************/
+
+/*
+ * Nothing in this file is part of the public API; it is shared only
+ * between the structs library modules.
+ */
+
+/* Read-only pseudo-field "length" of arrays and fixed arrays */
+extern const struct structs_type structs_type_array_length;
+
+/* Read-only pseudo-field "field_name" of unions */
+extern const struct structs_type structs_type_union_field_name;
+
+/*
+ * Make room in an array for at least "nitems" elements. Arrays that
+ * track their capacity grow geometrically; others are reallocated to
+ * exactly "nitems" elements.
+ *
+ * Returns -1 (and sets errno) if there was an error.
+ */
+extern int structs_array_grow(const struct structs_type *type, void *data,
+			      unsigned int nitems);
+
+/*
+ * Function that processes elements "start" through "end - 1" of an
+ * array for structs_parallel_run(). Returns 0 if successful, 1 to stop
+ * processing because the result is already known, or -1 (usually
+ * setting errno) to stop processing because of an error.
+ */
+typedef int structs_range_t(void *arg, unsigned int start, unsigned int end);
+
+/*
+ * Process "nitems" array elements using "func", splitting them between
+ * the calling thread and the thread pool (see structs_parallel.h) if
+ * there is one, there are enough elements, and the current allocator
+ * is the default one.
+ *
+ * If "func" fails for any range, no more ranges are started, "undo"
+ * (if not NULL) is called by the calling thread for each range that
+ * was completed, and -1 is returned with errno set as "func" set it.
+ * Otherwise, if "func" returns 1 for any range, no more ranges are
+ * started and 1 is returned, leaving errno alone. Otherwise, returns 0.
+ */
+extern int structs_parallel_run(unsigned int nitems, structs_range_t *func,
+				structs_range_t *undo, void *arg);
+
+/*
+ * Like asprintf(3), but using the current allocator.
+ */
+extern int structs_mem_asprintf(char **ret, const char *fmt, ...);
+
+/* Size of stack buffers used to ascify primitive values */
+#define STRUCTS_ASCII_BUFSIZE	128
+
+/*
+ * Ascify an item into "buf" using the type's "ascify_into" method,
+ * or its "ascify" method if it doesn't have one. Returns the same
+ * as the "ascify_into" method.
+ */
+extern int structs_ascify_into(const struct structs_type *type,
+			       const void *data, char *buf, size_t bufmax);
+
+/*
+ * Encode an item into "enc" using the type's "encode_into" method,
+ * or its "encode" method if it doesn't have one. Returns the same
+ * as the "encode_into" method.
+ */
+extern int structs_encode_into(const struct structs_type *type,
+			       struct structs_encoder *enc, const void *data);
+
+/*
+ * Ascify an item into "buf" if it fits, otherwise into a newly
+ * allocated buffer. The caller must free the returned string
+ * if it is not "buf".
+ *
+ * Returns NULL (and sets errno) if there was an error.
+ */
+extern char *structs_ascify_buf(const struct structs_type *type,
+				const void *data, char *buf, size_t bufmax);
+
+/*
+ * Compare or hash an item using the type's "compare" or "hash" method,
+ * or its binary encoding if it doesn't have one. Errors are reported
+ * the same way as by those methods.
+ */
+extern int structs_compare_item(const struct structs_type *type,
+				const void *data1, const void *data2);
+extern uint64_t structs_hash_item(const struct structs_type *type,
+				  const void *data);
+
+/*
+ * Like structs_find(), but with flags:
+ *
+ *  STRUCTS_FIND_UNION    Switch unions to the fields in "name", as
+ *                        structs_find() does when "set_union" is true
+ *  STRUCTS_FIND_UNSHARE  Give copy-on-write pointers on the way to the
+ *                        item private referents (see structs_type_cow.h)
+ */
+#define STRUCTS_FIND_UNION	0x01
+#define STRUCTS_FIND_UNSHARE	0x02
+
+extern const struct structs_type *structs_find_flags(const struct
+						     structs_type *type,
+						     const char *name,
+						     const void **datap,
+						     int flags);
+
+/*
+ * If "type" is a copy-on-write pointer type and the pointer at "data"
+ * shares its referent with other pointers, point it at a private copy.
+ * Does nothing for other pointer types.
+ *
+ * Returns -1 (and sets errno) if there was an error.
+ */
+extern int structs_cow_pointer_unshare(const struct structs_type *type,
+				       void *data);
+
+/* Size of a buffer big enough for any array index */
+#define STRUCTS_INDEX_BUFSIZE	24
+
+/*
+ * Get the "index"th sub-element of an item: an array element,
+ * structure field, the selected union field, or a pointer's referent
+ * (whose name is the empty string). Callers must iterate "index"
+ * upward from zero and stop at the first index that doesn't exist.
+ *
+ * Array element names are formatted into "nbuf", which must have
+ * size STRUCTS_INDEX_BUFSIZE.
+ *
+ * Returns 1 and sets *namep, *typep and *datap if the sub-element
+ * exists, 0 if it doesn't, or -1 (and sets errno) if there was an error.
+ */
+extern int structs_child(const struct structs_type *type, const void *data,
+			 unsigned int index, char *nbuf, const char **namep,
+			 const struct structs_type **typep,
+			 const void **datap);
+
+/*
+ * Get the field currently in use in a union, and its contents.
+ *
+ * structs_union_field() returns NULL (and sets errno) if the union
+ * is corrupt.
+ */
+extern const struct structs_ufield *structs_union_field(const struct
+							structs_type *type,
+							const void *data);
+extern void *structs_union_body(const struct structs_type *type,
+				const void *data);
+
+/*
+ * Get a pointer to the name of the field currently in use in a union.
+ *
+ * Returns NULL (and sets errno) if the union is corrupt.
+ */
+extern const char *const *structs_union_namep(const struct structs_type *type,
+					      const void *data);
+
+/* Fields of inline unions up to this size are switched without allocating */
+#define STRUCTS_UNION_BUFSIZE	256
+
+/* Room for building the new contents of an inline union field */
+typedef union structs_union_buf {
+	char buf[STRUCTS_UNION_BUFSIZE];
+	void *ptr;		/* for alignment */
+	long double ld;		/* for alignment */
+} structs_union_buf_t;
+
+/*
+ * Create new, initialized contents for a union field, apart from any union.
+ * If the union is inline and the field fits, they are built in "ubuf";
+ * otherwise they are allocated.
+ *
+ * Returns NULL (and sets errno) if there was an error.
+ */
+extern void *structs_union_new(const struct structs_type *type,
+			       const struct structs_ufield *field,
+			       structs_union_buf_t *ubuf);
+
+/*
+ * Free contents created by structs_union_new().
+ */
+extern void structs_union_discard(const struct structs_ufield *field,
+				  void *new_un, structs_union_buf_t *ubuf);
+
+/*
+ * Switch a union to "field", freeing the old field and replacing it with
+ * "new_un", which must have been created by structs_union_new() for the
+ * same field and "ubuf". This can't fail.
+ *
+ * Returns a pointer to the new field contents, which for inline unions
+ * are moved into the union.
+ */
+extern void *structs_union_replace(const struct structs_type *type,
+				   void *data,
+				   const struct structs_ufield *field,
+				   void *new_un, structs_union_buf_t *ubuf);
+
+/*
+ * Execution plan for a structure type: the structure's init, copy,
+ * equal and uninit methods compiled into flat instruction lists,
+ * with nested structures expanded and plain memory fields merged.
+ */
+struct structs_plan;
+
+/*
+ * Compile the execution plan for a structure type that uses the
+ * standard structure methods.
+ *
+ * Returns NULL (and sets errno) if there was an error.
+ */
+extern struct structs_plan *structs_plan_compile(const struct structs_type
+						 *type);
+
+/*
+ * Destroy an execution plan and set *planp to NULL.
+ */
+extern void structs_plan_destroy(struct structs_plan **planp);
+
+/*
+ * Execute a plan. These behave exactly like structs_struct_init(),
+ * structs_struct_copy(), structs_struct_equal() and structs_struct_free()
+ * respectively for the type the plan was compiled from.
+ */
+extern int structs_plan_init(const struct structs_plan *plan,
+			     const struct structs_type *type, void *data);
+extern int structs_plan_copy(const struct structs_plan *plan,
+			     const struct structs_type *type,
+			     const void *from, void *to);
+extern int structs_plan_equal(const struct structs_plan *plan,
+			      const void *v1, const void *v2);
+extern void structs_plan_free(const struct structs_plan *plan,
+			      const struct structs_type *type, void *data);
+
+/*
+ * Flags for types whose methods act on their memory as a single block,
+ * as structs_region_init(), structs_region_copy(), structs_region_equal()
+ * and structs_nothing_free() do. A structure only qualifies if all of its
+ * fields do; for STRUCTS_POD_EQUAL it also must have no padding.
+ *
+ * STRUCTS_POD_INIT and STRUCTS_POD_COPY are only set for types that
+ * are also STRUCTS_POD_FREE, so a failed operation never needs un-doing.
+ */
+#define STRUCTS_POD_INIT	0x01	/* init just zeroes the item */
+#define STRUCTS_POD_COPY	0x02	/* copy is just memcpy() */
+#define STRUCTS_POD_EQUAL	0x04	/* equal is just memcmp() */
+#define STRUCTS_POD_FREE	0x08	/* uninit need not be called */
+
+/*
+ * Information computed once per structs type and cached for the
+ * life of the program (or until structs_cleanup() is called).
+ */
+struct structs_typeinfo {
+	const struct structs_type *type;	/* the type described */
+	struct structs_typeinfo *next;	/* next entry in hash bucket */
+	unsigned int nfields;	/* number of structure/union fields */
+	unsigned int max_seps;	/* most separators in any field name */
+	unsigned int fmask;	/* field name hash table size minus one */
+	int *ftable;		/* field name hash table (field indicies) */
+	int *ptable;		/* same, but keyed by name pointer */
+	int pod;		/* STRUCTS_POD_* flags */
+	struct structs_plan *plan;	/* structure execution plan, or NULL */
+	void *dflt;		/* default instance, created on first use */
+};
+
+/*
+ * Get the cached information for a type, building it on first use.
+ *
+ * Returns NULL (and sets errno) if there was an error.
+ */
+extern const struct structs_typeinfo *structs_typeinfo_get(const struct
+							   structs_type *type);
+
+/*
+ * Get the STRUCTS_POD_* flags for a type.
+ *
+ * Returns zero if they can't be determined; errno is not changed.
+ */
+extern int structs_pod_flags(const struct structs_type *type);
+
+/*
+ * Get the default (i.e., newly initialized) instance of a type. It is
+ * created on first use, shared by all threads, and must not be modified.
+ *
+ * Returns NULL (and sets errno) if there was an error.
+ */
+extern const void *structs_default(const struct structs_type *type);
+
+/*
+ * Look up a structure or union field whose name is exactly the
+ * first "len" characters of "name".
+ *
+ * Returns the field index, or -1 and sets errno to ENOENT.
+ */
+extern int structs_field_lookup(const struct structs_type *type,
+				const char *name, size_t len);
+
+/*
+ * Get the index of the structure or union field named "name", which is
+ * usually the field's own name pointer (as for a union's field_name).
+ * That case takes constant time; otherwise, the name is looked up.
+ *
+ * Returns the field index, or -1 and sets errno to ENOENT.
+ */
+extern int structs_field_index(const struct structs_type *type,
+			       const char *name);
+
+/*
+ * Look up the structure or union field named by the leading component(s)
+ * of "name", allowing for field names that contain the separator.
+ *
+ * Returns the field index and sets *nextp to the rest of "name" (or NULL),
+ * or returns -1 and sets errno to ENOENT.
+ */
+extern int structs_field_find(const struct structs_type *type,
+			      const char *name, const char **nextp);
+
+#endif /* _STRUCTS_INTERNAL_H_ */
+/*******************************************************************************
+ * END OF FILE
+ ******************************************************************************/
@@ -22,9 +22,11 @@
 
 /* Module Includes */
 #include "structs.h"
+#include "structs_alloc.h"
 #include "structs_type_array.h"
 #include "structs_type_struct.h"
 #include "structs_type_union.h"
+#include "structs_internal.h"
 
 /*******************************************************************************
  * MACROS/VARIABLES
@@ -129,22 +131,20 @@ static int structs_json_output_sub(const struct structs_type *type,
 	switch (type->tclass) {
 	case STRUCTS_TYPE_UNION:
 		{
-			const struct structs_union *const un = data;
-			const struct structs_ufield *const fields =
-			    type->args[0].v;
 			const struct structs_ufield *field;
 			json_t *jsonu;
 
 			/* Find field */
-			for (field = fields; field->name != NULL
-			     && strcmp(un->field_name, field->name) != 0;
-			     field++) ;
-			if (field->name == NULL)
-				assert(0);
+			if ((field = structs_union_field(type, data)) == NULL) {
+				r = -1;
+				break;
+			}
 
 			jsonu = json_object();
 			/* Output chosen union field */
-			r = structs_json_output_sub(field->type, un->un,
+			r = structs_json_output_sub(field->type,
+						    structs_union_body(type,
+								       data),
 						    field->name, jsonu, elems);
 			if (r == -1) {
 				json_decref(jsonu);
@@ -245,10 +245,12 @@ static int structs_json_output_sub(const struct structs_type *type,
 
 	case STRUCTS_TYPE_PRIMITIVE:
 		{
+			char buf[STRUCTS_ASCII_BUFSIZE];
 			char *ascii;
 
 			/* Get ascii string */
-			if ((ascii = (*type->ascify) (type, data)) == NULL)
+			if ((ascii = structs_ascify_buf(type, data, buf,
+							sizeof(buf))) == NULL)
 				return (-1);
 
 			if ((strstr(type->name, "int") != NULL) ||
@@ -269,7 +271,8 @@ static int structs_json_output_sub(const struct structs_type *type,
 				P_JSON_SET(json, tag, json_string(ascii));
 			}
 
-			free(ascii);
+			if (ascii != buf)
+				structs_mem_free(ascii);
 			break;
 		}
 
@@ -316,7 +319,7 @@ int structs_json_input(const struct structs_type *type,
 	data_init = 1;
 
 	/* Allocate info structure */
-	if ((info = calloc(1, sizeof(*info))) == NULL) {
+	if ((info = structs_mem_calloc(1, sizeof(*info))) == NULL) {
 		esave = errno;
 		(*logger) (LOG_ERR, "%s: %s", "calloc", strerror(errno));
 		errno = esave;
@@ -353,7 +356,7 @@ done:
 	if (info != NULL) {
 		while (info->depth >= 0)
 			structs_json_input_pop(info);
-		free(info);
+		structs_mem_free(info);
 	}
 
 	/* If error, free initialized data */
@@ -394,7 +397,8 @@ static void structs_json_input_data(struct json_input_info *info, json_t * obj)
 			}
 			if ((info->depth > 0) &&
 			    (info->stack[info->depth - 1].name != NULL)) {
-				free(info->stack[info->depth - 1].name);
+				structs_mem_free
+				    (info->stack[info->depth - 1].name);
 				info->stack[info->depth - 1].name = NULL;
 			}
 		}
@@ -447,7 +451,7 @@ static void structs_json_input_start(struct json_input_info *info,
 		return;
 
 	if (key != NULL) {
-		if ((mem = calloc(1, key_len + 1)) == NULL) {
+		if ((mem = structs_mem_calloc(1, key_len + 1)) == NULL) {
 			info->error = errno;
 			(*info->logger) (LOG_ERR, "%s: %s", "calloc",
 					 strerror(errno));
@@ -463,7 +467,7 @@ static void structs_json_input_start(struct json_input_info *info,
 		}
 		struct json_input_stackframe *const last_frame =
 		    &info->stack[info->depth - 1];
-		frame->name = strdup(last_frame->name);
+		frame->name = structs_mem_strdup(last_frame->name);
 	}
 
 	/* Handle the top level structure specially */
@@ -491,7 +495,7 @@ static void structs_json_input_start(struct json_input_info *info,
 	    (type->tclass == STRUCTS_TYPE_FIXEDARRAY))
 		return;
 done:
-	free(frame->name);
+	structs_mem_free(frame->name);
 	frame->name = NULL;
 	return;
 }
@@ -521,7 +525,7 @@ static void structs_json_input_next(struct json_input_info *info,
 			void *mem;
 
 			/* Get temporary region for newly initialized array */
-			if ((mem = calloc(1, type->size)) == NULL) {
+			if ((mem = structs_mem_calloc(1, type->size)) == NULL) {
 				info->error = errno;
 				(*info->logger) (LOG_ERR, "%s: %s",
 						 "error initializing new array",
@@ -535,14 +539,14 @@ static void structs_json_input_next(struct json_input_info *info,
 				(*info->logger) (LOG_ERR, "%s: %s",
 						 "error initializing new array",
 						 strerror(errno));
-				free(mem);
+				structs_mem_free(mem);
 				return;
 			}
 
 			/* Replace existing array with fresh one */
 			(*type->uninit) (type, data);
 			memcpy(data, mem, type->size);
-			free(mem);
+			structs_mem_free(mem);
 
 			/* Remember that we're on the first element */
 			info->stack[info->depth + 1].index = 0;
@@ -585,8 +589,9 @@ static void structs_json_input_nest(struct json_input_info *info,
 			type = frame->type;
 			data = frame->data;
 			if ((type =
-			     structs_find(type, name, (const void **)&data,
-					  1)) == NULL) {
+			     structs_find_flags(type, name, (const void **)&data,
+					  STRUCTS_FIND_UNION
+					  | STRUCTS_FIND_UNSHARE)) == NULL) {
 				if (errno == ENOENT) {
 					(*info->logger) (LOG_ERR,
 							 "element \"%s\" is not"
@@ -610,19 +615,15 @@ static void structs_json_input_nest(struct json_input_info *info,
 			    frame->type->args[0].v;
 			const char *elem_name = frame->type->args[1].s;
 			struct structs_array *const ary = frame->data;
-			void *mem;
 
 			/* Expand the array by one */
-			if ((mem =
-			     realloc(ary->elems,
-				     (ary->length + 1) * etype->size)) ==
-			    NULL) {
+			if (structs_array_grow(frame->type, ary,
+					       ary->length + 1) == -1) {
 				info->error = errno;
 				(*info->logger) (LOG_ERR, "%s: %s",
 						 "realloc", strerror(errno));
 				return;
 			}
-			ary->elems = mem;
 
 			/* Initialize the new element */
 			memset((char *)ary->elems + (ary->length * etype->size),
@@ -696,7 +697,8 @@ static void structs_json_input_str_value(struct json_input_info *info,
 		return;
 
 	/* Expand buffer and append character data */
-	if ((mem = realloc(frame->value, frame->value_len + len + 1)) == NULL) {
+	if ((mem = structs_mem_realloc(frame->value,
+				       frame->value_len + len + 1)) == NULL) {
 		info->error = errno;
 		(*info->logger) (LOG_ERR, "%s: %s", "realloc", strerror(errno));
 		return;
@@ -757,8 +759,8 @@ static void structs_json_input_unnest(struct json_input_info *info)
 			}
 
 			/* Point at the field instead of the union */
+			data = structs_union_body(type, data);
 			type = field->type;
-			data = ((const struct structs_union *)data)->un;
 
 			/* FALLTHROUGH */
 		}
@@ -801,7 +803,7 @@ static void structs_json_input_pop(struct json_input_info *info)
 	assert(info->depth >= 0);
 	struct json_input_stackframe *const frame = &info->stack[info->depth];
 	if (frame->value != NULL)
-		free(frame->value);
+		structs_mem_free(frame->value);
 	memset(frame, 0, sizeof(*frame));
 	info->depth--;
 }
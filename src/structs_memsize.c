@@ -0,0 +1,526 @@
+/*******************************************************************************
+ * HEADERS
+ ******************************************************************************/
+
+/* Standard Includes */
+#include <sys/types.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+
+/* Module Includes */
+#include "structs.h"
+#include "structs_alloc.h"
+#include "structs_memsize.h"
+#include "structs_internal.h"
+
+/*******************************************************************************
+ * MACROS/VARIABLES
+ ******************************************************************************/
+
+/* Alignment of blocks returned by a typical malloc(3) */
+#define STRUCTS_MEMSIZE_ALIGN	(2 * sizeof(size_t))
+
+/* Smallest block a typical malloc(3) returns */
+#define STRUCTS_MEMSIZE_MIN	(2 * STRUCTS_MEMSIZE_ALIGN)
+
+/* Initial size of hash tables */
+#define STRUCTS_MEMSIZE_MIN_HASH	64
+
+/* Empty slot in a hash table */
+#define STRUCTS_MEMSIZE_EMPTY	(-1)
+
+/* Hash a block address */
+#define STRUCTS_MEMSIZE_PHASH(ptr)					\
+	((uint32_t)(((uintptr_t)(ptr) >> 4) * 2654435761U))
+
+/* Census lines, indexed by name */
+struct structs_memtally {
+	struct structs_memstat *list;	/* lines in the order added */
+	unsigned int len;	/* number of lines */
+	unsigned int alloc;	/* allocated length of "list" */
+	int *index;		/* hash table of line indicies */
+	unsigned int mask;	/* hash table size minus one */
+};
+
+/* Census state */
+struct structs_memsize_info {
+	struct structs_memstats *stats;	/* census being taken */
+	struct structs_memtally types;	/* bytes by type name */
+	struct structs_memtally prefixes;	/* bytes by path prefix */
+	const void **seen;	/* hash table of blocks already counted */
+	unsigned int nseen;	/* number of blocks in "seen" */
+	unsigned int smask;	/* size of "seen" minus one */
+	size_t cur;		/* bytes held by the current item */
+	int error;		/* errno from counting a block, or zero */
+	char *path;		/* name of the current item */
+	size_t palloc;		/* allocated size of "path" */
+};
+
+/*******************************************************************************
+ * FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+static int structs_memsize_sub(struct structs_memsize_info *m,
+			       const struct structs_type *type,
+			       const void *data, size_t plen,
+			       size_t *bytesp, unsigned long *countp);
+static int structs_memsize_item(struct structs_memsize_info *m,
+				const struct structs_type *type,
+				const void *data, size_t *bytesp);
+static structs_memblock_t structs_memsize_block;
+static int structs_memsize_seen(struct structs_memsize_info *m,
+				const void *block);
+static int structs_memsize_top(struct structs_memsize_info *m,
+			       size_t bytes, unsigned long count);
+static int structs_memsize_name(struct structs_memsize_info *m, size_t plen,
+				const char *name);
+static int structs_memtally_add(struct structs_memtally *t, const char *name,
+				size_t len, size_t bytes);
+static void structs_memtally_finish(struct structs_memtally *t,
+				   struct structs_memstat **listp,
+				   unsigned int *lenp);
+static void structs_memtally_free(struct structs_memtally *t);
+static int structs_memstat_cmp(const void *v1, const void *v2);
+static size_t structs_memsize_estimate(size_t size);
+static uint32_t structs_memsize_hash(const char *name, size_t len);
+
+/*******************************************************************************
+ * FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+int structs_memsize(const struct structs_type *type, const void *data,
+		    struct structs_memstats *stats)
+{
+	struct structs_memsize_info m;
+	unsigned long count;
+	size_t bytes;
+	int r;
+
+	/* Initialize census */
+	memset(&m, 0, sizeof(m));
+	stats->size = type->size;
+	stats->requested = 0;
+	stats->bytes = 0;
+	stats->blocks = 0;
+	stats->types = stats->prefixes = stats->top = NULL;
+	stats->ntypes = stats->nprefixes = stats->ntop = 0;
+	m.stats = stats;
+	if (stats->max_top > 0
+	    && (stats->top = structs_mem_malloc(stats->max_top
+						* sizeof(*stats->top))) == NULL)
+		return (-1);
+	m.palloc = 64;
+	if ((m.path = structs_mem_malloc(m.palloc)) == NULL) {
+		r = -1;
+		goto done;
+	}
+	*m.path = '\0';
+
+	/* Count everything */
+	r = structs_memsize_sub(&m, type, data, 0, &bytes, &count);
+
+done:
+	/* Fill in the lists */
+	structs_memtally_finish(&m.types, &stats->types, &stats->ntypes);
+	structs_memtally_finish(&m.prefixes,
+				&stats->prefixes, &stats->nprefixes);
+	structs_mem_free(m.seen);
+	structs_mem_free(m.path);
+	if (r == -1) {
+		const int errno_save = errno;
+
+		structs_memstats_free(stats);
+		errno = errno_save;
+	}
+	return (r);
+}
+
+void structs_memstats_free(struct structs_memstats *stats)
+{
+	unsigned int i;
+
+	for (i = 0; i < stats->ntypes; i++)
+		structs_mem_free(stats->types[i].name);
+	for (i = 0; i < stats->nprefixes; i++)
+		structs_mem_free(stats->prefixes[i].name);
+	for (i = 0; i < stats->ntop; i++)
+		structs_mem_free(stats->top[i].name);
+	structs_mem_free(stats->types);
+	structs_mem_free(stats->prefixes);
+	structs_mem_free(stats->top);
+	stats->types = stats->prefixes = stats->top = NULL;
+	stats->ntypes = stats->nprefixes = stats->ntop = 0;
+}
+
+/*
+ * Count an item and its sub-elements, whose name is in m->path and
+ * is "plen" characters long.
+ */
+static int structs_memsize_sub(struct structs_memsize_info *m,
+			       const struct structs_type *type,
+			       const void *data, size_t plen,
+			       size_t *bytesp, unsigned long *countp)
+{
+	char nbuf[STRUCTS_INDEX_BUFSIZE];
+	const struct structs_type *etype;
+	const void *edata;
+	const char *ename;
+	unsigned long ecount;
+	unsigned long count = 1;
+	size_t ebytes;
+	size_t bytes = 0;
+	unsigned int i;
+	int r;
+
+	/* Count this item, and any pointer(s) leading to it */
+	for (;;) {
+		if (structs_memsize_item(m, type, data, &ebytes) == -1)
+			return (-1);
+		bytes += ebytes;
+		if (type->tclass != STRUCTS_TYPE_POINTER)
+			break;
+		type = type->args[0].v;
+		data = *((void **)data);
+	}
+
+	/* Count sub-elements */
+	for (i = 0; (r = structs_child(type, data, i, nbuf, &ename,
+				       &etype, &edata)) == 1; i++) {
+		if (structs_memsize_name(m, plen, ename) == -1)
+			return (-1);
+		if (structs_memsize_sub(m, etype, edata, strlen(m->path),
+					&ebytes, &ecount) == -1)
+			return (-1);
+		m->path[plen] = '\0';
+		bytes += ebytes;
+		count += ecount;
+	}
+	if (r == -1)
+		return (-1);
+
+	/* Maybe it's one of the heaviest */
+	if (plen > 0 && structs_memsize_top(m, bytes, count) == -1)
+		return (-1);
+
+	/* Done */
+	*bytesp = bytes;
+	*countp = count;
+	return (0);
+}
+
+/*
+ * Count the blocks held directly by an item.
+ */
+static int structs_memsize_item(struct structs_memsize_info *m,
+				const struct structs_type *type,
+				const void *data, size_t *bytesp)
+{
+	const unsigned int depth = m->stats->depth;
+	const char *s;
+	unsigned int i;
+
+	/* Get the item's blocks */
+	m->cur = 0;
+	if (type->memsize != NULL)
+		(*type->memsize) (type, data, structs_memsize_block, m);
+	if (m->error != 0) {
+		errno = m->error;
+		return (-1);
+	}
+
+	/* Add them up by type */
+	if (structs_memtally_add(&m->types, type->name,
+				 strlen(type->name), m->cur) == -1)
+		return (-1);
+
+	/* Add them up by prefix */
+	if (depth > 0) {
+		for (s = m->path, i = 0;
+		     (s = strchr(s, STRUCTS_SEPARATOR)) != NULL
+		     && ++i < depth; s++) ;
+		if (structs_memtally_add(&m->prefixes, m->path,
+					 s != NULL ? (size_t)(s - m->path) :
+					 strlen(m->path), m->cur) == -1)
+			return (-1);
+	}
+
+	/* Done */
+	*bytesp = m->cur;
+	return (0);
+}
+
+/*
+ * Count a block reported by a "memsize" method, unless it's
+ * already been counted.
+ */
+static void structs_memsize_block(void *arg, const void *block, size_t size)
+{
+	struct structs_memsize_info *const m = arg;
+	const size_t bytes = structs_memsize_estimate(size);
+
+	if (m->error != 0)
+		return;
+	switch (structs_memsize_seen(m, block)) {
+	case -1:
+		m->error = errno;
+		return;
+	case 1:
+		return;
+	default:
+		break;
+	}
+	m->stats->requested += size;
+	m->stats->bytes += bytes;
+	m->stats->blocks++;
+	m->cur += bytes;
+}
+
+/*
+ * Check whether a block has been seen before, and remember it if not.
+ *
+ * Returns 1 if it was seen, 0 if not, or -1 (and sets errno) if error.
+ */
+static int structs_memsize_seen(struct structs_memsize_info *m,
+				const void *block)
+{
+	uint32_t h;
+
+	/* Grow the table as necessary */
+	if (2 * (m->nseen + 1) > m->smask + 1 || m->seen == NULL) {
+		const unsigned int size = m->seen == NULL ?
+		    STRUCTS_MEMSIZE_MIN_HASH : 2 * (m->smask + 1);
+		const void **seen;
+		unsigned int i;
+
+		if ((seen = structs_mem_calloc(size, sizeof(*seen))) == NULL)
+			return (-1);
+		for (i = 0; m->seen != NULL && i <= m->smask; i++) {
+			if (m->seen[i] == NULL)
+				continue;
+			for (h = STRUCTS_MEMSIZE_PHASH(m->seen[i]) & (size - 1);
+			     seen[h] != NULL; h = (h + 1) & (size - 1)) ;
+			seen[h] = m->seen[i];
+		}
+		structs_mem_free(m->seen);
+		m->seen = seen;
+		m->smask = size - 1;
+	}
+
+	/* Look for the block, adding it if not found */
+	for (h = STRUCTS_MEMSIZE_PHASH(block) & m->smask;
+	     m->seen[h] != NULL; h = (h + 1) & m->smask) {
+		if (m->seen[h] == block)
+			return (1);
+	}
+	m->seen[h] = block;
+	m->nseen++;
+	return (0);
+}
+
+/*
+ * Add the current item to the heaviest subtrees if it's heavy enough.
+ */
+static int structs_memsize_top(struct structs_memsize_info *m,
+			       size_t bytes, unsigned long count)
+{
+	struct structs_memstats *const stats = m->stats;
+	char *name;
+	unsigned int i;
+
+	/* Is it heavy enough? */
+	if (stats->ntop == stats->max_top
+	    && (stats->ntop == 0 || bytes <= stats->top[stats->ntop - 1].bytes))
+		return (0);
+
+	/* Copy its name */
+	if ((name = structs_mem_strdup(m->path)) == NULL)
+		return (-1);
+
+	/* Drop the lightest if the list is full */
+	if (stats->ntop == stats->max_top)
+		structs_mem_free(stats->top[--stats->ntop].name);
+
+	/* Insert it in order */
+	for (i = stats->ntop; i > 0 && stats->top[i - 1].bytes < bytes; i--)
+		stats->top[i] = stats->top[i - 1];
+	stats->top[i].name = name;
+	stats->top[i].count = count;
+	stats->top[i].bytes = bytes;
+	stats->ntop++;
+	return (0);
+}
+
+/*
+ * Set m->path to the first "plen" characters of itself followed
+ * by the name of a sub-element.
+ */
+static int structs_memsize_name(struct structs_memsize_info *m, size_t plen,
+				const char *name)
+{
+	const size_t nlen = strlen(name);
+	size_t len = plen;
+
+	/* Grow buffer as necessary */
+	if (plen + 1 + nlen + 1 > m->palloc) {
+		size_t new_alloc;
+		char *mem;
+
+		for (new_alloc = m->palloc * 2;
+		     plen + 1 + nlen + 1 > new_alloc; new_alloc *= 2) ;
+		if ((mem = structs_mem_realloc(m->path, new_alloc)) == NULL)
+			return (-1);
+		m->path = mem;
+		m->palloc = new_alloc;
+	}
+
+	/* Append name */
+	if (len > 0)
+		m->path[len++] = STRUCTS_SEPARATOR;
+	memcpy(m->path + len, name, nlen + 1);
+	return (0);
+}
+
+/*
+ * Add an item holding "bytes" bytes to the census line named by the
+ * first "len" characters of "name".
+ */
+static int structs_memtally_add(struct structs_memtally *t, const char *name,
+				size_t len, size_t bytes)
+{
+	struct structs_memstat *line;
+	uint32_t h;
+	int i;
+
+	/* Grow the index as necessary */
+	if (t->index == NULL || 2 * (t->len + 1) > t->mask + 1) {
+		const unsigned int size = t->index == NULL ?
+		    STRUCTS_MEMSIZE_MIN_HASH : 2 * (t->mask + 1);
+		int *index;
+		unsigned int j;
+
+		if ((index = structs_mem_malloc(size * sizeof(*index))) == NULL)
+			return (-1);
+		for (j = 0; j < size; j++)
+			index[j] = STRUCTS_MEMSIZE_EMPTY;
+		for (j = 0; j < t->len; j++) {
+			line = &t->list[j];
+			for (h = structs_memsize_hash(line->name,
+						      strlen(line->name))
+			     & (size - 1); index[h] != STRUCTS_MEMSIZE_EMPTY;
+			     h = (h + 1) & (size - 1)) ;
+			index[h] = j;
+		}
+		structs_mem_free(t->index);
+		t->index = index;
+		t->mask = size - 1;
+	}
+
+	/* Look for an existing line */
+	for (h = structs_memsize_hash(name, len) & t->mask;
+	     (i = t->index[h]) != STRUCTS_MEMSIZE_EMPTY;
+	     h = (h + 1) & t->mask) {
+		line = &t->list[i];
+		if (strncmp(line->name, name, len) == 0
+		    && line->name[len] == '\0')
+			goto found;
+	}
+
+	/* Add a new one */
+	if (t->len == t->alloc) {
+		const unsigned int new_alloc = (t->alloc + 16) * 2;
+		struct structs_memstat *new_list;
+
+		if ((new_list = structs_mem_realloc(t->list,
+					new_alloc * sizeof(*t->list))) == NULL)
+			return (-1);
+		t->list = new_list;
+		t->alloc = new_alloc;
+	}
+	line = &t->list[t->len];
+	if ((line->name = structs_mem_malloc(len + 1)) == NULL)
+		return (-1);
+	memcpy(line->name, name, len);
+	line->name[len] = '\0';
+	line->count = 0;
+	line->bytes = 0;
+	t->index[h] = t->len++;
+
+found:
+	line->count++;
+	line->bytes += bytes;
+	return (0);
+}
+
+/*
+ * Sort the lines of a census and hand them over.
+ */
+static void structs_memtally_finish(struct structs_memtally *t,
+				    struct structs_memstat **listp,
+				    unsigned int *lenp)
+{
+	if (t->len > 0)
+		qsort(t->list, t->len, sizeof(*t->list), structs_memstat_cmp);
+	*listp = t->list;
+	*lenp = t->len;
+	t->list = NULL;
+	t->len = 0;
+	structs_memtally_free(t);
+}
+
+/*
+ * Free a census that wasn't handed over.
+ */
+static void structs_memtally_free(struct structs_memtally *t)
+{
+	while (t->len > 0)
+		structs_mem_free(t->list[--t->len].name);
+	structs_mem_free(t->list);
+	structs_mem_free(t->index);
+	memset(t, 0, sizeof(*t));
+}
+
+/*
+ * Sort census lines from most to fewest bytes, then by name.
+ */
+static int structs_memstat_cmp(const void *v1, const void *v2)
+{
+	const struct structs_memstat *const s1 = v1;
+	const struct structs_memstat *const s2 = v2;
+
+	if (s1->bytes != s2->bytes)
+		return (s1->bytes < s2->bytes ? 1 : -1);
+	return (strcmp(s1->name, s2->name));
+}
+
+/*
+ * Estimate the memory a typical malloc(3) uses for a block.
+ */
+static size_t structs_memsize_estimate(size_t size)
+{
+	size = (size + sizeof(size_t) + STRUCTS_MEMSIZE_ALIGN - 1)
+	    & ~(STRUCTS_MEMSIZE_ALIGN - 1);
+	return (size < STRUCTS_MEMSIZE_MIN ? STRUCTS_MEMSIZE_MIN : size);
+}
+
+/*
+ * FNV-1a hash of a name.
+ */
+static uint32_t structs_memsize_hash(const char *name, size_t len)
+{
+	uint32_t h = 2166136261U;
+
+	while (len-- > 0) {
+		h ^= (unsigned char)*name++;
+		h *= 16777619U;
+	}
+	return (h);
+}
+
+/*******************************************************************************
+ * END OF FILE
+ ******************************************************************************/
@@ -0,0 +1,82 @@
+#ifndef _STRUCTS_MEMSIZE_H_
+#define _STRUCTS_MEMSIZE_H_
+
+/*******************************************************************************
+ * MEMORY CENSUS
+ ******************************************************************************/
+
+/*
+ * structs_memsize() finds how much memory a data structure holds, using
+ * the "memsize" method of each item's type (see structs.h). Each block is
+ * counted at most once, even if it is shared by several items (e.g., the
+ * buffers of copy-on-write and interned strings); the first item found
+ * holding it is charged for it.
+ *
+ * Block sizes are estimates of what a typical malloc(3) actually uses,
+ * i.e., the requested size plus a size word, rounded up to a multiple of
+ * two words. Memory obtained from an arena (see structs_arena.h) has less
+ * overhead than this. Buffers that don't record their own size, such as
+ * those of a 'struct structs_array' or 'struct structs_data', are counted
+ * by their length, though they may have some room to spare; a
+ * 'struct structs_varray' is counted by its capacity.
+ */
+
+/* A line in a memory census */
+struct structs_memstat {
+	char *name;		/* type name or path */
+	unsigned long count;	/* number of items */
+	size_t bytes;		/* estimated bytes held */
+};
+
+/*
+ * Memory census. The caller sets "depth" and "max_top" before calling
+ * structs_memsize(), which fills in the rest.
+ */
+struct structs_memstats {
+	unsigned int depth;	/* path components per prefix, or zero */
+	unsigned int max_top;	/* number of heaviest subtrees wanted */
+	size_t size;		/* size of the top level item itself */
+	size_t requested;	/* bytes requested for all blocks */
+	size_t bytes;		/* estimated bytes used by all blocks */
+	unsigned long blocks;	/* number of blocks */
+	struct structs_memstat *types;	/* bytes held by each type */
+	unsigned int ntypes;	/* length of "types" */
+	struct structs_memstat *prefixes;	/* bytes under each prefix */
+	unsigned int nprefixes;	/* length of "prefixes" */
+	struct structs_memstat *top;	/* heaviest subtrees */
+	unsigned int ntop;	/* length of "top" */
+};
+
+/*
+ * Take a census of the memory held by a data structure.
+ *
+ * "types" lists, for each type name, the number of items of that type
+ * and the bytes held directly by them (not by their sub-elements).
+ *
+ * "prefixes" lists the same, but grouped by the first "depth" components
+ * of the items' names, so that e.g. with a depth of two, everything in
+ * "foo.list" is counted together. If "depth" is zero, "prefixes" is empty.
+ *
+ * "top" lists the "max_top" items (other than the top level item) holding
+ * the most bytes, including those held by their sub-elements; "count" is
+ * the number of items in the subtree.
+ *
+ * All lists are sorted from most to fewest bytes. Pointers are followed
+ * transparently, as with structs_walk(); the blocks they point to are
+ * charged to the pointer type.
+ *
+ * Returns 0 if successful, or -1 (and sets errno) if there was an error.
+ * The lists are allocated; call structs_memstats_free() when done.
+ */
+extern int structs_memsize(const struct structs_type *type, const void *data,
+			   struct structs_memstats *stats);
+
+/*
+ * Free the lists in a memory census.
+ */
+extern void structs_memstats_free(struct structs_memstats *stats);
+
+#endif /* _STRUCTS_MEMSIZE_H_ */
+/*******************************************************************************
+ * END OF FILE
+ ******************************************************************************/
@@ -19,9 +19,11 @@
 
 /* Module Includes */
 #include "structs.h"
+#include "structs_alloc.h"
 #include "structs_type_array.h"
 #include "structs_type_struct.h"
 #include "structs_type_union.h"
+#include "structs_internal.h"
 
 /*******************************************************************************
  * MACROS/VARIABLES
@@ -123,21 +125,18 @@ structs_pack_sub(const struct structs_type *type,
 	switch (type->tclass) {
 	case STRUCTS_TYPE_UNION:
 		{
-			const struct structs_union *const un = data;
-			const struct structs_ufield *const fields =
-			    type->args[0].v;
 			const struct structs_ufield *field;
 
 			/* Find field */
-			for (field = fields; field->name != NULL
-			     && strcmp(un->field_name, field->name) != 0;
-			     field++) ;
-			if (field->name == NULL)
-				assert(0);
+			if ((field = structs_union_field(type, data)) == NULL) {
+				r = -1;
+				break;
+			}
 
 			msgpack_pack_map(pk, 1);
 			/* Output chosen union field */
-			r = structs_pack_sub(field->type, un->un,
+			r = structs_pack_sub(field->type,
+					     structs_union_body(type, data),
 					     field->name, pk, elems, 0);
 			break;
 		}
@@ -213,16 +212,21 @@ structs_pack_sub(const struct structs_type *type,
 
 	case STRUCTS_TYPE_PRIMITIVE:
 		{
+			char buf[STRUCTS_ASCII_BUFSIZE];
 			char *ascii;
+			size_t alen;
 
 			/* Get ascii string */
-			if ((ascii = (*type->ascify) (type, data)) == NULL)
+			if ((ascii = structs_ascify_buf(type, data, buf,
+							sizeof(buf))) == NULL)
 				return (-1);
 
-			msgpack_pack_str(pk, strlen(ascii));
-			msgpack_pack_str_body(pk, ascii, strlen(ascii));
+			alen = strlen(ascii);
+			msgpack_pack_str(pk, alen);
+			msgpack_pack_str_body(pk, ascii, alen);
 
-			free(ascii);
+			if (ascii != buf)
+				structs_mem_free(ascii);
 			break;
 		}
 
@@ -271,7 +275,7 @@ int structs_unpack(const struct structs_type *type,
 	data_init = 1;
 
 	/* Allocate info structure */
-	if ((info = calloc(1, sizeof(*info))) == NULL) {
+	if ((info = structs_mem_calloc(1, sizeof(*info))) == NULL) {
 		esave = errno;
 		(*logger) (LOG_ERR, "%s: %s", "calloc", strerror(errno));
 		errno = esave;
@@ -309,7 +313,7 @@ done:
 	if (info != NULL) {
 		while (info->depth >= 0)
 			structs_unpack_pop(info);
-		free(info);
+		structs_mem_free(info);
 	}
 
 	/* If error, free initialized data */
@@ -341,7 +345,8 @@ static void structs_unpack_object(struct unpack_info *info,
 			}
 			if ((info->depth > 0) &&
 			    (info->stack[info->depth - 1].name != NULL)) {
-				free(info->stack[info->depth - 1].name);
+				structs_mem_free
+				    (info->stack[info->depth - 1].name);
 				info->stack[info->depth - 1].name = NULL;
 			}
 		}
@@ -388,7 +393,7 @@ static void structs_unpack_start(struct unpack_info *info,
 		return;
 
 	if (key != NULL) {
-		if ((mem = calloc(1, key_len + 1)) == NULL) {
+		if ((mem = structs_mem_calloc(1, key_len + 1)) == NULL) {
 			info->error = errno;
 			(*info->logger) (LOG_ERR, "%s: %s", "calloc",
 					 strerror(errno));
@@ -404,7 +409,7 @@ static void structs_unpack_start(struct unpack_info *info,
 		}
 		struct unpack_stackframe *const last_frame =
 		    &info->stack[info->depth - 1];
-		frame->name = strdup(last_frame->name);
+		frame->name = structs_mem_strdup(last_frame->name);
 	}
 
 	/* Handle the top level structure specially */
@@ -432,7 +437,7 @@ static void structs_unpack_start(struct unpack_info *info,
 	    (type->tclass == STRUCTS_TYPE_FIXEDARRAY))
 		return;
 done:
-	free(frame->name);
+	structs_mem_free(frame->name);
 	frame->name = NULL;
 	return;
 }
@@ -462,7 +467,7 @@ static void structs_unpack_next(struct unpack_info *info,
 			void *mem;
 
 			/* Get temporary region for newly initialized array */
-			if ((mem = calloc(1, type->size)) == NULL) {
+			if ((mem = structs_mem_calloc(1, type->size)) == NULL) {
 				info->error = errno;
 				(*info->logger) (LOG_ERR, "%s: %s",
 						 "error initializing new array",
@@ -476,14 +481,14 @@ static void structs_unpack_next(struct unpack_info *info,
 				(*info->logger) (LOG_ERR, "%s: %s",
 						 "error initializing new array",
 						 strerror(errno));
-				free(mem);
+				structs_mem_free(mem);
 				return;
 			}
 
 			/* Replace existing array with fresh one */
 			(*type->uninit) (type, data);
 			memcpy(data, mem, type->size);
-			free(mem);
+			structs_mem_free(mem);
 
 			/* Remember that we're on the first element */
 			info->stack[info->depth + 1].index = 0;
@@ -525,8 +530,9 @@ static void structs_unpack_nest(struct unpack_info *info,
 			type = frame->type;
 			data = frame->data;
 			if ((type =
-			     structs_find(type, name, (const void **)&data,
-					  1)) == NULL) {
+			     structs_find_flags(type, name, (const void **)&data,
+					  STRUCTS_FIND_UNION
+					  | STRUCTS_FIND_UNSHARE)) == NULL) {
 				if (errno == ENOENT) {
 					(*info->logger) (LOG_ERR,
 							 "element \"%s\" is not"
@@ -550,19 +556,15 @@ static void structs_unpack_nest(struct unpack_info *info,
 			    frame->type->args[0].v;
 			const char *elem_name = frame->type->args[1].s;
 			struct structs_array *const ary = frame->data;
-			void *mem;
 
 			/* Expand the array by one */
-			if ((mem =
-			     realloc(ary->elems,
-				     (ary->length + 1) * etype->size)) ==
-			    NULL) {
+			if (structs_array_grow(frame->type, ary,
+					       ary->length + 1) == -1) {
 				info->error = errno;
 				(*info->logger) (LOG_ERR, "%s: %s",
 						 "realloc", strerror(errno));
 				return;
 			}
-			ary->elems = mem;
 
 			/* Initialize the new element */
 			memset((char *)ary->elems + (ary->length * etype->size),
@@ -636,7 +638,8 @@ static void structs_unpack_str_value(struct unpack_info *info,
 		return;
 
 	/* Expand buffer and append character data */
-	if ((mem = realloc(frame->value, frame->value_len + len + 1)) == NULL) {
+	if ((mem = structs_mem_realloc(frame->value,
+				       frame->value_len + len + 1)) == NULL) {
 		info->error = errno;
 		(*info->logger) (LOG_ERR, "%s: %s", "realloc", strerror(errno));
 		return;
@@ -697,8 +700,8 @@ static void structs_unpack_unnest(struct unpack_info *info)
 			}
 
 			/* Point at the field instead of the union */
+			data = structs_union_body(type, data);
 			type = field->type;
-			data = ((const struct structs_union *)data)->un;
 
 			/* FALLTHROUGH */
 		}
@@ -741,7 +744,7 @@ static void structs_unpack_pop(struct unpack_info *info)
 	assert(info->depth >= 0);
 	struct unpack_stackframe *const frame = &info->stack[info->depth];
 	if (frame->value != NULL)
-		free(frame->value);
+		structs_mem_free(frame->value);
 	memset(frame, 0, sizeof(*frame));
 	info->depth--;
 }
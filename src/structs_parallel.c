@@ -0,0 +1,306 @@
+/*******************************************************************************
+ * HEADERS
+ ******************************************************************************/
+
+/* Standard Includes */
+#include <sys/types.h>
+#include <sys/param.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+/* Module Includes */
+#include "structs.h"
+#include "structs_alloc.h"
+#include "structs_parallel.h"
+#include "structs_internal.h"
+
+/*******************************************************************************
+ * MACROS/VARIABLES
+ ******************************************************************************/
+
+/* Most tasks a job is split into */
+#define STRUCTS_PARALLEL_MAX_TASKS	256
+
+/* Tasks per thread, so that threads finishing early can take more */
+#define STRUCTS_PARALLEL_SPLIT		4
+
+/* A job: one call to structs_parallel_run() */
+struct structs_job {
+	structs_range_t *func;	/* function to run on each range */
+	void *arg;		/* argument to "func" */
+	const struct structs_allocator *alloc;	/* caller's allocator */
+	unsigned int nitems;	/* number of elements */
+	unsigned int chunk;	/* elements per task */
+	unsigned int ntasks;	/* number of tasks */
+	unsigned int next;	/* next task to start */
+	unsigned int running;	/* tasks started but not finished */
+	int error;		/* errno from the first failure, or zero */
+	int failed;		/* a task failed */
+	int stopped;		/* a task stopped early */
+	struct structs_job *link;	/* next job waiting for threads */
+	u_char done[STRUCTS_PARALLEL_MAX_TASKS];	/* tasks completed */
+};
+
+/* The thread pool */
+struct structs_pool {
+	pthread_mutex_t mutex;	/* protects everything below */
+	pthread_cond_t work;	/* signaled when a job is added */
+	pthread_cond_t idle;	/* signaled when a task finishes */
+	struct structs_job *jobs;	/* jobs with tasks not yet started */
+	unsigned int grain;	/* fewest elements per task */
+	unsigned int nthreads;	/* number of threads */
+	pthread_t *threads;	/* the threads */
+	int shutdown;		/* threads should exit */
+};
+
+/* The thread pool, if any */
+static struct structs_pool *structs_pool;
+
+/* Whether this thread is running a task */
+static __thread int structs_parallel_busy;
+
+/*******************************************************************************
+ * FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+static void *structs_parallel_main(void *arg);
+static void structs_parallel_task(struct structs_pool *pool,
+				  struct structs_job *job);
+
+/*******************************************************************************
+ * FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+int structs_parallel_start(unsigned int workers, unsigned int grain)
+{
+	struct structs_pool *pool;
+	int errno_save;
+
+	/* Stop the current pool, if any */
+	structs_parallel_stop();
+	if (workers == 0)
+		return (0);
+
+	/* Create the pool */
+	if ((pool = calloc(1, sizeof(*pool))) == NULL)
+		return (-1);
+	pool->grain = grain > 0 ? grain : STRUCTS_PARALLEL_GRAIN;
+	if ((pool->threads = calloc(workers, sizeof(*pool->threads))) == NULL)
+		goto fail1;
+	if ((errno = pthread_mutex_init(&pool->mutex, NULL)) != 0)
+		goto fail2;
+	if ((errno = pthread_cond_init(&pool->work, NULL)) != 0)
+		goto fail3;
+	if ((errno = pthread_cond_init(&pool->idle, NULL)) != 0)
+		goto fail4;
+
+	/* Start the threads */
+	for (pool->nthreads = 0; pool->nthreads < workers; pool->nthreads++) {
+		if ((errno = pthread_create(&pool->threads[pool->nthreads],
+					    NULL, structs_parallel_main,
+					    pool)) != 0) {
+			structs_pool = pool;
+			errno_save = errno;
+			structs_parallel_stop();
+			errno = errno_save;
+			return (-1);
+		}
+	}
+
+	/* Done */
+	structs_pool = pool;
+	return (0);
+
+	/* Clean up after failure */
+fail4:	pthread_cond_destroy(&pool->work);
+fail3:	pthread_mutex_destroy(&pool->mutex);
+fail2:	free(pool->threads);
+fail1:	errno_save = errno;
+	free(pool);
+	errno = errno_save;
+	return (-1);
+}
+
+void structs_parallel_stop(void)
+{
+	struct structs_pool *const pool = structs_pool;
+	unsigned int i;
+	int r;
+
+	if (pool == NULL)
+		return;
+	structs_pool = NULL;
+
+	/* Tell the threads to exit and wait for them */
+	r = pthread_mutex_lock(&pool->mutex);
+	assert(r == 0);
+	pool->shutdown = 1;
+	r = pthread_cond_broadcast(&pool->work);
+	assert(r == 0);
+	r = pthread_mutex_unlock(&pool->mutex);
+	assert(r == 0);
+	for (i = 0; i < pool->nthreads; i++)
+		pthread_join(pool->threads[i], NULL);
+
+	/* Free the pool */
+	pthread_cond_destroy(&pool->idle);
+	pthread_cond_destroy(&pool->work);
+	pthread_mutex_destroy(&pool->mutex);
+	free(pool->threads);
+	free(pool);
+}
+
+/*
+ * Process array elements, in parallel if worthwhile.
+ */
+int structs_parallel_run(unsigned int nitems, structs_range_t *func,
+			 structs_range_t *undo, void *arg)
+{
+	struct structs_pool *const pool = structs_pool;
+	struct structs_job job;
+	struct structs_job **jobp;
+	unsigned int chunk;
+	unsigned int i;
+	int r;
+
+	/*
+	 * Do it ourselves if there is no pool, not enough work, or an
+	 * allocator that might not be safe to use from other threads.
+	 */
+	if (pool == NULL || structs_parallel_busy || nitems < 2 * pool->grain
+	    || structs_get_allocator() != &structs_allocator_default)
+		return ((*func) (arg, 0, nitems));
+
+	/* Split the elements into tasks */
+	chunk = nitems / ((pool->nthreads + 1) * STRUCTS_PARALLEL_SPLIT);
+	chunk = MAX(chunk, pool->grain);
+	chunk = MAX(chunk, (nitems + STRUCTS_PARALLEL_MAX_TASKS - 1)
+		    / STRUCTS_PARALLEL_MAX_TASKS);
+	memset(&job, 0, sizeof(job));
+	job.func = func;
+	job.arg = arg;
+	job.alloc = structs_get_allocator();
+	job.nitems = nitems;
+	job.chunk = chunk;
+	job.ntasks = (nitems + chunk - 1) / chunk;
+
+	/* Hand it to the threads */
+	r = pthread_mutex_lock(&pool->mutex);
+	assert(r == 0);
+	for (jobp = &pool->jobs; *jobp != NULL; jobp = &(*jobp)->link) ;
+	*jobp = &job;
+	r = pthread_cond_broadcast(&pool->work);
+	assert(r == 0);
+
+	/* Help out until all tasks have been started, then wait for them */
+	while (job.next < job.ntasks)
+		structs_parallel_task(pool, &job);
+	while (job.running > 0) {
+		r = pthread_cond_wait(&pool->idle, &pool->mutex);
+		assert(r == 0);
+	}
+	r = pthread_mutex_unlock(&pool->mutex);
+	assert(r == 0);
+	if (!job.failed)
+		return (job.stopped ? 1 : 0);
+
+	/* Un-do the tasks that completed */
+	for (i = 0; undo != NULL && i < job.ntasks; i++) {
+		if (job.done[i]) {
+			(*undo) (arg, i * chunk,
+				 i * chunk + MIN(chunk, nitems - i * chunk));
+		}
+	}
+	errno = job.error;
+	return (-1);
+}
+
+/*
+ * Thread pool thread.
+ */
+static void *structs_parallel_main(void *arg)
+{
+	struct structs_pool *const pool = arg;
+	int r;
+
+	r = pthread_mutex_lock(&pool->mutex);
+	assert(r == 0);
+	while (!pool->shutdown) {
+		if (pool->jobs == NULL) {
+			r = pthread_cond_wait(&pool->work, &pool->mutex);
+			assert(r == 0);
+			continue;
+		}
+		structs_parallel_task(pool, pool->jobs);
+	}
+	r = pthread_mutex_unlock(&pool->mutex);
+	assert(r == 0);
+	return (NULL);
+}
+
+/*
+ * Start the next task of a job and run it to completion.
+ * This is called and returns with the pool mutex locked.
+ */
+static void structs_parallel_task(struct structs_pool *pool,
+				  struct structs_job *job)
+{
+	const struct structs_allocator *prev;
+	const unsigned int task = job->next;
+	const unsigned int start = task * job->chunk;
+	const unsigned int end = start + MIN(job->chunk, job->nitems - start);
+	struct structs_job **jobp;
+	int error = 0;
+	int result;
+	int r;
+
+	/* Take the task, removing the job if it was the last one */
+	if (++job->next == job->ntasks) {
+		for (jobp = &pool->jobs; *jobp != job; jobp = &(*jobp)->link) ;
+		*jobp = job->link;
+	}
+	job->running++;
+
+	/* Run it, using the caller's allocator */
+	r = pthread_mutex_unlock(&pool->mutex);
+	assert(r == 0);
+	prev = structs_set_thread_allocator(job->alloc);
+	structs_parallel_busy = 1;
+	if ((result = (*job->func) (job->arg, start, end)) == -1)
+		error = errno;
+	structs_parallel_busy = 0;
+	structs_set_thread_allocator(prev);
+	r = pthread_mutex_lock(&pool->mutex);
+	assert(r == 0);
+
+	/* Record the result; after a failure or stop, start no more tasks */
+	if (result == 0)
+		job->done[task] = 1;
+	else {
+		if (result == 1)
+			job->stopped = 1;
+		else if (!job->failed) {
+			job->failed = 1;
+			job->error = error;
+		}
+		if (job->next < job->ntasks) {
+			for (jobp = &pool->jobs;
+			     *jobp != job; jobp = &(*jobp)->link) ;
+			*jobp = job->link;
+			job->next = job->ntasks;
+		}
+	}
+	if (--job->running == 0 && job->next == job->ntasks) {
+		r = pthread_cond_broadcast(&pool->idle);
+		assert(r == 0);
+	}
+}
+
+/*******************************************************************************
+ * END OF FILE
+ ******************************************************************************/
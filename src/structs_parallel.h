@@ -0,0 +1,56 @@
+#ifndef _STRUCTS_PARALLEL_H_
+#define _STRUCTS_PARALLEL_H_
+
+/*******************************************************************************
+ * PARALLEL ARRAY OPERATIONS
+ ******************************************************************************/
+
+/*
+ * By default, the structs library does all its work in the calling
+ * thread. After structs_parallel_start(), copying, freeing and comparing
+ * the elements of large variable length arrays is split into tasks of
+ * at least "grain" elements each, which are run by a pool of "workers"
+ * threads, with the calling thread helping out until they are done.
+ * Arrays of fewer than two tasks' worth of elements, arrays whose
+ * elements are plain memory (which are handled all at once anyway),
+ * arrays found while already running a task, and arrays handled while
+ * the current allocator (see structs_alloc.h) is not the default one
+ * are handled by the calling thread as usual. Other allocators, such as
+ * arenas (see structs_arena.h), need not be safe to use from several
+ * threads at once, so they are only ever used by the calling thread.
+ *
+ * The copy, free and equal methods of the element types must be safe
+ * to run in parallel on different elements, as those of the built-in
+ * types are.
+ *
+ * Results, including failure handling, are the same as when done by
+ * the calling thread: if copying any element fails, the elements already
+ * copied are freed and the copy fails with errno set as it was by the
+ * element that failed.
+ */
+
+/* Default number of elements per task */
+#define STRUCTS_PARALLEL_GRAIN	4096
+
+/*
+ * Start a pool of "workers" threads to run array operations, with at
+ * least "grain" elements per task (or STRUCTS_PARALLEL_GRAIN if zero).
+ * If a pool is already running, it is stopped first.
+ *
+ * Returns 0 if successful, or -1 (and sets errno) if there was an error.
+ */
+extern int structs_parallel_start(unsigned int workers, unsigned int grain);
+
+/*
+ * Stop the pool of threads, if any, and go back to doing all work
+ * in the calling thread.
+ *
+ * Neither this nor structs_parallel_start() may be called while any
+ * other thread is using the structs library.
+ */
+extern void structs_parallel_stop(void);
+
+#endif /* _STRUCTS_PARALLEL_H_ */
+/*******************************************************************************
+ * END OF FILE
+ ******************************************************************************/
@@ -0,0 +1,1313 @@
+/*******************************************************************************
+ * HEADERS
+ ******************************************************************************/
+
+/* Standard Includes */
+#include <sys/types.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <assert.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+
+/* Module Includes */
+#include "structs.h"
+#include "structs_alloc.h"
+#include "structs_path.h"
+#include "structs_type_array.h"
+#include "structs_type_struct.h"
+#include "structs_type_union.h"
+#include "structs_internal.h"
+
+/*******************************************************************************
+ * MACROS/VARIABLES
+ ******************************************************************************/
+
+/* Path step operations */
+#define STRUCTS_PATH_OFFSET	0	/* add a constant byte offset */
+#define STRUCTS_PATH_DEREF	1	/* dereference a pointer */
+#define STRUCTS_PATH_INDEX	2	/* index a variable length array */
+#define STRUCTS_PATH_UNION	3	/* descend into a union field */
+#define STRUCTS_PATH_LENGTH	4	/* "length" of a variable length array */
+#define STRUCTS_PATH_CONST	5	/* constant value (fixed array "length") */
+#define STRUCTS_PATH_FIELD_NAME	6	/* "field_name" of a union */
+
+/* One step in a compiled path */
+struct structs_path_step {
+	int op;			/* STRUCTS_PATH_* */
+	const struct structs_type *type;	/* type being stepped into */
+	const struct structs_ufield *field;	/* union field */
+	const void *value;	/* constant pseudo-field value */
+	size_t offset;		/* byte offset, or array element size */
+	unsigned long index;	/* array index */
+};
+
+/* A compiled path */
+struct structs_path {
+	const struct structs_type *type;	/* type compiled against */
+	const struct structs_type *rtype;	/* type of the item referred to */
+	unsigned int nsteps;	/* number of steps */
+	struct structs_path_step steps[];	/* the steps */
+};
+
+/* A node in a path set trie; the root node has no step */
+struct structs_pathset_node {
+	struct structs_path_step step;	/* step from the parent node */
+	int child;		/* first child node, or -1 */
+	int last;		/* last child node, or -1 */
+	int sibling;		/* next sibling node, or -1 */
+	int leaf;		/* first path ending at this node, or -1 */
+};
+
+/* One of the paths in a path set */
+struct structs_pathset_leaf {
+	const struct structs_type *type;	/* type of item, or NULL */
+	int error;		/* why the name could not be compiled */
+	int next;		/* next path ending at the same node, or -1 */
+};
+
+/* A set of paths */
+struct structs_pathset {
+	const struct structs_type *type;	/* type compiled against */
+	int num;		/* number of paths */
+	int nnodes;		/* number of trie nodes */
+	int nalloc;		/* number of trie nodes allocated */
+	struct structs_pathset_node *nodes;	/* trie nodes */
+	struct structs_pathset_leaf *leaves;	/* one per path */
+};
+
+/* A compiled wildcard query */
+struct structs_query {
+	char *prefix;		/* name up to the first wildcard */
+	struct structs_path *path;	/* "prefix" compiled */
+	const struct structs_type *wtype;	/* type wildcard applies to */
+	int nsubs;		/* number of sub-queries */
+	struct structs_query **subs;	/* sub-query per array/field */
+};
+
+/* State while running a query */
+struct structs_query_info {
+	structs_visitor_t *visitor;	/* visitor function */
+	void *arg;		/* visitor argument */
+	char *name;		/* name of current item */
+	size_t len;		/* length of "name" */
+	size_t alloc;		/* allocated size of "name" */
+};
+
+/*******************************************************************************
+ * FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+static struct structs_path_step *structs_path_add(struct structs_path **pathp,
+						  unsigned int *allocp, int op,
+						  const struct structs_type
+						  *type);
+static const struct structs_type *structs_path_exec(const struct structs_path
+						    *path, unsigned int i,
+						    const void **datap,
+						    int flags);
+static int structs_path_apply(const struct structs_path_step *step,
+			      const void **datap, int flags);
+static const struct structs_type *structs_path_switch(const struct
+						      structs_path *path,
+						      unsigned int i,
+						      void *un,
+						      const void **datap,
+						      int flags);
+static int structs_pathset_child(struct structs_pathset *ps, int parent,
+				 const struct structs_path_step *step);
+static void structs_pathset_start(const struct structs_pathset *ps,
+				  char **values, int *errs);
+static int structs_pathset_done(const struct structs_pathset *ps,
+				int *errs, int *errors);
+static void structs_pathset_fail(const struct structs_pathset *ps, int n,
+				 int error, int *errs);
+static void structs_pathset_get(const struct structs_pathset *ps, int n,
+				const void *data, char **values, int *errs);
+static int structs_pathset_set(const struct structs_pathset *ps, int n,
+			       void *data, const char *const *values,
+			       int *errs);
+static int structs_query_exec(struct structs_query_info *info,
+			      const struct structs_query *q,
+			      const void *data, size_t plen);
+static int structs_query_name(struct structs_query_info *info, size_t plen,
+			      const char *name);
+
+/*******************************************************************************
+ * FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+/*
+ * Compile a name into a path.
+ *
+ * This mirrors the name parsing done by structs_find(), but only
+ * records what would be done instead of doing it.
+ */
+struct structs_path *structs_path_compile(const struct structs_type *type,
+					  const char *name)
+{
+	struct structs_path_step *step;
+	struct structs_path *path;
+	unsigned int alloc = 8;
+
+	/* Create path */
+	if ((path = structs_mem_calloc(1, sizeof(*path)
+				       + alloc * sizeof(*step))) == NULL)
+		return (NULL);
+	path->type = type;
+
+	/* Resolve each name component */
+	while (name != NULL && *name != '\0') {
+		const char *next;
+
+		/* Primitive types don't have sub-elements */
+		if (type->tclass == STRUCTS_TYPE_PRIMITIVE)
+			goto not_found;
+
+		/* Dereference through pointer(s) */
+		while (type->tclass == STRUCTS_TYPE_POINTER) {
+			if (structs_path_add(&path, &alloc,
+					     STRUCTS_PATH_DEREF, type) == NULL)
+				goto fail;
+			type = type->args[0].v;
+		}
+
+		/* Get next name component */
+		if ((next = strchr(name, STRUCTS_SEPARATOR)) != NULL)
+			next++;
+
+		/* Find element of aggregate structure */
+		switch (type->tclass) {
+		case STRUCTS_TYPE_ARRAY:
+		case STRUCTS_TYPE_FIXEDARRAY:
+			{
+				const struct structs_type *const etype =
+				    type->args[0].v;
+				unsigned long index;
+				char *eptr;
+
+				/* Special handling for "length" */
+				if (strcmp(name, "length") == 0) {
+					if (type->tclass == STRUCTS_TYPE_ARRAY)
+						step = structs_path_add(&path,
+						    &alloc, STRUCTS_PATH_LENGTH,
+						    type);
+					else if ((step = structs_path_add(&path,
+					    &alloc, STRUCTS_PATH_CONST,
+					    type)) != NULL)
+						step->value = &type->args[2].i;
+					if (step == NULL)
+						goto fail;
+					type = &structs_type_array_length;
+					break;
+				}
+
+				/* Decode an index */
+				index = strtoul(name, &eptr, 10);
+				if (!isdigit(*name)
+				    || eptr == name
+				    || (*eptr != '\0'
+					&& *eptr != STRUCTS_SEPARATOR))
+					goto not_found;
+
+				/* Fixed array elements are at a fixed offset */
+				if (type->tclass == STRUCTS_TYPE_FIXEDARRAY) {
+					if (index >= (unsigned int)type->args[2].i) {
+						errno = EDOM;
+						goto fail;
+					}
+					if ((step = structs_path_add(&path,
+					    &alloc, STRUCTS_PATH_OFFSET,
+					    type)) == NULL)
+						goto fail;
+					step->offset += index * etype->size;
+					type = etype;
+					break;
+				}
+
+				/* Variable length array bounds are checked later */
+				if ((step = structs_path_add(&path, &alloc,
+							     STRUCTS_PATH_INDEX,
+							     type)) == NULL)
+					goto fail;
+				step->index = index;
+				step->offset = etype->size;
+				type = etype;
+				break;
+			}
+		case STRUCTS_TYPE_STRUCTURE:
+			{
+				const struct structs_field *field;
+				int i;
+
+				/* Find the field */
+				if ((i = structs_field_find(type, name,
+							    &next)) == -1)
+					goto fail;
+				field = (const struct structs_field *)
+				    type->args[0].v + i;
+				if ((step = structs_path_add(&path, &alloc,
+							     STRUCTS_PATH_OFFSET,
+							     type)) == NULL)
+					goto fail;
+				step->offset += field->offset;
+				type = field->type;
+				break;
+			}
+		case STRUCTS_TYPE_UNION:
+			{
+				const struct structs_ufield *field;
+				int i;
+
+				/* Special handling for "field_name" */
+				if (strcmp(name, "field_name") == 0) {
+					if (structs_path_add(&path, &alloc,
+					    STRUCTS_PATH_FIELD_NAME,
+					    type) == NULL)
+						goto fail;
+					type = &structs_type_union_field_name;
+					break;
+				}
+
+				/* Find the field */
+				if ((i = structs_field_find(type, name,
+							    &next)) == -1)
+					goto fail;
+				field = (const struct structs_ufield *)
+				    type->args[0].v + i;
+				if ((step = structs_path_add(&path, &alloc,
+							     STRUCTS_PATH_UNION,
+							     type)) == NULL)
+					goto fail;
+				step->field = field;
+				type = field->type;
+				break;
+			}
+		default:
+			goto not_found;
+		}
+
+		/* Go to next name component */
+		name = next;
+	}
+
+	/* Done */
+	path->rtype = type;
+	return (path);
+
+not_found:
+	errno = ENOENT;
+fail:
+	structs_mem_free(path);
+	return (NULL);
+}
+
+/*
+ * Append a step to a path being compiled.
+ *
+ * Consecutive constant offsets are merged into a single step.
+ */
+static struct structs_path_step *structs_path_add(struct structs_path **pathp,
+						  unsigned int *allocp, int op,
+						  const struct structs_type
+						  *type)
+{
+	struct structs_path *path = *pathp;
+	struct structs_path_step *step;
+
+	/* Merge with the previous step if possible */
+	if (op == STRUCTS_PATH_OFFSET && path->nsteps > 0
+	    && path->steps[path->nsteps - 1].op == STRUCTS_PATH_OFFSET)
+		return (&path->steps[path->nsteps - 1]);
+
+	/* Grow steps array as necessary */
+	if (path->nsteps == *allocp) {
+		const unsigned int new_alloc = *allocp * 2;
+
+		if ((path = structs_mem_realloc(path, sizeof(*path)
+				    + new_alloc * sizeof(*step))) == NULL)
+			return (NULL);
+		*pathp = path;
+		*allocp = new_alloc;
+	}
+
+	/* Add new step */
+	step = &path->steps[path->nsteps++];
+	memset(step, 0, sizeof(*step));
+	step->op = op;
+	step->type = type;
+	return (step);
+}
+
+void structs_path_destroy(struct structs_path **pathp)
+{
+	struct structs_path *const path = *pathp;
+
+	if (path == NULL)
+		return;
+	structs_mem_free(path);
+	*pathp = NULL;
+}
+
+const struct structs_type *structs_path_type(const struct structs_path *path)
+{
+	return (path->rtype);
+}
+
+/*
+ * Apply a compiled path.
+ */
+const struct structs_type *structs_path_find(const struct structs_path *path,
+					     const void **datap, int set_union)
+{
+	return (structs_path_exec(path, 0, datap,
+				  set_union ? STRUCTS_FIND_UNION : 0));
+}
+
+/*
+ * Execute the steps of a path starting with step "i", with the same
+ * STRUCTS_FIND_* flags as structs_find_flags().
+ */
+static const struct structs_type *structs_path_exec(const struct structs_path
+						    *path, unsigned int i,
+						    const void **datap,
+						    int flags)
+{
+	const void *data = *datap;
+
+	for (; i < path->nsteps; i++) {
+		switch (structs_path_apply(&path->steps[i], &data, flags)) {
+		case 0:
+			continue;
+		case -1:
+			return (NULL);
+		default:
+			break;
+		}
+
+		/* Is modifying the union acceptable? */
+		if ((flags & STRUCTS_FIND_UNION) == 0) {
+			errno = ENOENT;
+			return (NULL);
+		}
+		*datap = data;
+		return (structs_path_switch(path, i, (void *)data, datap,
+					    flags));
+	}
+
+	/* Done */
+	*datap = data;
+	return (path->rtype);
+}
+
+/*
+ * Apply one step of a path to *datap, unsharing copy-on-write pointers
+ * if "flags" includes STRUCTS_FIND_UNSHARE.
+ *
+ * Returns 0 if successful, 1 if the step is a union field other than
+ * the one currently selected (*datap then still points to the union),
+ * or -1 and sets errno if there was an error.
+ */
+static int structs_path_apply(const struct structs_path_step *step,
+			      const void **datap, int flags)
+{
+	const void *data = *datap;
+
+	switch (step->op) {
+	case STRUCTS_PATH_OFFSET:
+		data = (const char *)data + step->offset;
+		break;
+	case STRUCTS_PATH_DEREF:
+		if ((flags & STRUCTS_FIND_UNSHARE) != 0
+		    && structs_cow_pointer_unshare(step->type,
+						   (void *)data) == -1)
+			return (-1);
+		data = *((void *const *)data);
+		break;
+	case STRUCTS_PATH_INDEX:
+		{
+			const struct structs_array *const ary = data;
+
+			if (step->index >= ary->length) {
+				errno = EDOM;
+				return (-1);
+			}
+			data = (const char *)ary->elems
+			    + (step->index * step->offset);
+			break;
+		}
+	case STRUCTS_PATH_LENGTH:
+		data = &((const struct structs_array *)data)->length;
+		break;
+	case STRUCTS_PATH_CONST:
+		data = step->value;
+		break;
+	case STRUCTS_PATH_FIELD_NAME:
+		if ((data = structs_union_namep(step->type, data)) == NULL)
+			return (-1);
+		break;
+	case STRUCTS_PATH_UNION:
+		{
+			const struct structs_ufield *field;
+
+			/* Check if the union is already set to the field */
+			if ((field = structs_union_field(step->type,
+							 data)) == NULL)
+				return (-1);
+			if (field != step->field)
+				return (1);
+			data = structs_union_body(step->type, data);
+			break;
+		}
+	default:
+		assert(0);
+		errno = EINVAL;
+		return (-1);
+	}
+	*datap = data;
+	return (0);
+}
+
+/*
+ * Switch the union "un" to the field selected by step "i", but only
+ * if the rest of the path can be found in the newly selected field,
+ * which is then found using "flags".
+ */
+static const struct structs_type *structs_path_switch(const struct
+						      structs_path *path,
+						      unsigned int i,
+						      void *un,
+						      const void **datap,
+						      int flags)
+{
+	const struct structs_path_step *const step = &path->steps[i];
+	const struct structs_type *rtype;
+	structs_union_buf_t ubuf;
+	const void *data2;
+	void *new_un;
+	void *body;
+
+	/* Create a new union with the new field type */
+	if ((new_un = structs_union_new(step->type, step->field,
+					&ubuf)) == NULL)
+		return (NULL);
+
+	/* See if the rest of the path would be found with new union */
+	data2 = new_un;
+	if ((rtype = structs_path_exec(path, i + 1, &data2, flags)) == NULL) {
+		structs_union_discard(step->field, new_un, &ubuf);
+		return (NULL);
+	}
+
+	/* Replace the old field; if the new one moved, find the rest again */
+	if ((body = structs_union_replace(step->type, un, step->field,
+					  new_un, &ubuf)) != new_un) {
+		data2 = body;
+		if ((rtype = structs_path_exec(path, i + 1, &data2,
+					       flags)) == NULL)
+			return (NULL);
+	}
+
+	/* Done */
+	*datap = data2;
+	return (rtype);
+}
+
+/*******************************************************************************
+ * COMPILED PATH VERSIONS OF BASIC FUNCTIONS
+ ******************************************************************************/
+
+int structs_equal_path(const struct structs_path *path,
+		       const void *data1, const void *data2)
+{
+	const struct structs_type *type;
+
+	/* Find items */
+	if (structs_path_find(path, &data1, 0) == NULL)
+		return (-1);
+	if ((type = structs_path_find(path, &data2, 0)) == NULL)
+		return (-1);
+
+	/* Compare them */
+	return (structs_equal(type, NULL, data1, data2));
+}
+
+int structs_get_path(const struct structs_path *path,
+		     const void *from, void *to)
+{
+	const struct structs_type *type;
+
+	/* Find item */
+	if ((type = structs_path_find(path, &from, 0)) == NULL)
+		return (-1);
+
+	/* Copy item */
+	return (structs_get(type, NULL, from, to));
+}
+
+int structs_set_path(const struct structs_path *path,
+		     const void *from, void *to)
+{
+	const struct structs_type *type;
+
+	/* Find item */
+	if ((type = structs_path_exec(path, 0, (const void **)&to,
+				      STRUCTS_FIND_UNSHARE)) == NULL)
+		return (-1);
+
+	/* Set item */
+	return (structs_set(type, from, NULL, to));
+}
+
+char *structs_get_string_path(const struct structs_path *path,
+			      const void *data)
+{
+	const struct structs_type *type;
+
+	/* Find item */
+	if ((type = structs_path_find(path, &data, 0)) == NULL)
+		return (NULL);
+
+	/* Ascify it */
+	return (structs_get_string(type, NULL, data));
+}
+
+int structs_set_string_path(const struct structs_path *path,
+			    const char *ascii, void *data, char *ebuf,
+			    size_t emax)
+{
+	const struct structs_type *type;
+
+	/* Find item */
+	if ((type = structs_path_exec(path, 0, (const void **)&data,
+				      STRUCTS_FIND_UNION
+				      | STRUCTS_FIND_UNSHARE)) == NULL) {
+		if (ebuf != NULL && emax > 0)
+			strncpy(ebuf, strerror(errno), emax);
+		return (-1);
+	}
+
+	/* Set it */
+	return (structs_set_string(type, NULL, ascii, data, ebuf, emax));
+}
+
+int structs_get_binary_path(const struct structs_path *path,
+			    const void *data, struct structs_data *code)
+{
+	const struct structs_type *type;
+
+	/* Find item */
+	if ((type = structs_path_find(path, &data, 0)) == NULL) {
+		memset(code, 0, sizeof(*code));
+		return (-1);
+	}
+
+	/* Encode it */
+	return (structs_get_binary(type, NULL, data, code));
+}
+
+int structs_set_binary_path(const struct structs_path *path,
+			    const struct structs_data *code, void *data,
+			    char *ebuf, size_t emax)
+{
+	const struct structs_type *type;
+
+	/* Find item */
+	if ((type = structs_path_exec(path, 0, (const void **)&data,
+				      STRUCTS_FIND_UNSHARE)) == NULL) {
+		if (ebuf != NULL && emax > 0)
+			strncpy(ebuf, strerror(errno), emax);
+		return (-1);
+	}
+
+	/* Decode it */
+	return (structs_set_binary(type, NULL, code, data, ebuf, emax));
+}
+
+/*******************************************************************************
+ * PATH SETS
+ ******************************************************************************/
+
+/*
+ * Create a path set.
+ */
+struct structs_pathset *structs_pathset_create(const struct structs_type
+					       *type, const char *const *names,
+					       int num)
+{
+	struct structs_pathset *ps;
+	int i;
+
+	/* Create path set with a root node */
+	if ((ps = structs_mem_calloc(1, sizeof(*ps))) == NULL)
+		return (NULL);
+	ps->type = type;
+	ps->num = num;
+	if ((ps->leaves = structs_mem_calloc(num > 0 ? num : 1,
+				 sizeof(*ps->leaves))) == NULL)
+		goto fail;
+	if (structs_pathset_child(ps, -1, NULL) == -1)
+		goto fail;
+
+	/* Compile each name and add its steps to the trie */
+	for (i = 0; i < num; i++) {
+		struct structs_pathset_leaf *const leaf = &ps->leaves[i];
+		struct structs_path *path;
+		unsigned int j;
+		int node = 0;
+		int *tailp;
+
+		/* Compile name; remember why if it can't be */
+		leaf->next = -1;
+		if ((path = structs_path_compile(type, names[i])) == NULL) {
+			if (errno == ENOMEM)
+				goto fail;
+			leaf->error = errno;
+			continue;
+		}
+
+		/* Find or add the nodes for the steps */
+		for (j = 0; j < path->nsteps; j++) {
+			if ((node = structs_pathset_child(ps, node,
+							  &path->steps[j])) ==
+			    -1) {
+				structs_path_destroy(&path);
+				goto fail;
+			}
+		}
+
+		/* Add path to the node it ends at */
+		leaf->type = path->rtype;
+		for (tailp = &ps->nodes[node].leaf; *tailp != -1;
+		     tailp = &ps->leaves[*tailp].next) ;
+		*tailp = i;
+		structs_path_destroy(&path);
+	}
+
+	/* Done */
+	return (ps);
+
+fail:
+	structs_pathset_destroy(&ps);
+	return (NULL);
+}
+
+/*
+ * Find or add the child of node "parent" reached by "step".
+ * If "parent" is -1, add the root node.
+ *
+ * Returns the index of the child, or -1 and sets errno.
+ */
+static int structs_pathset_child(struct structs_pathset *ps, int parent,
+				 const struct structs_path_step *step)
+{
+	struct structs_pathset_node *node;
+	int n;
+
+	/* Look for an existing child having the same step */
+	if (parent != -1) {
+		for (n = ps->nodes[parent].child; n != -1;
+		     n = ps->nodes[n].sibling) {
+			const struct structs_path_step *const s =
+			    &ps->nodes[n].step;
+
+			if (s->op == step->op
+			    && s->type == step->type
+			    && s->field == step->field
+			    && s->value == step->value
+			    && s->offset == step->offset
+			    && s->index == step->index)
+				return (n);
+		}
+	}
+
+	/* Grow nodes array as necessary */
+	if (ps->nnodes == ps->nalloc) {
+		const int new_alloc = (ps->nalloc > 0) ? ps->nalloc * 2 : 16;
+		void *mem;
+
+		if ((mem = structs_mem_realloc(ps->nodes,
+				   new_alloc * sizeof(*ps->nodes))) == NULL)
+			return (-1);
+		ps->nodes = mem;
+		ps->nalloc = new_alloc;
+	}
+
+	/* Add new node */
+	n = ps->nnodes++;
+	node = &ps->nodes[n];
+	memset(node, 0, sizeof(*node));
+	if (step != NULL)
+		node->step = *step;
+	node->child = -1;
+	node->last = -1;
+	node->sibling = -1;
+	node->leaf = -1;
+
+	/* Link it in as the parent's last child */
+	if (parent != -1) {
+		if (ps->nodes[parent].last != -1)
+			ps->nodes[ps->nodes[parent].last].sibling = n;
+		else
+			ps->nodes[parent].child = n;
+		ps->nodes[parent].last = n;
+	}
+	return (n);
+}
+
+void structs_pathset_destroy(struct structs_pathset **psp)
+{
+	struct structs_pathset *const ps = *psp;
+
+	if (ps == NULL)
+		return;
+	structs_mem_free(ps->nodes);
+	structs_mem_free(ps->leaves);
+	structs_mem_free(ps);
+	*psp = NULL;
+}
+
+int structs_get_many_pathset(const struct structs_pathset *ps,
+			     const void *data, char **values, int *errors)
+{
+	int *errs = errors;
+	int nfail;
+
+	/* Initialize results */
+	if (errs == NULL
+	    && (errs = structs_mem_calloc(ps->num > 0 ? ps->num : 1,
+			      sizeof(*errs))) == NULL)
+		return (-1);
+	structs_pathset_start(ps, values, errs);
+
+	/* Get values */
+	structs_pathset_get(ps, 0, data, values, errs);
+
+	/* Done */
+	nfail = structs_pathset_done(ps, errs, errors);
+	return (nfail);
+}
+
+int structs_set_many_pathset(const struct structs_pathset *ps,
+			     const char *const *values, void *data,
+			     int *errors)
+{
+	int *errs = errors;
+	int nfail;
+
+	/* Initialize results */
+	if (errs == NULL
+	    && (errs = structs_mem_calloc(ps->num > 0 ? ps->num : 1,
+			      sizeof(*errs))) == NULL)
+		return (-1);
+	structs_pathset_start(ps, NULL, errs);
+
+	/* Set values */
+	structs_pathset_set(ps, 0, data, values, errs);
+
+	/* Done */
+	nfail = structs_pathset_done(ps, errs, errors);
+	return (nfail);
+}
+
+int structs_get_many(const struct structs_type *type,
+		     const char *const *names, int num, const void *data,
+		     char **values, int *errors)
+{
+	struct structs_pathset *ps;
+	int r;
+
+	if ((ps = structs_pathset_create(type, names, num)) == NULL)
+		return (-1);
+	r = structs_get_many_pathset(ps, data, values, errors);
+	structs_pathset_destroy(&ps);
+	return (r);
+}
+
+int structs_set_many(const struct structs_type *type,
+		     const char *const *names, const char *const *values,
+		     int num, void *data, int *errors)
+{
+	struct structs_pathset *ps;
+	int r;
+
+	if ((ps = structs_pathset_create(type, names, num)) == NULL)
+		return (-1);
+	r = structs_set_many_pathset(ps, values, data, errors);
+	structs_pathset_destroy(&ps);
+	return (r);
+}
+
+/*
+ * Initialize the results of a get or set operation.
+ */
+static void structs_pathset_start(const struct structs_pathset *ps,
+				  char **values, int *errs)
+{
+	int i;
+
+	for (i = 0; i < ps->num; i++) {
+		if (values != NULL)
+			values[i] = NULL;
+		errs[i] = (ps->leaves[i].type == NULL) ?
+		    ps->leaves[i].error : 0;
+	}
+}
+
+/*
+ * Count the failures of a get or set operation and free
+ * the error array if it was allocated by us.
+ */
+static int structs_pathset_done(const struct structs_pathset *ps,
+				int *errs, int *errors)
+{
+	int nfail = 0;
+	int i;
+
+	for (i = 0; i < ps->num; i++) {
+		if (errs[i] != 0)
+			nfail++;
+	}
+	if (errs != errors)
+		structs_mem_free(errs);
+	return (nfail);
+}
+
+/*
+ * Mark all paths at or below a node that have not already failed
+ * as failed with error "error".
+ */
+static void structs_pathset_fail(const struct structs_pathset *ps, int n,
+				 int error, int *errs)
+{
+	int i;
+
+	for (i = ps->nodes[n].leaf; i != -1; i = ps->leaves[i].next) {
+		if (errs[i] == 0)
+			errs[i] = error;
+	}
+	for (n = ps->nodes[n].child; n != -1; n = ps->nodes[n].sibling)
+		structs_pathset_fail(ps, n, error, errs);
+}
+
+/*
+ * Get the values of all paths at or below a node.
+ */
+static void structs_pathset_get(const struct structs_pathset *ps, int n,
+				const void *data, char **values, int *errs)
+{
+	int i;
+
+	/* Get values of paths ending here */
+	for (i = ps->nodes[n].leaf; i != -1; i = ps->leaves[i].next) {
+		if ((values[i] = structs_get_string(ps->leaves[i].type,
+						    NULL, data)) == NULL)
+			errs[i] = errno;
+	}
+
+	/* Descend into children */
+	for (n = ps->nodes[n].child; n != -1; n = ps->nodes[n].sibling) {
+		const void *cdata = data;
+
+		switch (structs_path_apply(&ps->nodes[n].step, &cdata, 0)) {
+		case 0:
+			structs_pathset_get(ps, n, cdata, values, errs);
+			break;
+		case 1:
+			structs_pathset_fail(ps, n, ENOENT, errs);
+			break;
+		default:
+			structs_pathset_fail(ps, n, errno, errs);
+			break;
+		}
+	}
+}
+
+/*
+ * Set the values of all paths at or below a node, switching unions
+ * to the selected fields as structs_set_string() would.
+ *
+ * Returns the number of paths that were found.
+ */
+static int structs_pathset_set(const struct structs_pathset *ps, int n,
+			       void *data, const char *const *values,
+			       int *errs)
+{
+	int found = 0;
+	int i;
+
+	/* Set values of paths ending here */
+	for (i = ps->nodes[n].leaf; i != -1; i = ps->leaves[i].next) {
+		found++;
+		if (structs_set_string(ps->leaves[i].type, NULL,
+				       values[i], data, NULL, 0) == -1)
+			errs[i] = (errno != 0) ? errno : EINVAL;
+	}
+
+	/* Descend into children */
+	for (n = ps->nodes[n].child; n != -1; n = ps->nodes[n].sibling) {
+		const struct structs_path_step *const step = &ps->nodes[n].step;
+		const void *cdata = data;
+		structs_union_buf_t ubuf;
+		void *new_un;
+		int nfound;
+
+		switch (structs_path_apply(step, &cdata,
+					   STRUCTS_FIND_UNSHARE)) {
+		case 0:
+			found += structs_pathset_set(ps, n, (void *)cdata,
+						     values, errs);
+			break;
+		case 1:
+			/* Switch union only if something is found in it */
+			if ((new_un = structs_union_new(step->type,
+							step->field,
+							&ubuf)) == NULL) {
+				structs_pathset_fail(ps, n, errno, errs);
+				break;
+			}
+			if ((nfound = structs_pathset_set(ps, n, new_un,
+							  values, errs)) == 0) {
+				structs_union_discard(step->field, new_un,
+						      &ubuf);
+				break;
+			}
+			structs_union_replace(step->type, (void *)cdata,
+					      step->field, new_un, &ubuf);
+			found += nfound;
+			break;
+		default:
+			structs_pathset_fail(ps, n, errno, errs);
+			break;
+		}
+	}
+
+	/* Done */
+	return (found);
+}
+
+/*******************************************************************************
+ * WILDCARD QUERIES
+ ******************************************************************************/
+
+/*
+ * Compile a query.
+ */
+struct structs_query *structs_query_compile(const struct structs_type *type,
+					    const char *pattern)
+{
+	const struct structs_type *wtype;
+	struct structs_query *q;
+	const char *rest = NULL;
+	const char *end;
+	const char *s;
+	size_t plen;
+	int i;
+
+	/* Find the first wildcard component, if any */
+	if (pattern == NULL)
+		pattern = "";
+	for (s = pattern;; s = end + 1) {
+		if ((end = strchr(s, STRUCTS_SEPARATOR)) == NULL)
+			end = s + strlen(s);
+		if (end - s == 1 && *s == STRUCTS_QUERY_WILDCARD) {
+			rest = (*end != '\0') ? end + 1 : "";
+			break;
+		}
+		if (*end == '\0')
+			break;
+	}
+	if (rest != NULL)
+		plen = (s > pattern) ? (size_t)(s - pattern) - 1 : 0;
+	else
+		plen = strlen(pattern);
+
+	/* Create query and compile the part before the wildcard */
+	if ((q = structs_mem_calloc(1, sizeof(*q))) == NULL)
+		return (NULL);
+	if ((q->prefix = structs_mem_malloc(plen + 1)) == NULL)
+		goto fail;
+	memcpy(q->prefix, pattern, plen);
+	q->prefix[plen] = '\0';
+	if ((q->path = structs_path_compile(type, q->prefix)) == NULL)
+		goto fail;
+
+	/* Done if there is no wildcard */
+	if (rest == NULL)
+		return (q);
+
+	/* Dereference through pointer(s) */
+	for (wtype = q->path->rtype; wtype->tclass == STRUCTS_TYPE_POINTER;
+	     wtype = wtype->args[0].v) ;
+	q->wtype = wtype;
+
+	/* Compile the rest of the pattern for each possible sub-element */
+	switch (wtype->tclass) {
+	case STRUCTS_TYPE_ARRAY:
+	case STRUCTS_TYPE_FIXEDARRAY:
+		q->nsubs = 1;
+		break;
+	case STRUCTS_TYPE_STRUCTURE:
+	case STRUCTS_TYPE_UNION:
+		{
+			const struct structs_typeinfo *info;
+
+			if ((info = structs_typeinfo_get(wtype)) == NULL)
+				goto fail;
+			q->nsubs = info->nfields;
+			break;
+		}
+	default:
+		errno = ENOENT;
+		goto fail;
+	}
+	if ((q->subs = structs_mem_calloc(q->nsubs > 0 ? q->nsubs : 1,
+			      sizeof(*q->subs))) == NULL)
+		goto fail;
+	for (i = 0; i < q->nsubs; i++) {
+		const struct structs_type *etype;
+
+		switch (wtype->tclass) {
+		case STRUCTS_TYPE_ARRAY:
+		case STRUCTS_TYPE_FIXEDARRAY:
+			etype = wtype->args[0].v;
+			break;
+		case STRUCTS_TYPE_STRUCTURE:
+			etype = ((const struct structs_field *)
+				 wtype->args[0].v)[i].type;
+			break;
+		default:
+			etype = ((const struct structs_ufield *)
+				 wtype->args[0].v)[i].type;
+			break;
+		}
+		if ((q->subs[i] = structs_query_compile(etype, rest)) != NULL)
+			continue;
+
+		/* Fields in which the rest can't be found are skipped */
+		if ((errno != ENOENT && errno != EDOM)
+		    || wtype->tclass == STRUCTS_TYPE_ARRAY
+		    || wtype->tclass == STRUCTS_TYPE_FIXEDARRAY)
+			goto fail;
+	}
+
+	/* At least one field must match */
+	for (i = 0; i < q->nsubs && q->subs[i] == NULL; i++) ;
+	if (i == q->nsubs) {
+		errno = ENOENT;
+		goto fail;
+	}
+
+	/* Done */
+	return (q);
+
+fail:
+	structs_query_destroy(&q);
+	return (NULL);
+}
+
+void structs_query_destroy(struct structs_query **qp)
+{
+	struct structs_query *const q = *qp;
+	int i;
+
+	if (q == NULL)
+		return;
+	for (i = 0; i < q->nsubs; i++)
+		structs_query_destroy(&q->subs[i]);
+	structs_mem_free(q->subs);
+	structs_path_destroy(&q->path);
+	structs_mem_free(q->prefix);
+	structs_mem_free(q);
+	*qp = NULL;
+}
+
+int structs_query_apply(const struct structs_query *q, const void *data,
+			structs_visitor_t *visitor, void *arg)
+{
+	struct structs_query_info info;
+	int r;
+
+	/* Initialize info */
+	memset(&info, 0, sizeof(info));
+	info.visitor = visitor;
+	info.arg = arg;
+	info.alloc = 64;
+	if ((info.name = structs_mem_malloc(info.alloc)) == NULL)
+		return (-1);
+	*info.name = '\0';
+
+	/* Run query */
+	r = structs_query_exec(&info, q, data, 0);
+
+	/* Done */
+	structs_mem_free(info.name);
+	return (r);
+}
+
+int structs_query(const struct structs_type *type, const char *pattern,
+		  const void *data, structs_visitor_t *visitor, void *arg)
+{
+	struct structs_query *q;
+	int r;
+
+	if ((q = structs_query_compile(type, pattern)) == NULL)
+		return (-1);
+	r = structs_query_apply(q, data, visitor, arg);
+	structs_query_destroy(&q);
+	return (r);
+}
+
+/*
+ * Run a query on "data", whose name is the first "plen" characters
+ * of info->name.
+ */
+static int structs_query_exec(struct structs_query_info *info,
+			      const struct structs_query *q,
+			      const void *data, size_t plen)
+{
+	char nbuf[STRUCTS_INDEX_BUFSIZE];
+	const struct structs_type *type;
+	unsigned int i;
+	int r;
+
+	/* Apply the steps before the wildcard; no match is not an error */
+	if ((type = structs_path_find(q->path, &data, 0)) == NULL)
+		return ((errno == ENOENT || errno == EDOM) ? 0 : -1);
+	if (structs_query_name(info, plen, q->prefix) == -1)
+		return (-1);
+	plen = info->len;
+
+	/* If there's no wildcard, we have a match */
+	if (q->wtype == NULL) {
+		switch ((*info->visitor) (info->arg, info->name, type, data)) {
+		case STRUCTS_WALK_CONTINUE:
+		case STRUCTS_WALK_PRUNE:
+			return (0);
+		case STRUCTS_WALK_STOP:
+			return (1);
+		default:
+			return (-1);
+		}
+	}
+
+	/* Dereference through pointer(s) */
+	while (type->tclass == STRUCTS_TYPE_POINTER) {
+		type = type->args[0].v;
+		data = *((void **)data);
+	}
+
+	/* Run the sub-queries on the matching sub-elements */
+	switch (type->tclass) {
+	case STRUCTS_TYPE_ARRAY:
+	case STRUCTS_TYPE_FIXEDARRAY:
+		{
+			const struct structs_type *const etype =
+			    type->args[0].v;
+			const unsigned int length =
+			    (type->tclass == STRUCTS_TYPE_ARRAY) ?
+			    ((const struct structs_array *)data)->length :
+			    (unsigned int)type->args[2].i;
+			const char *const elems =
+			    (type->tclass == STRUCTS_TYPE_ARRAY) ?
+			    ((const struct structs_array *)data)->elems : data;
+
+			for (i = 0; i < length; i++) {
+				snprintf(nbuf, sizeof(nbuf), "%u", i);
+				if (structs_query_name(info, plen, nbuf) == -1)
+					return (-1);
+				if ((r = structs_query_exec(info, q->subs[0],
+							    elems
+							    + (i * etype->size),
+							    info->len)) != 0)
+					return (r);
+			}
+			break;
+		}
+	case STRUCTS_TYPE_STRUCTURE:
+		{
+			const struct structs_field *const fields =
+			    type->args[0].v;
+
+			for (i = 0; i < (unsigned int)q->nsubs; i++) {
+				if (q->subs[i] == NULL)
+					continue;
+				if (structs_query_name(info, plen,
+						       fields[i].name) == -1)
+					return (-1);
+				if ((r = structs_query_exec(info, q->subs[i],
+							    (const char *)data
+							    + fields[i].offset,
+							    info->len)) != 0)
+					return (r);
+			}
+			break;
+		}
+	case STRUCTS_TYPE_UNION:
+		{
+			const struct structs_ufield *const fields =
+			    type->args[0].v;
+			const struct structs_ufield *field;
+
+			/* Only the selected field can match */
+			if ((field = structs_union_field(type, data)) == NULL)
+				return (-1);
+			i = field - fields;
+			if (i >= (unsigned int)q->nsubs || q->subs[i] == NULL)
+				break;
+			if (structs_query_name(info, plen, field->name) == -1)
+				return (-1);
+			return (structs_query_exec(info, q->subs[i],
+						   structs_union_body(type,
+								      data),
+						   info->len));
+		}
+	default:
+		assert(0);
+		errno = EINVAL;
+		return (-1);
+	}
+
+	/* Done */
+	return (0);
+}
+
+/*
+ * Set the current name to the first "plen" characters of the
+ * current name, followed by a separator and "name" (if not empty).
+ */
+static int structs_query_name(struct structs_query_info *info, size_t plen,
+			      const char *name)
+{
+	const size_t nlen = strlen(name);
+
+	/* Grow buffer as necessary */
+	if (plen + 1 + nlen + 1 > info->alloc) {
+		size_t new_alloc;
+		char *mem;
+
+		for (new_alloc = info->alloc * 2;
+		     plen + 1 + nlen + 1 > new_alloc; new_alloc *= 2) ;
+		if ((mem = structs_mem_realloc(info->name, new_alloc)) == NULL)
+			return (-1);
+		info->name = mem;
+		info->alloc = new_alloc;
+	}
+
+	/* Append name */
+	info->len = plen;
+	if (nlen > 0) {
+		if (plen > 0)
+			info->name[info->len++] = STRUCTS_SEPARATOR;
+		memcpy(info->name + info->len, name, nlen);
+		info->len += nlen;
+	}
+	info->name[info->len] = '\0';
+	return (0);
+}
+
+/*******************************************************************************
+ * END OF FILE
+ ******************************************************************************/
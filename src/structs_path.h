@@ -0,0 +1,218 @@
+#ifndef _STRUCTS_PATH_H_
+#define _STRUCTS_PATH_H_
+
+/*******************************************************************************
+ * PRECOMPILED PATHS
+ ******************************************************************************/
+
+/*
+ * A "path" is a name (as accepted by structs_find()) that has been
+ * resolved against a structs type ahead of time. Structure and union
+ * field names, array indicies and pointer dereferences are all looked
+ * up once when the path is compiled, so applying the path to an instance
+ * requires no string processing at all.
+ *
+ * A compiled path remains valid for any instance of the type it was
+ * compiled against. Array bounds and union field selections depend on
+ * the particular instance and are therefore checked each time the path
+ * is applied; the errors are the same as for structs_find(), i.e.,
+ * EDOM for an array index that is out of range and ENOENT for a union
+ * field that is not currently selected.
+ */
+struct structs_path;
+
+/*
+ * Compile "name" relative to "type".
+ *
+ * If "name" is NULL or empty string, the path refers to the entire item.
+ *
+ * Returns the new path, or NULL (and sets errno) if there was an error.
+ * ENOENT is returned if "name" can never be found within "type".
+ */
+extern struct structs_path *structs_path_compile(const struct structs_type
+						 *type, const char *name);
+
+/*
+ * Destroy a compiled path and set *pathp to NULL.
+ *
+ * If *pathp is already NULL, this does nothing.
+ */
+extern void structs_path_destroy(struct structs_path **pathp);
+
+/*
+ * Get the structs type of the item a path refers to.
+ */
+extern const struct structs_type *structs_path_type(const struct structs_path
+						    *path);
+
+/*
+ * Apply a compiled path to the instance pointed to by *datap.
+ *
+ * This is the equivalent of structs_find() for compiled paths,
+ * including the handling of "set_union".
+ *
+ * Returns the type of the item and points *datap at it, or NULL
+ * (and sets errno) if there was an error.
+ */
+extern const struct structs_type *structs_path_find(const struct structs_path
+						    *path, const void **datap,
+						    int set_union);
+
+/*
+ * Compiled path versions of the basic structs functions.
+ *
+ * These behave exactly like the corresponding functions taking a
+ * "type" and "name", using the type and name the path was compiled from.
+ */
+extern int structs_equal_path(const struct structs_path *path,
+			      const void *data1, const void *data2);
+extern int structs_get_path(const struct structs_path *path,
+			    const void *from, void *to);
+extern int structs_set_path(const struct structs_path *path,
+			    const void *from, void *to);
+extern char *structs_get_string_path(const struct structs_path *path,
+				     const void *data);
+extern int structs_set_string_path(const struct structs_path *path,
+				   const char *ascii, void *data, char *ebuf,
+				   size_t emax);
+extern int structs_get_binary_path(const struct structs_path *path,
+				   const void *data, struct structs_data *code);
+extern int structs_set_binary_path(const struct structs_path *path,
+				   const struct structs_data *code, void *data,
+				   char *ebuf, size_t emax);
+
+/*******************************************************************************
+ * BATCH ACCESS
+ ******************************************************************************/
+
+/*
+ * A "path set" is a group of names compiled against the same type and
+ * arranged as a tree, so that name components shared by several names
+ * (e.g., "ifaces.3.stats" in "ifaces.3.stats.rx" and "ifaces.3.stats.tx")
+ * are resolved only once each time the set is applied.
+ *
+ * A name that can never be found within the type does not prevent the
+ * path set from being created; its error is reported each time instead.
+ */
+struct structs_pathset;
+
+/*
+ * Create a path set from the "num" names in "names".
+ *
+ * Returns the new path set, or NULL (and sets errno) if there was an error.
+ */
+extern struct structs_pathset *structs_pathset_create(const struct
+						      structs_type *type,
+						      const char *const *names,
+						      int num);
+
+/*
+ * Destroy a path set and set *psp to NULL.
+ *
+ * If *psp is already NULL, this does nothing.
+ */
+extern void structs_pathset_destroy(struct structs_pathset **psp);
+
+/*
+ * Get the ASCII form of several items at once.
+ *
+ * For each name, values[i] is set to the same string structs_get_string()
+ * would return (which the caller must free), or NULL if there was an
+ * error, in which case errors[i] (if "errors" is not NULL) is set to the
+ * corresponding errno value. errors[i] is set to zero on success.
+ *
+ * Returns the number of items that could not be retrieved, or -1
+ * (and sets errno) if there was an error affecting all of them.
+ */
+extern int structs_get_many(const struct structs_type *type,
+			    const char *const *names, int num,
+			    const void *data, char **values, int *errors);
+extern int structs_get_many_pathset(const struct structs_pathset *ps,
+				    const void *data, char **values,
+				    int *errors);
+
+/*
+ * Set several items at once from their ASCII forms, as with
+ * structs_set_string(), with results reported the same way as
+ * for structs_get_many().
+ *
+ * As with structs_set_string(), unions are switched to the field named
+ * when necessary, but only if the rest of the name is found within it.
+ * Items sharing a leading part of their names are set together, in the
+ * order in which those leading parts first appear in "names"; so if
+ * the names select different fields of the same union, the field used
+ * by the last such group wins.
+ *
+ * Returns the number of items that could not be set, or -1
+ * (and sets errno) if there was an error affecting all of them.
+ */
+extern int structs_set_many(const struct structs_type *type,
+			    const char *const *names,
+			    const char *const *values, int num, void *data,
+			    int *errors);
+extern int structs_set_many_pathset(const struct structs_pathset *ps,
+				    const char *const *values, void *data,
+				    int *errors);
+
+/*******************************************************************************
+ * WILDCARD QUERIES
+ ******************************************************************************/
+
+/*
+ * A query is a name in which any component may be the wildcard "*",
+ * which matches every element of an array or fixed array, every field
+ * of a structure, or the selected field of a union. For example,
+ * "ifaces.*.stats.rx" matches "ifaces.0.stats.rx", "ifaces.1.stats.rx",
+ * etc. The "length" and "field_name" pseudo-fields may be used as in
+ * structs_find().
+ *
+ * A structure field is only matched by a wildcard if the rest of the
+ * query could be found within it.
+ */
+#define STRUCTS_QUERY_WILDCARD	'*'
+
+struct structs_query;
+
+/*
+ * Compile a query relative to "type".
+ *
+ * Returns the new query, or NULL (and sets errno) if there was an error.
+ * ENOENT is returned if the query could never match anything.
+ */
+extern struct structs_query *structs_query_compile(const struct structs_type
+						   *type, const char *pattern);
+
+/*
+ * Destroy a compiled query and set *qp to NULL.
+ *
+ * If *qp is already NULL, this does nothing.
+ */
+extern void structs_query_destroy(struct structs_query **qp);
+
+/*
+ * Find all items in "data" matching a query, calling "visitor" for each
+ * one with its actual name, type and data, in the same order that
+ * structs_walk() would visit them. The visitor may return
+ * STRUCTS_WALK_STOP to stop early; STRUCTS_WALK_PRUNE has no effect.
+ *
+ * Array indicies that don't exist and union fields that are not selected
+ * in "data" simply don't match.
+ *
+ * Returns 0 if the query completed, 1 if the visitor stopped it early,
+ * or -1 and errno if there was an error.
+ */
+extern int structs_query_apply(const struct structs_query *q,
+			       const void *data, structs_visitor_t *visitor,
+			       void *arg);
+
+/*
+ * Compile a query, apply it and destroy it.
+ */
+extern int structs_query(const struct structs_type *type,
+			 const char *pattern, const void *data,
+			 structs_visitor_t *visitor, void *arg);
+
+#endif /* _STRUCTS_PATH_H_ */
+/*******************************************************************************
+ * END OF FILE
+ ******************************************************************************/
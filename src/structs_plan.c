@@ -0,0 +1,404 @@
+/*******************************************************************************
+ * HEADERS
+ ******************************************************************************/
+
+/* Standard Includes */
+#include <sys/types.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+
+/* Module Includes */
+#include "structs.h"
+#include "structs_alloc.h"
+#include "structs_type_array.h"
+#include "structs_type_struct.h"
+#include "structs_type_string.h"
+#include "structs_internal.h"
+
+/*******************************************************************************
+ * MACROS/VARIABLES
+ ******************************************************************************/
+
+/* Operations compiled into a plan */
+enum structs_plan_kind {
+	STRUCTS_PLAN_INIT,
+	STRUCTS_PLAN_COPY,
+	STRUCTS_PLAN_EQUAL,
+	STRUCTS_PLAN_FREE,
+	STRUCTS_PLAN_MAX
+};
+
+/* Plan instructions */
+enum structs_plan_opcode {
+	STRUCTS_PLAN_SPAN,	/* memcpy()/memcmp() a range of bytes */
+	STRUCTS_PLAN_STRDUP,	/* copy a dynamically allocated string */
+	STRUCTS_PLAN_CALL	/* call the type's method */
+};
+
+/* One plan instruction */
+struct structs_plan_op {
+	enum structs_plan_opcode code;	/* what to do */
+	size_t offset;		/* offset of item in top level structure */
+	size_t length;		/* length of span */
+	const struct structs_type *type;	/* type of item */
+};
+
+/*
+ * An execution plan for a structure type. Each operation is compiled
+ * into its own list of instructions. Nested structures are flattened,
+ * plain memory fields (see STRUCTS_POD_*) become spans, and adjacent
+ * spans are merged. Because a structure is zeroed before it is
+ * initialized or copied and after it is free'd, plain memory fields need
+ * no instructions at all for those operations.
+ */
+struct structs_plan {
+	unsigned int num[STRUCTS_PLAN_MAX];	/* number of instructions */
+	struct structs_plan_op *ops[STRUCTS_PLAN_MAX];	/* instructions */
+};
+
+/* Flag indicating an operation on a type needs no instructions of its own */
+static const int structs_plan_pod[STRUCTS_PLAN_MAX] = {
+	STRUCTS_POD_INIT,
+	STRUCTS_POD_COPY,
+	STRUCTS_POD_EQUAL,
+	STRUCTS_POD_FREE,
+};
+
+/* Instruction list being built */
+struct structs_plan_builder {
+	struct structs_plan_op *ops;	/* instructions */
+	unsigned int num;	/* number of instructions */
+	unsigned int alloc;	/* number allocated */
+};
+
+/*******************************************************************************
+ * FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+static int structs_plan_flatten(const struct structs_type *type,
+				enum structs_plan_kind kind);
+static int structs_plan_add(struct structs_plan_builder *b,
+			    const struct structs_type *type,
+			    enum structs_plan_kind kind, size_t base);
+static int structs_plan_emit(struct structs_plan_builder *b,
+			     enum structs_plan_opcode code, size_t offset,
+			     const struct structs_type *type);
+static void structs_plan_unwind(const struct structs_plan_op *ops,
+				unsigned int num, void *data);
+
+/*******************************************************************************
+ * FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+/*
+ * Compile the execution plan for a structure type.
+ */
+struct structs_plan *structs_plan_compile(const struct structs_type *type)
+{
+	struct structs_plan_builder b[STRUCTS_PLAN_MAX];
+	struct structs_plan *plan = NULL;
+	struct structs_plan_op *op;
+	unsigned int total = 0;
+	int kind;
+
+	/* Only plain structure types are supported */
+	if (!structs_plan_flatten(type, STRUCTS_PLAN_INIT)) {
+		errno = EINVAL;
+		return (NULL);
+	}
+
+	/* Compile each operation */
+	memset(b, 0, sizeof(b));
+	for (kind = 0; kind < STRUCTS_PLAN_MAX; kind++) {
+		if (structs_plan_add(&b[kind], type, kind, 0) == -1)
+			goto done;
+		total += b[kind].num;
+	}
+
+	/* Copy instructions into a single block */
+	if ((plan = calloc(1, sizeof(*plan) + total * sizeof(*op))) == NULL)
+		goto done;
+	op = (struct structs_plan_op *)(plan + 1);
+	for (kind = 0; kind < STRUCTS_PLAN_MAX; kind++) {
+		plan->num[kind] = b[kind].num;
+		plan->ops[kind] = op;
+		if (b[kind].num > 0)
+			memcpy(op, b[kind].ops, b[kind].num * sizeof(*op));
+		op += b[kind].num;
+	}
+
+done:
+	/* Clean up */
+	for (kind = 0; kind < STRUCTS_PLAN_MAX; kind++)
+		free(b[kind].ops);
+	return (plan);
+}
+
+/*
+ * Destroy an execution plan and set *planp to NULL.
+ */
+void structs_plan_destroy(struct structs_plan **planp)
+{
+	struct structs_plan *const plan = *planp;
+
+	if (plan == NULL)
+		return;
+	free(plan);
+	*planp = NULL;
+}
+
+/*
+ * Initialize a structure using its execution plan.
+ */
+int structs_plan_init(const struct structs_plan *plan,
+		      const struct structs_type *type, void *data)
+{
+	const struct structs_plan_op *const ops = plan->ops[STRUCTS_PLAN_INIT];
+	const unsigned int num = plan->num[STRUCTS_PLAN_INIT];
+	unsigned int i;
+
+	memset(data, 0, type->size);
+	for (i = 0; i < num; i++) {
+		const struct structs_plan_op *const op = &ops[i];
+
+		if ((*op->type->init) (op->type,
+				       (char *)data + op->offset) == -1) {
+			structs_plan_unwind(ops, i, data);
+			memset(data, 0, type->size);
+			return (-1);
+		}
+	}
+	return (0);
+}
+
+/*
+ * Copy a structure using its execution plan.
+ */
+int structs_plan_copy(const struct structs_plan *plan,
+		      const struct structs_type *type,
+		      const void *from, void *to)
+{
+	const struct structs_plan_op *const ops = plan->ops[STRUCTS_PLAN_COPY];
+	const unsigned int num = plan->num[STRUCTS_PLAN_COPY];
+	unsigned int i;
+
+	memset(to, 0, type->size);
+	for (i = 0; i < num; i++) {
+		const struct structs_plan_op *const op = &ops[i];
+		const void *const fdata = (const char *)from + op->offset;
+		void *const tdata = (char *)to + op->offset;
+
+		switch (op->code) {
+		case STRUCTS_PLAN_SPAN:
+			memcpy(tdata, fdata, op->length);
+			break;
+		case STRUCTS_PLAN_STRDUP:
+		    {
+			const char *s = *((const char *const *)fdata);
+			const int as_null = op->type->args[0].i;
+
+			if (s == NULL || (as_null && *s == '\0')) {
+				if (as_null)
+					break;
+				s = "";
+			}
+			if ((*((char **)tdata) = structs_mem_strdup(s)) == NULL)
+				goto fail;
+			break;
+		    }
+		case STRUCTS_PLAN_CALL:
+			if ((*op->type->copy) (op->type, fdata, tdata) == -1)
+				goto fail;
+			break;
+		}
+	}
+	return (0);
+
+fail:
+	/* Un-do work done so far */
+	structs_plan_unwind(ops, i, to);
+	memset(to, 0, type->size);
+	return (-1);
+}
+
+/*
+ * Compare two structures using their execution plan.
+ */
+int structs_plan_equal(const struct structs_plan *plan,
+		       const void *v1, const void *v2)
+{
+	const struct structs_plan_op *const ops = plan->ops[STRUCTS_PLAN_EQUAL];
+	const unsigned int num = plan->num[STRUCTS_PLAN_EQUAL];
+	unsigned int i;
+
+	for (i = 0; i < num; i++) {
+		const struct structs_plan_op *const op = &ops[i];
+		const void *const data1 = (const char *)v1 + op->offset;
+		const void *const data2 = (const char *)v2 + op->offset;
+
+		if (op->code == STRUCTS_PLAN_SPAN) {
+			if (memcmp(data1, data2, op->length) != 0)
+				return (0);
+		} else if (!(*op->type->equal) (op->type, data1, data2))
+			return (0);
+	}
+	return (1);
+}
+
+/*
+ * Free a structure using its execution plan.
+ */
+void structs_plan_free(const struct structs_plan *plan,
+		       const struct structs_type *type, void *data)
+{
+	const struct structs_plan_op *const ops = plan->ops[STRUCTS_PLAN_FREE];
+	const unsigned int num = plan->num[STRUCTS_PLAN_FREE];
+	unsigned int i;
+
+	for (i = 0; i < num; i++) {
+		const struct structs_plan_op *const op = &ops[i];
+
+		(*op->type->uninit) (op->type, (char *)data + op->offset);
+	}
+	memset(data, 0, type->size);
+}
+
+/*
+ * Determine whether the fields of a structure type can be merged into
+ * an enclosing plan for an operation, i.e., whether it uses the plain
+ * structure methods for the operation (and for freeing, which is needed
+ * to un-do a failed initialization or copy).
+ */
+static int structs_plan_flatten(const struct structs_type *type,
+				enum structs_plan_kind kind)
+{
+	if (type->tclass != STRUCTS_TYPE_STRUCTURE
+	    || type->uninit != structs_struct_free)
+		return (0);
+	switch (kind) {
+	case STRUCTS_PLAN_INIT:
+		return (type->init == structs_struct_init);
+	case STRUCTS_PLAN_COPY:
+		return (type->copy == structs_struct_copy);
+	case STRUCTS_PLAN_EQUAL:
+		return (type->equal == structs_struct_equal);
+	case STRUCTS_PLAN_FREE:
+		return (1);
+	default:
+		return (0);
+	}
+}
+
+/*
+ * Add the instructions for one operation on the fields of structure
+ * type "type" located at offset "base".
+ */
+static int structs_plan_add(struct structs_plan_builder *b,
+			    const struct structs_type *type,
+			    enum structs_plan_kind kind, size_t base)
+{
+	const struct structs_field *field;
+
+	for (field = type->args[0].v; field->name != NULL; field++) {
+		const struct structs_type *const ftype = field->type;
+		const size_t offset = base + field->offset;
+
+		assert(field->size == ftype->size);	/* safety check */
+
+		/* Plain memory */
+		if ((structs_pod_flags(ftype) & structs_plan_pod[kind]) != 0) {
+			if (kind == STRUCTS_PLAN_COPY
+			    || kind == STRUCTS_PLAN_EQUAL) {
+				if (structs_plan_emit(b, STRUCTS_PLAN_SPAN,
+						      offset, ftype) == -1)
+					return (-1);
+			}
+			continue;
+		}
+
+		/* Nested structure */
+		if (structs_plan_flatten(ftype, kind)) {
+			if (structs_plan_add(b, ftype, kind, offset) == -1)
+				return (-1);
+			continue;
+		}
+
+		/* Dynamically allocated string */
+		if (kind == STRUCTS_PLAN_COPY
+		    && ftype->copy == structs_ascii_copy
+		    && ftype->ascify == structs_string_ascify
+		    && ftype->binify == structs_string_binify
+		    && ftype->uninit == structs_string_free) {
+			if (structs_plan_emit(b, STRUCTS_PLAN_STRDUP,
+					      offset, ftype) == -1)
+				return (-1);
+			continue;
+		}
+
+		/* Anything else */
+		if (structs_plan_emit(b, STRUCTS_PLAN_CALL, offset, ftype) == -1)
+			return (-1);
+	}
+	return (0);
+}
+
+/*
+ * Append an instruction, merging spans where possible.
+ */
+static int structs_plan_emit(struct structs_plan_builder *b,
+			     enum structs_plan_opcode code, size_t offset,
+			     const struct structs_type *type)
+{
+	struct structs_plan_op *op;
+
+	/* Extend the previous span if this one follows it directly */
+	if (code == STRUCTS_PLAN_SPAN && b->num > 0) {
+		op = &b->ops[b->num - 1];
+		if (op->code == STRUCTS_PLAN_SPAN
+		    && op->offset + op->length == offset) {
+			op->length += type->size;
+			return (0);
+		}
+	}
+
+	/* Make room */
+	if (b->num == b->alloc) {
+		const unsigned int new_alloc = b->alloc ? b->alloc * 2 : 8;
+
+		if ((op = realloc(b->ops, new_alloc * sizeof(*op))) == NULL)
+			return (-1);
+		b->ops = op;
+		b->alloc = new_alloc;
+	}
+
+	/* Add new instruction */
+	op = &b->ops[b->num++];
+	op->code = code;
+	op->offset = offset;
+	op->length = type->size;
+	op->type = type;
+	return (0);
+}
+
+/*
+ * Free the items referred to by the first "num" instructions, in reverse.
+ * Spans never need freeing.
+ */
+static void structs_plan_unwind(const struct structs_plan_op *ops,
+				unsigned int num, void *data)
+{
+	while (num-- > 0) {
+		const struct structs_plan_op *const op = &ops[num];
+
+		if (op->code != STRUCTS_PLAN_SPAN)
+			(*op->type->uninit) (op->type, (char *)data + op->offset);
+	}
+}
+
+/*******************************************************************************
+ * END OF FILE
+ ******************************************************************************/
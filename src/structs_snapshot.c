@@ -0,0 +1,246 @@
+/*******************************************************************************
+ * HEADERS
+ ******************************************************************************/
+
+/* Standard Includes */
+#include <sys/types.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+
+/* Module Includes */
+#include "structs.h"
+#include "structs_alloc.h"
+#include "structs_snapshot.h"
+
+/*******************************************************************************
+ * MACROS/VARIABLES
+ ******************************************************************************/
+
+/* One version of a versioned data structure */
+struct structs_snapshot {
+	unsigned int refs;	/* number of references */
+	uint64_t version;	/* version number */
+	const struct structs_type *type;	/* type of "data" */
+	const struct structs_allocator *alloc;	/* allocator for "data" */
+	void *data;		/* the data */
+};
+
+/* A versioned data structure */
+struct structs_versioned {
+	const struct structs_type *type;	/* type of the data */
+	const struct structs_allocator *alloc;	/* allocator for the data */
+	struct structs_snapshot *current;	/* latest published version */
+	struct structs_snapshot *draft;	/* version being edited, if any */
+	unsigned int epoch;	/* selects readers[] counter for new readers */
+	unsigned int readers[2];	/* readers in structs_snapshot_take() */
+	pthread_mutex_t mutex;	/* held by the writer */
+};
+
+/*******************************************************************************
+ * FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+static struct structs_snapshot *structs_snapshot_new(struct structs_versioned
+						     *v, const void *data,
+						     uint64_t version);
+static void structs_snapshot_wait(const unsigned int *readers);
+
+/*******************************************************************************
+ * FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+struct structs_versioned *structs_versioned_create(const struct structs_type
+						   *type, const void *data)
+{
+	struct structs_versioned *v;
+	int errno_save;
+
+	if ((v = structs_mem_calloc(1, sizeof(*v))) == NULL)
+		return (NULL);
+	v->type = type;
+	v->alloc = structs_get_allocator();
+	if ((errno = pthread_mutex_init(&v->mutex, NULL)) != 0)
+		goto fail;
+	if ((v->current = structs_snapshot_new(v, data, 1)) == NULL) {
+		errno_save = errno;
+		pthread_mutex_destroy(&v->mutex);
+		errno = errno_save;
+		goto fail;
+	}
+	return (v);
+
+fail:	errno_save = errno;
+	structs_mem_free(v);
+	errno = errno_save;
+	return (NULL);
+}
+
+void structs_versioned_destroy(struct structs_versioned *v)
+{
+	const struct structs_allocator *prev;
+
+	assert(v->draft == NULL);
+	structs_snapshot_release(v->current);
+	pthread_mutex_destroy(&v->mutex);
+	prev = structs_set_thread_allocator(v->alloc);
+	structs_mem_free(v);
+	structs_set_thread_allocator(prev);
+}
+
+/*
+ * Readers announce themselves in the counter selected by the epoch
+ * before loading the current version, and leave once they hold a
+ * reference to it, so that a writer knows when no reader can still
+ * be about to take a reference to a version it has replaced.
+ */
+const struct structs_snapshot *structs_snapshot_take(struct structs_versioned
+						     *v)
+{
+	const unsigned int e = __atomic_load_n(&v->epoch, __ATOMIC_SEQ_CST) & 1;
+	struct structs_snapshot *snap;
+
+	__atomic_add_fetch(&v->readers[e], 1, __ATOMIC_SEQ_CST);
+	snap = __atomic_load_n(&v->current, __ATOMIC_SEQ_CST);
+	__atomic_add_fetch(&snap->refs, 1, __ATOMIC_RELAXED);
+	__atomic_sub_fetch(&v->readers[e], 1, __ATOMIC_RELEASE);
+	return (snap);
+}
+
+void structs_snapshot_release(const struct structs_snapshot *csnap)
+{
+	struct structs_snapshot *const snap = (struct structs_snapshot *)csnap;
+	const struct structs_allocator *prev;
+
+	if (__atomic_sub_fetch(&snap->refs, 1, __ATOMIC_ACQ_REL) != 0)
+		return;
+	prev = structs_set_thread_allocator(snap->alloc);
+	structs_free(snap->type, NULL, snap->data);
+	structs_mem_free(snap->data);
+	structs_mem_free(snap);
+	structs_set_thread_allocator(prev);
+}
+
+const void *structs_snapshot_data(const struct structs_snapshot *snap)
+{
+	return (snap->data);
+}
+
+uint64_t structs_snapshot_version(const struct structs_snapshot *snap)
+{
+	return (snap->version);
+}
+
+void *structs_versioned_edit(struct structs_versioned *v)
+{
+	const struct structs_snapshot *cur;
+	int r;
+
+	r = pthread_mutex_lock(&v->mutex);
+	assert(r == 0);
+	assert(v->draft == NULL);
+	cur = v->current;
+	if ((v->draft = structs_snapshot_new(v, cur->data,
+					     cur->version + 1)) == NULL) {
+		r = pthread_mutex_unlock(&v->mutex);
+		assert(r == 0);
+		return (NULL);
+	}
+	return (v->draft->data);
+}
+
+void structs_versioned_publish(struct structs_versioned *v)
+{
+	struct structs_snapshot *old;
+	unsigned int e;
+	int r;
+
+	assert(v->draft != NULL);
+
+	/* Replace the current version */
+	old = __atomic_exchange_n(&v->current, v->draft, __ATOMIC_SEQ_CST);
+	v->draft = NULL;
+
+	/*
+	 * Wait for the readers that might have loaded the old version:
+	 * first those that started in the previous epoch, then, after
+	 * sending new readers to the other counter, those in this one.
+	 */
+	e = __atomic_load_n(&v->epoch, __ATOMIC_RELAXED);
+	structs_snapshot_wait(&v->readers[(e + 1) & 1]);
+	__atomic_store_n(&v->epoch, e + 1, __ATOMIC_SEQ_CST);
+	structs_snapshot_wait(&v->readers[e & 1]);
+	r = pthread_mutex_unlock(&v->mutex);
+	assert(r == 0);
+
+	/* Drop the reference the old version had as the current one */
+	structs_snapshot_release(old);
+}
+
+void structs_versioned_abort(struct structs_versioned *v)
+{
+	int r;
+
+	assert(v->draft != NULL);
+	structs_snapshot_release(v->draft);
+	v->draft = NULL;
+	r = pthread_mutex_unlock(&v->mutex);
+	assert(r == 0);
+}
+
+/*
+ * Create a version with one reference, holding a copy of "data" (or a
+ * new instance if NULL), all allocated using the versioned data's
+ * allocator.
+ */
+static struct structs_snapshot *structs_snapshot_new(struct structs_versioned
+						     *v, const void *data,
+						     uint64_t version)
+{
+	const struct structs_allocator *prev;
+	struct structs_snapshot *snap;
+	int errno_save;
+	int r;
+
+	prev = structs_set_thread_allocator(v->alloc);
+	if ((snap = structs_mem_calloc(1, sizeof(*snap))) == NULL)
+		goto done;
+	if ((snap->data = structs_mem_malloc(v->type->size)) == NULL)
+		goto fail;
+	snap->refs = 1;
+	snap->version = version;
+	snap->type = v->type;
+	snap->alloc = v->alloc;
+	r = data != NULL ? structs_get(v->type, NULL, data, snap->data)
+	    : structs_init(v->type, NULL, snap->data);
+	if (r == -1)
+		goto fail;
+	goto done;
+
+fail:	errno_save = errno;
+	structs_mem_free(snap->data);
+	structs_mem_free(snap);
+	snap = NULL;
+	errno = errno_save;
+done:	structs_set_thread_allocator(prev);
+	return (snap);
+}
+
+/*
+ * Wait for a readers[] counter to drop to zero.
+ */
+static void structs_snapshot_wait(const unsigned int *readers)
+{
+	while (__atomic_load_n(readers, __ATOMIC_SEQ_CST) != 0)
+		sched_yield();
+}
+
+/*******************************************************************************
+ * END OF FILE
+ ******************************************************************************/
@@ -0,0 +1,111 @@
+#ifndef _STRUCTS_SNAPSHOT_H_
+#define _STRUCTS_SNAPSHOT_H_
+
+/*******************************************************************************
+ * VERSIONED SNAPSHOTS
+ ******************************************************************************/
+
+/*
+ * A versioned data structure lets any number of reader threads work on
+ * consistent snapshots of a data structure while one writer at a time
+ * prepares and publishes new versions of it.
+ *
+ * Readers never block: structs_snapshot_take() returns the latest
+ * published version, which stays valid and unchanged until the reader
+ * calls structs_snapshot_release(), however many newer versions are
+ * published meanwhile. Each version is freed when the last snapshot
+ * of it is released.
+ *
+ * A writer calls structs_versioned_edit() to get a draft, which is a
+ * copy of the latest version, modifies the draft, and then either
+ * publishes it as the next version with structs_versioned_publish() or
+ * throws it away with structs_versioned_abort(). Other writers wait
+ * in structs_versioned_edit() until then.
+ *
+ * Copying the latest version costs little when most of the data structure
+ * sits behind copy-on-write pointers, or in copy-on-write strings and
+ * data (see structs_type_cow.h), because the draft shares those with the
+ * published versions. Modifying the draft by name, with structs_set()
+ * and the like, copies only what it has to, leaving published versions
+ * unchanged.
+ *
+ * The allocator that is current when the versioned data structure is
+ * created (see structs_alloc.h) is used for all its versions, and must
+ * also be current while the writer modifies a draft. As versions may be
+ * freed by whichever thread releases them last, it must be safe to use
+ * from several threads at once; the default allocator is.
+ */
+
+struct structs_versioned;
+struct structs_snapshot;
+
+/*
+ * Create a versioned data structure of type "type", whose first version
+ * is a copy of "data", or a newly initialized instance if "data" is NULL.
+ *
+ * Returns NULL (and sets errno) if there was an error.
+ */
+extern struct structs_versioned *structs_versioned_create(const struct
+							  structs_type *type,
+							  const void *data);
+
+/*
+ * Destroy a versioned data structure, releasing its latest version.
+ * There must be no draft outstanding; snapshots that have been taken
+ * remain valid until they are released.
+ */
+extern void structs_versioned_destroy(struct structs_versioned *v);
+
+/*
+ * Get a snapshot of the latest published version. This never blocks.
+ *
+ * The caller must release it using structs_snapshot_release() when done.
+ */
+extern const struct structs_snapshot *structs_snapshot_take(struct
+							    structs_versioned
+							    *v);
+
+/*
+ * Release a snapshot.
+ */
+extern void structs_snapshot_release(const struct structs_snapshot *snap);
+
+/*
+ * Get the data in a snapshot, which must not be modified.
+ */
+extern const void *structs_snapshot_data(const struct structs_snapshot *snap);
+
+/*
+ * Get the version number of a snapshot. The first version is 1, and
+ * each version published after it has the next number.
+ */
+extern uint64_t structs_snapshot_version(const struct structs_snapshot
+					 *snap);
+
+/*
+ * Start a new version, waiting for any other writer to finish first.
+ *
+ * Returns a draft, which is a copy of the latest version, or NULL (and
+ * sets errno) if there was an error. The draft must be published using
+ * structs_versioned_publish() or thrown away using structs_versioned_abort().
+ */
+extern void *structs_versioned_edit(struct structs_versioned *v);
+
+/*
+ * Publish the draft as the latest version.
+ *
+ * This waits for readers that are in the middle of structs_snapshot_take()
+ * (but not for snapshots that have been taken) so that the previous
+ * version can be released safely.
+ */
+extern void structs_versioned_publish(struct structs_versioned *v);
+
+/*
+ * Throw away the draft.
+ */
+extern void structs_versioned_abort(struct structs_versioned *v);
+
+#endif /* _STRUCTS_SNAPSHOT_H_ */
+/*******************************************************************************
+ * END OF FILE
+ ******************************************************************************/
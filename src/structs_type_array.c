@@ -11,11 +11,15 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
 #include <errno.h>
 
 /* Module Includes */
 #include "structs.h"
+#include "structs_alloc.h"
 #include "structs_type_array.h"
+#include "structs_internal.h"
 
 /*******************************************************************************
  * MACROS/VARIABLES
@@ -23,6 +27,29 @@
 
 #define NUM_BYTES(x) (((x) + 7) / 8)
 
+/* Whether an array type is a 'struct structs_varray' */
+#define STRUCTS_ARRAY_VARIABLE(type)	((type)->args[2].i != 0)
+
+/* Smallest capacity allocated for a 'struct structs_varray' */
+#define STRUCTS_VARRAY_MIN	4
+
+/* Elements of two arrays processed by structs_parallel_run() */
+struct structs_array_range {
+	const struct structs_type *etype;	/* element type */
+	const void *from;	/* elements of first array */
+	void *to;		/* elements of second array */
+};
+
+/*******************************************************************************
+ * FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+static void structs_array_setcap(const struct structs_type *type, void *data,
+				 unsigned int capacity);
+static structs_range_t structs_array_copy_range;
+static structs_range_t structs_array_free_range;
+static structs_range_t structs_array_equal_range;
+
 /*******************************************************************************
  * FUNCTION DEFINITIONS
  ******************************************************************************/
@@ -37,8 +64,8 @@ int structs_array_copy(const struct structs_type *type,
 	const struct structs_type *const etype = type->args[0].v;
 	const struct structs_array *const fary = from;
 	struct structs_array *const tary = to;
+	struct structs_array_range range;
 	int errno_save;
-	unsigned int i;
 
 	/* Make sure it's really an array type */
 	if (type->tclass != STRUCTS_TYPE_ARRAY) {
@@ -47,34 +74,35 @@ int structs_array_copy(const struct structs_type *type,
 	}
 
 	/* Allocate a new array */
-	memset(tary, 0, sizeof(*tary));
-	if ((tary->elems = calloc(1, fary->length * etype->size)) == NULL)
+	memset(tary, 0, type->size);
+	if ((tary->elems = structs_mem_calloc(1, fary->length * etype->size))
+	    == NULL)
 		return (-1);
+	structs_array_setcap(type, tary, fary->length);
 
-	/* Copy elements into it */
-	for (i = 0; i < fary->length; i++) {
-		const void *const from_elem
-		    = (char *)fary->elems + (i * etype->size);
-		void *const to_elem = (char *)tary->elems + (i * etype->size);
-
-		if ((*etype->copy) (etype, from_elem, to_elem) == -1)
-			break;
-		tary->length++;
+	/* Copy plain memory elements all at once */
+	if ((structs_pod_flags(etype) & STRUCTS_POD_COPY) != 0) {
+		if (fary->length > 0) {
+			memcpy(tary->elems, fary->elems,
+			       fary->length * etype->size);
+		}
+		tary->length = fary->length;
+		return (0);
 	}
 
-	/* If there was a failure, undo the half completed job */
-	if (i < fary->length) {
+	/* Copy elements into it; if there's a failure, undo the job */
+	range.etype = etype;
+	range.from = fary->elems;
+	range.to = tary->elems;
+	if (structs_parallel_run(fary->length, structs_array_copy_range,
+				 structs_array_free_range, &range) == -1) {
 		errno_save = errno;
-		while (i-- > 0) {
-			(*etype->uninit) (etype,
-					  (char *)tary->elems +
-					  (i * etype->size));
-		}
-		free(tary->elems);
-		memset(tary, 0, sizeof(*tary));
+		structs_mem_free(tary->elems);
+		memset(tary, 0, type->size);
 		errno = errno_save;
 		return (-1);
 	}
+	tary->length = fary->length;
 
 	/* Done */
 	return (0);
@@ -86,7 +114,7 @@ int structs_array_equal(const struct structs_type *type,
 	const struct structs_type *const etype = type->args[0].v;
 	const struct structs_array *const ary1 = v1;
 	const struct structs_array *const ary2 = v2;
-	unsigned int i;
+	struct structs_array_range range;
 
 	/* Make sure it's really an array type */
 	if (type->tclass != STRUCTS_TYPE_ARRAY)
@@ -96,28 +124,83 @@ int structs_array_equal(const struct structs_type *type,
 	if (ary1->length != ary2->length)
 		return (0);
 
+	/* Compare plain memory elements all at once */
+	if ((structs_pod_flags(etype) & STRUCTS_POD_EQUAL) != 0) {
+		return (ary1->length == 0
+			|| memcmp(ary1->elems, ary2->elems,
+				  ary1->length * etype->size) == 0);
+	}
+
 	/* Now compare individual elements */
-	for (i = 0;
-	     i < ary1->length && (*etype->equal) (etype,
-						  (char *)ary1->elems +
-						  (i * etype->size),
-						  (char *)ary2->elems +
-						  (i * etype->size)); i++) ;
-	return (i == ary1->length);
+	range.etype = etype;
+	range.from = ary1->elems;
+	range.to = ary2->elems;
+	return (structs_parallel_run(ary1->length,
+				     structs_array_equal_range, NULL,
+				     &range) == 0);
+}
+
+int structs_array_compare(const struct structs_type *type,
+			  const void *v1, const void *v2)
+{
+	const struct structs_type *const etype = type->args[0].v;
+	const struct structs_array *const ary1 = v1;
+	const struct structs_array *const ary2 = v2;
+	const unsigned int length = MIN(ary1->length, ary2->length);
+	unsigned int i;
+	int r;
+
+	/* Compare elements in order, then lengths */
+	for (i = 0; i < length; i++) {
+		if ((r = structs_compare_item(etype,
+					      (char *)ary1->elems +
+					      (i * etype->size),
+					      (char *)ary2->elems +
+					      (i * etype->size))) != 0)
+			return (r);
+	}
+	return ((ary1->length > ary2->length) - (ary1->length < ary2->length));
+}
+
+uint64_t structs_array_hash(const struct structs_type *type, const void *data)
+{
+	const struct structs_type *const etype = type->args[0].v;
+	const struct structs_array *const ary = data;
+	uint64_t hash = STRUCTS_HASH_INIT;
+	uint64_t ehash;
+	unsigned int i;
+
+	/* Hash plain memory elements all at once */
+	if ((structs_pod_flags(etype) & STRUCTS_POD_EQUAL) != 0) {
+		return (structs_hash_bytes(hash, ary->elems,
+					   (size_t)ary->length * etype->size));
+	}
+
+	/* Combine hashes of individual elements */
+	for (i = 0; i < ary->length; i++) {
+		ehash = structs_hash_item(etype, (char *)ary->elems
+					  + (i * etype->size));
+		hash = structs_hash_bytes(hash, &ehash, sizeof(ehash));
+	}
+	return (hash);
 }
 
 int structs_array_encode(const struct structs_type *type,
 			 struct structs_data *code, const void *data)
+{
+	return (structs_encoder_encode(type, code, data));
+}
+
+int structs_array_encode_into(const struct structs_type *type,
+			      struct structs_encoder *enc, const void *data)
 {
 	const struct structs_type *const etype = type->args[0].v;
 	const struct structs_array *const ary = data;
 	const unsigned int bitslen = NUM_BYTES(ary->length);
-	struct structs_data *ecodes;
 	u_int32_t elength;
-	unsigned char *bits;
-	void *delem;
-	unsigned int tlen;
-	int r = -1;
+	unsigned char *hdr;
+	const void *delem;
+	size_t boff;
 	unsigned int i;
 
 	/* Make sure it's really an array type */
@@ -127,69 +210,34 @@ int structs_array_encode(const struct structs_type *type,
 	}
 
 	/* Get the default value for an element */
-	if ((delem = calloc(1, etype->size)) == NULL)
+	if ((delem = structs_default(etype)) == NULL)
 		return (-1);
-	if (structs_init(etype, NULL, delem) == -1)
-		goto fail1;
 
-	/* Create bit array. Each bit indicates an element that is present. */
-	if ((bits = calloc(1, bitslen)) == NULL)
-		goto fail2;
-	memset(bits, 0, bitslen);
-	tlen = 4 + bitslen;	/* length word + bits array */
+	/*
+	 * Append array length and bit array, in which each bit indicates
+	 * an element that is present; we'll fill in the bits as we go.
+	 */
+	if ((hdr = structs_encoder_reserve(enc, 4 + bitslen)) == NULL)
+		return (-1);
+	elength = htonl(ary->length);
+	memcpy(hdr, &elength, 4);
+	memset(hdr + 4, 0, bitslen);
+	boff = enc->length - bitslen;
 
-	/* Create array of individual encodings, one per element */
-	if ((ecodes = calloc(1, ary->length * sizeof(*ecodes))) == NULL)
-		goto fail3;
+	/* Append encoded elements */
 	for (i = 0; i < ary->length; i++) {
 		const void *const elem = (char *)ary->elems + (i * etype->size);
-		struct structs_data *const ecode = &ecodes[i];
 
 		/* Check for default value, leave out if same as */
-		if ((*etype->equal) (etype, elem, delem) == 1) {
-			memset(ecode, 0, sizeof(*ecode));
+		if ((*etype->equal) (etype, elem, delem) == 1)
 			continue;
-		}
-		bits[i / 8] |= (1 << (i % 8));
+		enc->data[boff + i / 8] |= (1 << (i % 8));
 
 		/* Encode element */
-		if ((*etype->encode) (etype, ecode, elem) == -1)
-			goto fail4;
-		tlen += ecode->length;
-	}
-
-	/* Allocate final encoded region */
-	if ((code->data = calloc(1, tlen)) == NULL)
-		goto fail4;
-
-	/* Copy array length */
-	elength = htonl(ary->length);
-	memcpy(code->data, &elength, 4);
-	code->length = 4;
-
-	/* Copy bits array */
-	memcpy(code->data + code->length, bits, bitslen);
-	code->length += bitslen;
-
-	/* Copy encoded elements */
-	for (i = 0; i < ary->length; i++) {
-		struct structs_data *const ecode = &ecodes[i];
-
-		memcpy(code->data + code->length, ecode->data, ecode->length);
-		code->length += ecode->length;
+		if (structs_encode_into(etype, enc, elem) == -1)
+			return (-1);
 	}
-
-	/* OK */
-	r = 0;
-
-	/* Clean up and exit */
-fail4:	while (i-- > 0)
-		free(ecodes[i].data);
-	free(ecodes);
-fail3:	free(bits);
-fail2:	structs_free(etype, NULL, delem);
-fail1:	free(delem);
-	return (r);
+	return (0);
 }
 
 int structs_array_decode(const struct structs_type *type,
@@ -232,8 +280,10 @@ truncated:	strncpy(ebuf, "encoded array is truncated", emax);
 	clen += bitslen;
 
 	/* Allocate array elements */
-	if ((ary->elems = calloc(1, ary->length * etype->size)) == NULL)
+	if ((ary->elems = structs_mem_calloc(1, ary->length * etype->size))
+	    == NULL)
 		return (-1);
+	structs_array_setcap(type, ary, ary->length);
 
 	/* Decode elements */
 	for (i = 0; i < ary->length; i++) {
@@ -264,7 +314,7 @@ fail:		while (i-- > 0) {
 			structs_free(etype, NULL,
 				     (char *)ary->elems + (i * etype->size));
 		}
-		free(ary->elems);
+		structs_mem_free(ary->elems);
 		return (-1);
 	}
 
@@ -276,20 +326,35 @@ void structs_array_free(const struct structs_type *type, void *data)
 {
 	const struct structs_type *const etype = type->args[0].v;
 	struct structs_array *const ary = data;
-	unsigned int i;
+	struct structs_array_range range;
 
 	/* Make sure it's really an array type */
 	if (type->tclass != STRUCTS_TYPE_ARRAY)
 		return;
 
-	/* Free individual elements */
-	for (i = 0; i < ary->length; i++)
-		(*etype->uninit) (etype,
-				  (char *)ary->elems + (i * etype->size));
+	/* Free individual elements, unless there's no need */
+	if ((structs_pod_flags(etype) & STRUCTS_POD_FREE) == 0) {
+		range.etype = etype;
+		range.to = ary->elems;
+		structs_parallel_run(ary->length,
+				     structs_array_free_range, NULL, &range);
+	}
 
 	/* Free array itself */
-	free(ary->elems);
-	memset(ary, 0, sizeof(*ary));
+	structs_mem_free(ary->elems);
+	memset(ary, 0, type->size);
+}
+
+void structs_array_memsize(const struct structs_type *type, const void *data,
+			   structs_memblock_t *block, void *arg)
+{
+	const struct structs_type *const etype = type->args[0].v;
+	const struct structs_array *const ary = data;
+	const unsigned int nitems = STRUCTS_ARRAY_VARIABLE(type) ?
+	    ((const struct structs_varray *)data)->capacity : ary->length;
+
+	if (ary->elems != NULL)
+		(*block) (arg, ary->elems, (size_t)nitems * etype->size);
 }
 
 int structs_array_length(const struct structs_type *type,
@@ -315,7 +380,9 @@ int structs_array_reset(const struct structs_type *type,
 			const char *name, void *data)
 {
 	/* Find array */
-	if ((type = structs_find(type, name, (const void **)&data, 1)) == NULL)
+	if ((type = structs_find_flags(type, name, (const void **)&data,
+				       STRUCTS_FIND_UNION
+				       | STRUCTS_FIND_UNSHARE)) == NULL)
 		return (-1);
 
 	/* Make sure it's really an array type */
@@ -334,10 +401,10 @@ int structs_array_insert(const struct structs_type *type,
 {
 	struct structs_array *ary = data;
 	const struct structs_type *etype;
-	void *mem;
 
 	/* Find array */
-	if ((type = structs_find(type, name, (const void **)&ary, 0)) == NULL)
+	if ((type = structs_find_flags(type, name, (const void **)&ary,
+				       STRUCTS_FIND_UNSHARE)) == NULL)
 		return (-1);
 	etype = type->args[0].v;
 
@@ -354,10 +421,8 @@ int structs_array_insert(const struct structs_type *type,
 	}
 
 	/* Reallocate array, leaving room for new element and a shift */
-	if ((mem =
-	     realloc(ary->elems, (ary->length + 2) * etype->size)) == NULL)
+	if (structs_array_grow(type, ary, ary->length + 2) == -1)
 		return (-1);
-	ary->elems = mem;
 
 	/* Initialize new element; we'll move it into place later */
 	if ((*etype->init) (etype,
@@ -383,7 +448,8 @@ int structs_array_delete(const struct structs_type *type,
 	struct structs_array *ary = data;
 
 	/* Find array */
-	if ((type = structs_find(type, name, (const void **)&ary, 0)) == NULL)
+	if ((type = structs_find_flags(type, name, (const void **)&ary,
+				       STRUCTS_FIND_UNSHARE)) == NULL)
 		return (-1);
 	etype = type->args[0].v;
 
@@ -433,7 +499,7 @@ int structs_array_prep(const struct structs_type *type,
 		return (0);
 
 	/* Copy name into writable buffer */
-	if ((nbuf = calloc(1, strlen(name) + 2)) == NULL)
+	if ((nbuf = structs_mem_calloc(1, strlen(name) + 2)) == NULL)
 		return (-1);
 	nbuf[0] = '*';		/* for debugging */
 	strcpy(nbuf + 1, name);
@@ -450,10 +516,10 @@ int structs_array_prep(const struct structs_type *type,
 		/* Go to next descendant node using prefix of name */
 		ch = *s;
 		*s = '\0';
-		if ((atype = structs_find(type,
-					  nbuf + (s != nbuf),
-					  (const void **)&ary, 1)) == NULL) {
-			free(nbuf);
+		if ((atype = structs_find_flags(type, nbuf + (s != nbuf),
+		    (const void **)&ary,
+		    STRUCTS_FIND_UNION | STRUCTS_FIND_UNSHARE)) == NULL) {
+			structs_mem_free(nbuf);
 			return (-1);
 		}
 		*s = ch;
@@ -468,7 +534,7 @@ int structs_array_prep(const struct structs_type *type,
 		index = strtoul(s + 1, &eptr, 10);
 		if (eptr == s + 1 || *eptr != '\0') {
 			errno = ENOENT;
-			free(nbuf);
+			structs_mem_free(nbuf);
 			return (-1);
 		}
 
@@ -479,13 +545,13 @@ int structs_array_prep(const struct structs_type *type,
 		/* Must be setting the next new item in the array */
 		if (index != ary->length) {
 			errno = ENOENT;
-			free(nbuf);
+			structs_mem_free(nbuf);
 			return (-1);
 		}
 
 		/* Add new item; it will be in an initialized state */
 		if (structs_array_insert(atype, NULL, ary->length, ary) == -1) {
-			free(nbuf);
+			structs_mem_free(nbuf);
 			return (-1);
 		}
 
@@ -496,7 +562,7 @@ next:
 	}
 
 	/* Done */
-	free(nbuf);
+	structs_mem_free(nbuf);
 	return (0);
 }
 
@@ -516,7 +582,8 @@ int structs_array_setsize(const struct structs_type *type,
 	int idx;
 
 	/* Find array */
-	if ((type = structs_find(type, name, (const void **)&ary, 0)) == NULL)
+	if ((type = structs_find_flags(type, name, (const void **)&ary,
+				       STRUCTS_FIND_UNSHARE)) == NULL)
 		return (-1);
 	etype = type->args[0].v;
 	mem_type = type->args[1].v;
@@ -537,15 +604,17 @@ int structs_array_setsize(const struct structs_type *type,
 	}
 	/* Check size for 0 - free elements */
 	if (nitems == 0) {
-		free(ary->elems);
+		structs_mem_free(ary->elems);
 		ary->elems = NULL;
 		ary->length = 0;
+		structs_array_setcap(type, ary, 0);
 		return (0);
 	}
 
-	/* Reallocate array, leaving room for new element and a shift */
-	if ((mem = realloc(ary->elems, nitems * etype->size)) == NULL)
+	/* Reallocate array */
+	if (structs_array_grow(type, ary, nitems) == -1)
 		return (-1);
+	mem = ary->elems;
 
 	/* Zero out any new memory */
 	if (nitems > ary->length) {
@@ -564,11 +633,143 @@ int structs_array_setsize(const struct structs_type *type,
 			}
 		}
 	}
-	ary->elems = mem;
 	ary->length = nitems;
 	return (0);
 }
 
+/*
+ * Make room for at least "nitems" elements in an array that tracks
+ * its capacity, so it can grow to that length without reallocating.
+ */
+int structs_array_reserve(const struct structs_type *type,
+			  const char *name, unsigned int nitems, void *data)
+{
+	struct structs_array *ary = data;
+
+	/* Find array */
+	if ((type = structs_find_flags(type, name, (const void **)&ary,
+				       STRUCTS_FIND_UNSHARE)) == NULL)
+		return (-1);
+
+	/* Make sure it's really an array type */
+	if (type->tclass != STRUCTS_TYPE_ARRAY) {
+		errno = EINVAL;
+		return (-1);
+	}
+
+	/* Other arrays are always allocated to their exact length */
+	if (!STRUCTS_ARRAY_VARIABLE(type))
+		return (0);
+	return (structs_array_grow(type, ary, nitems));
+}
+
+int structs_array_grow(const struct structs_type *type, void *data,
+		       unsigned int nitems)
+{
+	const struct structs_type *const etype = type->args[0].v;
+	struct structs_varray *const vary = data;
+	struct structs_array *const ary = data;
+	unsigned int capacity;
+	void *mem;
+
+	/* Other arrays are reallocated to the exact size */
+	if (!STRUCTS_ARRAY_VARIABLE(type)) {
+		if ((mem = structs_mem_realloc(ary->elems,
+					       nitems * etype->size)) == NULL)
+			return (-1);
+		ary->elems = mem;
+		return (0);
+	}
+
+	/* Double the capacity, or more if that's not enough */
+	if (nitems <= vary->capacity)
+		return (0);
+	capacity = vary->capacity <= UINT_MAX / 2 ?
+	    MAX(vary->capacity * 2, STRUCTS_VARRAY_MIN) : UINT_MAX;
+	if (capacity < nitems)
+		capacity = nitems;
+	if (etype->size != 0 && capacity > SIZE_MAX / etype->size) {
+		errno = ENOMEM;
+		return (-1);
+	}
+	if ((mem = structs_mem_realloc(vary->elems,
+				       capacity * etype->size)) == NULL)
+		return (-1);
+	vary->elems = mem;
+	vary->capacity = capacity;
+	return (0);
+}
+
+/*
+ * Record the capacity of an array, if it tracks it.
+ */
+static void structs_array_setcap(const struct structs_type *type, void *data,
+				 unsigned int capacity)
+{
+	if (STRUCTS_ARRAY_VARIABLE(type))
+		((struct structs_varray *)data)->capacity = capacity;
+}
+
+/*
+ * Copy a range of array elements. If there's a failure, the elements
+ * of the range already copied are freed.
+ */
+static int structs_array_copy_range(void *arg, unsigned int start,
+				    unsigned int end)
+{
+	const struct structs_array_range *const range = arg;
+	const struct structs_type *const etype = range->etype;
+	unsigned int i;
+
+	for (i = start; i < end; i++) {
+		if ((*etype->copy) (etype,
+				    (char *)range->from + (i * etype->size),
+				    (char *)range->to + (i * etype->size))
+		    == -1) {
+			const int errno_save = errno;
+
+			structs_array_free_range(arg, start, i);
+			errno = errno_save;
+			return (-1);
+		}
+	}
+	return (0);
+}
+
+/*
+ * Free a range of array elements.
+ */
+static int structs_array_free_range(void *arg, unsigned int start,
+				    unsigned int end)
+{
+	const struct structs_array_range *const range = arg;
+	const struct structs_type *const etype = range->etype;
+	unsigned int i;
+
+	for (i = start; i < end; i++)
+		(*etype->uninit) (etype, (char *)range->to + (i * etype->size));
+	return (0);
+}
+
+/*
+ * Compare a range of array elements. Returns 1 if any are not equal.
+ */
+static int structs_array_equal_range(void *arg, unsigned int start,
+				     unsigned int end)
+{
+	const struct structs_array_range *const range = arg;
+	const struct structs_type *const etype = range->etype;
+	unsigned int i;
+
+	for (i = start; i < end; i++) {
+		if (!(*etype->equal) (etype,
+				      (char *)range->from + (i * etype->size),
+				      (char *)range->to + (i * etype->size)))
+			return (1);
+	}
+	return (0);
+}
+
 /*******************************************************************************
  * FIXED LENGTH ARRAYS
  ******************************************************************************/
@@ -579,6 +780,12 @@ int structs_fixedarray_init(const struct structs_type *type, void *data)
 	const unsigned int length = type->args[2].i;
 	unsigned int i;
 
+	/* Zero plain memory elements all at once */
+	if ((structs_pod_flags(type) & STRUCTS_POD_INIT) != 0) {
+		memset(data, 0, type->size);
+		return (0);
+	}
+
 	for (i = 0; i < length; i++) {
 		if ((*etype->init) (etype,
 				    (char *)data + (i * etype->size)) == -1) {
@@ -606,6 +813,12 @@ int structs_fixedarray_copy(const struct structs_type *type,
 		return (-1);
 	}
 
+	/* Copy plain memory elements all at once */
+	if ((structs_pod_flags(type) & STRUCTS_POD_COPY) != 0) {
+		memcpy(to, from, type->size);
+		return (0);
+	}
+
 	/* Copy elements into it */
 	for (i = 0; i < length; i++) {
 		const void *const from_elem = (char *)from + (i * etype->size);
@@ -638,6 +851,10 @@ int structs_fixedarray_equal(const struct structs_type *type,
 	if (type->tclass != STRUCTS_TYPE_FIXEDARRAY)
 		return (0);
 
+	/* Compare plain memory elements all at once */
+	if ((structs_pod_flags(type) & STRUCTS_POD_EQUAL) != 0)
+		return (memcmp(v1, v2, type->size) == 0);
+
 	/* Compare individual elements */
 	for (i = 0;
 	     i < length && (*etype->equal) (etype,
@@ -647,17 +864,62 @@ int structs_fixedarray_equal(const struct structs_type *type,
 	return (i == length);
 }
 
+int structs_fixedarray_compare(const struct structs_type *type,
+			       const void *v1, const void *v2)
+{
+	const struct structs_type *const etype = type->args[0].v;
+	const unsigned int length = type->args[2].i;
+	unsigned int i;
+	int r;
+
+	for (i = 0; i < length; i++) {
+		if ((r = structs_compare_item(etype,
+					      (char *)v1 + (i * etype->size),
+					      (char *)v2 + (i * etype->size)))
+		    != 0)
+			return (r);
+	}
+	return (0);
+}
+
+uint64_t structs_fixedarray_hash(const struct structs_type *type,
+				 const void *data)
+{
+	const struct structs_type *const etype = type->args[0].v;
+	const unsigned int length = type->args[2].i;
+	uint64_t hash = STRUCTS_HASH_INIT;
+	uint64_t ehash;
+	unsigned int i;
+
+	/* Hash plain memory elements all at once */
+	if ((structs_pod_flags(type) & STRUCTS_POD_EQUAL) != 0)
+		return (structs_hash_bytes(hash, data, type->size));
+
+	/* Combine hashes of individual elements */
+	for (i = 0; i < length; i++) {
+		ehash = structs_hash_item(etype,
+					  (char *)data + (i * etype->size));
+		hash = structs_hash_bytes(hash, &ehash, sizeof(ehash));
+	}
+	return (hash);
+}
+
 int structs_fixedarray_encode(const struct structs_type *type,
 			      struct structs_data *code, const void *data)
+{
+	return (structs_encoder_encode(type, code, data));
+}
+
+int structs_fixedarray_encode_into(const struct structs_type *type,
+				   struct structs_encoder *enc,
+				   const void *data)
 {
 	const struct structs_type *const etype = type->args[0].v;
 	const unsigned int length = type->args[2].i;
 	const unsigned int bitslen = NUM_BYTES(length);
-	struct structs_data *ecodes;
 	unsigned char *bits;
-	void *delem;
-	unsigned int tlen;
-	int r = -1;
+	const void *delem;
+	size_t boff;
 	unsigned int i;
 
 	/* Make sure it's really a fixedarray type */
@@ -667,64 +929,29 @@ int structs_fixedarray_encode(const struct structs_type *type,
 	}
 
 	/* Get the default value for an element */
-	if ((delem = calloc(1, etype->size)) == NULL)
+	if ((delem = structs_default(etype)) == NULL)
 		return (-1);
-	if (structs_init(etype, NULL, delem) == -1)
-		goto fail1;
 
-	/* Create bit array. Each bit indicates an element that is present. */
-	if ((bits = calloc(1, bitslen)) == NULL)
-		goto fail2;
+	/* Append bit array. Each bit indicates an element that is present. */
+	boff = enc->length;
+	if ((bits = structs_encoder_reserve(enc, bitslen)) == NULL)
+		return (-1);
 	memset(bits, 0, bitslen);
-	tlen = bitslen;
 
-	/* Create array of individual encodings, one per element */
-	if ((ecodes = calloc(1, length * sizeof(*ecodes))) == NULL)
-		goto fail3;
+	/* Append encoded elements */
 	for (i = 0; i < length; i++) {
 		const void *const elem = (char *)data + (i * etype->size);
-		struct structs_data *const ecode = &ecodes[i];
 
 		/* Check for default value, leave out if same as */
-		if ((*etype->equal) (etype, elem, delem) == 1) {
-			memset(ecode, 0, sizeof(*ecode));
+		if ((*etype->equal) (etype, elem, delem) == 1)
 			continue;
-		}
-		bits[i / 8] |= (1 << (i % 8));
+		enc->data[boff + i / 8] |= (1 << (i % 8));
 
 		/* Encode element */
-		if ((*etype->encode) (etype, ecode, elem) == -1)
-			goto fail4;
-		tlen += ecode->length;
-	}
-
-	/* Allocate final encoded region */
-	if ((code->data = calloc(1, tlen)) == NULL)
-		goto fail4;
-
-	/* Copy bits array */
-	memcpy(code->data, bits, bitslen);
-	code->length = bitslen;
-
-	/* Copy encoded elements */
-	for (i = 0; i < length; i++) {
-		struct structs_data *const ecode = &ecodes[i];
-
-		memcpy(code->data + code->length, ecode->data, ecode->length);
-		code->length += ecode->length;
+		if (structs_encode_into(etype, enc, elem) == -1)
+			return (-1);
 	}
-
-	/* OK */
-	r = 0;
-
-	/* Clean up and exit */
-fail4:	while (i-- > 0)
-		free(ecodes[i].data);
-	free(ecodes);
-fail3:	free(bits);
-fail2:	structs_free(etype, NULL, delem);
-fail1:	free(delem);
-	return (r);
+	return (0);
 }
 
 int structs_fixedarray_decode(const struct structs_type *type,
@@ -801,7 +1028,9 @@ void structs_fixedarray_free(const struct structs_type *type, void *data)
 	if (type->tclass != STRUCTS_TYPE_FIXEDARRAY)
 		return;
 
-	/* Free elements */
+	/* Free elements, unless there's no need */
+	if ((structs_pod_flags(type) & STRUCTS_POD_FREE) != 0)
+		return;
 	for (i = 0; i < length; i++)
 		(*etype->uninit) (etype, (char *)data + (i * etype->size));
 }
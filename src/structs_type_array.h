@@ -29,14 +29,50 @@
 		structs_array_encode,					\
 		structs_array_decode,					\
 		structs_array_free,					\
-		{ { (void *)(etype) }, { (void *)(etag) }, { NULL } }	\
+		{ { (void *)(etype) }, { (void *)(etag) }, { NULL } },	\
+		NULL,							\
+		structs_array_memsize,					\
+		structs_array_compare,					\
+		structs_array_hash,					\
+		structs_array_encode_into				\
+	}
+
+/*
+ * Same as STRUCTS_ARRAY_TYPE, but for a 'struct structs_varray' (see
+ * structs_type_array_define.h). Appending elements one at a time
+ * (including when decoding) takes amortized constant time, and
+ * structs_array_reserve() can make room for a known number of elements
+ * in advance. For other arrays, structs_array_reserve() does nothing.
+ */
+#define STRUCTS_VARRAY_TYPE(etype, etag) {				\
+		sizeof(struct structs_varray),				\
+		"varray",						\
+		STRUCTS_TYPE_ARRAY,					\
+		structs_region_init,					\
+		structs_array_copy,					\
+		structs_array_equal,					\
+		structs_notsupp_ascify,					\
+		structs_notsupp_binify,					\
+		structs_array_encode,					\
+		structs_array_decode,					\
+		structs_array_free,					\
+		{ { (void *)(etype) }, { (void *)(etag) }, { (void *)1 } }, \
+		NULL,							\
+		structs_array_memsize,					\
+		structs_array_compare,					\
+		structs_array_hash,					\
+		structs_array_encode_into				\
 	}
 
 extern structs_copy_t structs_array_copy;
 extern structs_equal_t structs_array_equal;
 extern structs_encode_t structs_array_encode;
+extern structs_encode_into_t structs_array_encode_into;
 extern structs_decode_t structs_array_decode;
 extern structs_uninit_t structs_array_free;
+extern structs_memsize_t structs_array_memsize;
+extern structs_compare_t structs_array_compare;
+extern structs_hash_t structs_array_hash;
 
 /*
  * Additional functions for handling arrays
@@ -54,6 +90,9 @@ extern int structs_array_insert(const struct structs_type *type,
 extern int structs_array_delete(const struct structs_type *type,
 				const char *name, unsigned int indx,
 				void *data);
+extern int structs_array_reserve(const struct structs_type *type,
+				 const char *name, unsigned int nitems,
+				 void *data);
 extern int structs_array_prep(const struct structs_type *type, const char *name,
 			      void *data);
 
@@ -84,15 +123,23 @@ extern int structs_array_prep(const struct structs_type *type, const char *name,
 			structs_fixedarray_encode,			\
 			structs_fixedarray_decode,			\
 			structs_fixedarray_free,			\
-		{ { (void *)(etype) }, { (void *)(etag) }, { (void *)(alen) } } \
+		{ { (void *)(etype) }, { (void *)(etag) }, { (void *)(alen) } }, \
+			NULL,						\
+			NULL,						\
+			structs_fixedarray_compare,			\
+			structs_fixedarray_hash,			\
+			structs_fixedarray_encode_into			\
 	}
 
 extern structs_init_t structs_fixedarray_init;
 extern structs_copy_t structs_fixedarray_copy;
 extern structs_equal_t structs_fixedarray_equal;
 extern structs_encode_t structs_fixedarray_encode;
+extern structs_encode_into_t structs_fixedarray_encode_into;
 extern structs_decode_t structs_fixedarray_decode;
 extern structs_uninit_t structs_fixedarray_free;
+extern structs_compare_t structs_fixedarray_compare;
+extern structs_hash_t structs_fixedarray_hash;
 
 #endif /* _STRUCTS_TYPE_ARRAY_H_ */
 /*******************************************************************************
@@ -48,6 +48,33 @@ typedef struct structs_array {
 		const etype *elems; /* array elements */                \
 	} name
 
+/*
+ * Arrays that remember how many elements they have room for, so they
+ * can grow geometrically. The data must be a 'struct structs_varray',
+ * or a structure defined using the DEFINE_STRUCTS_VARRAY() macro.
+ *
+ * The first two fields are the same as 'struct structs_array'.
+ */
+typedef struct structs_varray {
+	unsigned int length;	/* number of elements in array */
+	void *elems;		/* array elements */
+	unsigned int capacity;	/* number of elements allocated */
+} structs_varray;
+
+#define DEFINE_STRUCTS_VARRAY(name, etype)				\
+	struct name {							\
+		unsigned int   length;     /* number of elements in array */ \
+		etype   *elems;     /* array elements */                \
+		unsigned int   capacity;   /* number of elements allocated */ \
+	}
+
+#define DEFINE_STRUCTS_VARRAY_T(name, etype)				\
+	typedef struct name {						\
+		unsigned int   length;     /* number of elements in array */ \
+		etype   *elems;     /* array elements */                \
+		unsigned int   capacity;   /* number of elements allocated */ \
+	} name
+
 #endif /* _STRUCTS_TYPE_ARRAY_DEFINE_H_ */
 /*******************************************************************************
  * END OF FILE
@@ -13,6 +13,7 @@
 
 /* Module Includes */
 #include "structs.h"
+#include "structs_alloc.h"
 #include "structs_type_array.h"
 #include "structs_type_boolean.h"
 
@@ -48,7 +49,12 @@
 		structs_region_encode_netorder,		\
 		structs_region_decode_netorder,		\
 		structs_nothing_free,			\
-		{ { (void *)arg1 }, { (void *)arg2 } }  \
+		{ { (void *)arg1 }, { (void *)arg2 } }, \
+		structs_boolean_ascify_into,		\
+		NULL,					\
+		structs_region_compare,			\
+		structs_region_hash,			\
+		structs_region_encode_netorder_into	\
 	}
 
 /* ASCII possibilities (not all are used yet) */
@@ -63,6 +69,7 @@ static const char *boolean_strings[][2] = {
 
 /* Methods */
 static structs_ascify_t structs_boolean_ascify;
+static structs_ascify_into_t structs_boolean_ascify_into;
 static structs_binify_t structs_boolean_binify;
 
 /* Pre-defined types */
@@ -83,7 +90,20 @@ static char *structs_boolean_ascify(const struct structs_type *type,
 	truth =
 		type->args[0].
 		i ? *((unsigned int *)data) : *((unsigned char *)data);
-	return (strdup(boolean_strings[type->args[1].i][!!truth]));
+	return (structs_mem_strdup(boolean_strings[type->args[1].i][!!truth]));
+}
+
+static int structs_boolean_ascify_into(const struct structs_type *type,
+				       const void *data, char *buf,
+				       size_t bufmax)
+{
+	int truth;
+
+	truth =
+		type->args[0].
+		i ? *((unsigned int *)data) : *((unsigned char *)data);
+	return (snprintf(buf, bufmax, "%s",
+			 boolean_strings[type->args[1].i][!!truth]));
 }
 
 static int structs_boolean_binify(const struct structs_type *type,
@@ -0,0 +1,560 @@
+/*******************************************************************************
+ * HEADERS
+ ******************************************************************************/
+
+/* Standard Includes */
+#include <sys/types.h>
+#include <netinet/in.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+/* Module Includes */
+#include "structs.h"
+#include "structs_alloc.h"
+#include "structs_type_data.h"
+#include "structs_type_string.h"
+#include "structs_type_pointer.h"
+#include "structs_type_cow.h"
+#include "structs_internal.h"
+
+/*******************************************************************************
+ * MACROS/VARIABLES
+ ******************************************************************************/
+
+/* A shared buffer */
+struct structs_cow {
+	const struct structs_allocator *alloc;	/* where it came from */
+	unsigned int refs;	/* number of references */
+	size_t len;		/* length of buffer */
+	unsigned char buf[];	/* the buffer itself */
+};
+
+/* Get the header of a shared buffer */
+#define STRUCTS_COW_HDR(p)						\
+	((struct structs_cow *)((char *)(p)				\
+	    - offsetof(struct structs_cow, buf)))
+
+/* The empty string, which is not counted */
+static const char structs_cow_empty[] = "";
+
+/*******************************************************************************
+ * FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+static void *structs_cow_alloc(const void *data, size_t len);
+static void *structs_cow_share(const void *buf);
+static void *structs_cow_writable(void *buf);
+static void structs_cow_release(void *buf);
+static void structs_cow_memsize(const void *buf, structs_memblock_t *block,
+				void *arg);
+static void *structs_cow_pointer_new(const struct structs_type *ptype);
+static void structs_cow_pointer_release(const struct structs_type *ptype,
+					void *buf);
+
+/*******************************************************************************
+ * SHARED BUFFERS
+ ******************************************************************************/
+
+/*
+ * Allocate a new buffer using the current allocator and copy "len"
+ * bytes of "data" into it.
+ */
+static void *structs_cow_alloc(const void *data, size_t len)
+{
+	const struct structs_allocator *const alloc = structs_get_allocator();
+	struct structs_cow *cow;
+
+	if (len > SIZE_MAX - sizeof(*cow)) {
+		errno = ENOMEM;
+		return (NULL);
+	}
+	if ((cow = (*alloc->malloc) (alloc->arg, sizeof(*cow) + len)) == NULL)
+		return (NULL);
+	cow->alloc = alloc;
+	cow->refs = 1;
+	cow->len = len;
+	memcpy(cow->buf, data, len);
+	return (cow->buf);
+}
+
+/*
+ * Get another reference to a buffer, or a copy of it if it came
+ * from some other allocator.
+ */
+static void *structs_cow_share(const void *buf)
+{
+	struct structs_cow *const cow = STRUCTS_COW_HDR(buf);
+
+	if (cow->alloc != structs_get_allocator())
+		return (structs_cow_alloc(cow->buf, cow->len));
+	__atomic_add_fetch(&cow->refs, 1, __ATOMIC_RELAXED);
+	return (cow->buf);
+}
+
+/*
+ * Get a private version of a buffer, releasing the original if it
+ * had to be copied.
+ */
+static void *structs_cow_writable(void *buf)
+{
+	struct structs_cow *const cow = STRUCTS_COW_HDR(buf);
+	void *copy;
+
+	if (__atomic_load_n(&cow->refs, __ATOMIC_ACQUIRE) == 1)
+		return (buf);
+	if ((copy = structs_cow_alloc(cow->buf, cow->len)) == NULL)
+		return (NULL);
+	structs_cow_release(buf);
+	return (copy);
+}
+
+/*
+ * Drop a reference to a buffer, freeing it if it was the last one.
+ */
+static void structs_cow_release(void *buf)
+{
+	struct structs_cow *const cow = STRUCTS_COW_HDR(buf);
+	const struct structs_allocator *const alloc = cow->alloc;
+
+	if (__atomic_sub_fetch(&cow->refs, 1, __ATOMIC_ACQ_REL) == 0)
+		(*alloc->free) (alloc->arg, cow);
+}
+
+/*
+ * Report the block holding a buffer.
+ */
+static void structs_cow_memsize(const void *buf, structs_memblock_t *block,
+				void *arg)
+{
+	const struct structs_cow *const cow = STRUCTS_COW_HDR(buf);
+
+	(*block) (arg, cow, sizeof(*cow) + cow->len);
+}
+
+/*******************************************************************************
+ * COPY-ON-WRITE BINARY DATA TYPE
+ ******************************************************************************/
+
+int structs_cow_data_copy(const struct structs_type *type,
+			  const void *from, void *to)
+{
+	const struct structs_data *const fdata = from;
+	struct structs_data *const tdata = to;
+	unsigned char *buf;
+
+	if (fdata->length == 0) {
+		memset(tdata, 0, sizeof(*tdata));
+		return (0);
+	}
+	if ((buf = structs_cow_share(fdata->data)) == NULL)
+		return (-1);
+	tdata->data = buf;
+	tdata->length = fdata->length;
+	return (0);
+}
+
+int structs_cow_data_equal(const struct structs_type *type,
+			   const void *v1, const void *v2)
+{
+	const struct structs_data *const d1 = v1;
+	const struct structs_data *const d2 = v2;
+
+	return (d1->length == d2->length
+		&& (d1->data == d2->data
+		    || memcmp(d1->data, d2->data, d1->length) == 0));
+}
+
+int structs_cow_data_binify(const struct structs_type *type,
+			    const char *ascii, void *data,
+			    char *ebuf, size_t emax)
+{
+	struct structs_data *const d = data;
+	struct structs_data temp;
+	unsigned char *buf = NULL;
+
+	/* Decode into a normal buffer */
+	if (structs_data_binify(type, ascii, &temp, ebuf, emax) == -1)
+		return (-1);
+
+	/* Move it into a shared one */
+	if (temp.length > 0
+	    && (buf = structs_cow_alloc(temp.data, temp.length)) == NULL) {
+		structs_mem_free(temp.data);
+		return (-1);
+	}
+	structs_mem_free(temp.data);
+	d->data = buf;
+	d->length = temp.length;
+	return (0);
+}
+
+int structs_cow_data_decode(const struct structs_type *type,
+			    const unsigned char *code, size_t cmax,
+			    void *data, char *ebuf, size_t emax)
+{
+	struct structs_data *const d = data;
+	u_int32_t elength;
+	size_t length;
+
+	if (cmax < 4)
+		goto bogus;
+	memcpy(&elength, code, 4);
+	length = ntohl(elength);
+	if (cmax - 4 < length) {
+bogus:		strncpy(ebuf, "encoded data is corrupted", emax);
+		errno = EINVAL;
+		return (-1);
+	}
+	if (length == 0)
+		d->data = NULL;
+	else if ((d->data = structs_cow_alloc(code + 4, length)) == NULL)
+		return (-1);
+	d->length = length;
+	return (4 + length);
+}
+
+void structs_cow_data_free(const struct structs_type *type, void *data)
+{
+	struct structs_data *const d = data;
+
+	if (d->data != NULL)
+		structs_cow_release(d->data);
+	memset(d, 0, sizeof(*d));
+}
+
+void structs_cow_data_memsize(const struct structs_type *type,
+			      const void *data, structs_memblock_t *block,
+			      void *arg)
+{
+	const struct structs_data *const d = data;
+
+	if (d->data != NULL)
+		structs_cow_memsize(d->data, block, arg);
+}
+
+unsigned char *structs_cow_data_writable(struct structs_data *d)
+{
+	unsigned char *buf;
+
+	if (d->data == NULL)
+		return (NULL);
+	if ((buf = structs_cow_writable(d->data)) == NULL)
+		return (NULL);
+	d->data = buf;
+	return (buf);
+}
+
+const struct structs_type structs_type_cow_data = STRUCTS_COW_DATA_TYPE(NULL);
+
+const struct structs_type structs_type_cow_hexdata = STRUCTS_COW_DATA_TYPE("");
+
+/*******************************************************************************
+ * COPY-ON-WRITE STRING TYPE
+ ******************************************************************************/
+
+int structs_cow_string_init(const struct structs_type *type, void *data)
+{
+	*((const char **)data) = structs_cow_empty;
+	return (0);
+}
+
+int structs_cow_string_copy(const struct structs_type *type,
+			    const void *from, void *to)
+{
+	const char *s = *((const char *const *)from);
+
+	if (s != NULL && s != structs_cow_empty
+	    && (s = structs_cow_share(s)) == NULL)
+		return (-1);
+	*((const char **)to) = s != NULL ? s : structs_cow_empty;
+	return (0);
+}
+
+int structs_cow_string_equal(const struct structs_type *type,
+			     const void *v1, const void *v2)
+{
+	const char *const s1 = *((const char *const *)v1);
+	const char *const s2 = *((const char *const *)v2);
+
+	return (s1 == s2 || strcmp(s1 != NULL ? s1 : "",
+				   s2 != NULL ? s2 : "") == 0);
+}
+
+int structs_cow_string_compare(const struct structs_type *type,
+			       const void *v1, const void *v2)
+{
+	const char *const s1 = *((const char *const *)v1);
+	const char *const s2 = *((const char *const *)v2);
+
+	if (s1 == s2)
+		return (0);
+	return (strcmp(s1 != NULL ? s1 : "", s2 != NULL ? s2 : ""));
+}
+
+char *structs_cow_string_ascify(const struct structs_type *type,
+				const void *data)
+{
+	const char *const s = *((const char *const *)data);
+
+	return (structs_mem_strdup(s != NULL ? s : ""));
+}
+
+int structs_cow_string_ascify_into(const struct structs_type *type,
+				   const void *data, char *buf, size_t bufmax)
+{
+	const char *const s = *((const char *const *)data);
+
+	return (snprintf(buf, bufmax, "%s", s != NULL ? s : ""));
+}
+
+int structs_cow_string_binify(const struct structs_type *type,
+			      const char *ascii, void *data,
+			      char *ebuf, size_t emax)
+{
+	const char *s = structs_cow_empty;
+
+	if (*ascii != '\0'
+	    && (s = structs_cow_alloc(ascii, strlen(ascii) + 1)) == NULL)
+		return (-1);
+	*((const char **)data) = s;
+	return (0);
+}
+
+void structs_cow_string_free(const struct structs_type *type, void *data)
+{
+	const char *const s = *((const char **)data);
+
+	if (s != NULL && s != structs_cow_empty)
+		structs_cow_release((void *)s);
+	*((const char **)data) = NULL;
+}
+
+void structs_cow_string_memsize(const struct structs_type *type,
+				const void *data, structs_memblock_t *block,
+				void *arg)
+{
+	const char *const s = *((const char *const *)data);
+
+	if (s != NULL && s != structs_cow_empty)
+		structs_cow_memsize(s, block, arg);
+}
+
+char *structs_cow_string_writable(const char **sp)
+{
+	char *s;
+
+	/* The empty string has no characters to modify */
+	if (*sp == NULL || *sp == structs_cow_empty) {
+		*sp = structs_cow_empty;
+		return ((char *)structs_cow_empty);
+	}
+	if ((s = structs_cow_writable((void *)*sp)) == NULL)
+		return (NULL);
+	*sp = s;
+	return (s);
+}
+
+const struct structs_type structs_type_cow_string = STRUCTS_COW_STRING_TYPE;
+
+/*******************************************************************************
+ * COPY-ON-WRITE POINTER TYPE
+ ******************************************************************************/
+
+/*
+ * Allocate a new zeroed referent using the current allocator.
+ */
+static void *structs_cow_pointer_new(const struct structs_type *ptype)
+{
+	const struct structs_allocator *const alloc = structs_get_allocator();
+	struct structs_cow *cow;
+
+	if ((cow = (*alloc->malloc) (alloc->arg,
+				     sizeof(*cow) + ptype->size)) == NULL)
+		return (NULL);
+	cow->alloc = alloc;
+	cow->refs = 1;
+	cow->len = ptype->size;
+	memset(cow->buf, 0, ptype->size);
+	return (cow->buf);
+}
+
+/*
+ * Drop a reference to a referent, freeing it if it was the last one.
+ * The referent's contents came from the same allocator it did.
+ */
+static void structs_cow_pointer_release(const struct structs_type *ptype,
+					void *buf)
+{
+	struct structs_cow *const cow = STRUCTS_COW_HDR(buf);
+	const struct structs_allocator *const alloc = cow->alloc;
+	const struct structs_allocator *prev;
+
+	if (__atomic_sub_fetch(&cow->refs, 1, __ATOMIC_ACQ_REL) != 0)
+		return;
+	prev = structs_set_thread_allocator(alloc);
+	(*ptype->uninit) (ptype, buf);
+	structs_set_thread_allocator(prev);
+	(*alloc->free) (alloc->arg, cow);
+}
+
+int structs_cow_pointer_init(const struct structs_type *type, void *data)
+{
+	const struct structs_type *const ptype = type->args[0].v;
+	void *buf;
+
+	if ((buf = structs_cow_pointer_new(ptype)) == NULL)
+		return (-1);
+	if ((*ptype->init) (ptype, buf) == -1) {
+		structs_cow_release(buf);
+		return (-1);
+	}
+	*((void **)data) = buf;
+	return (0);
+}
+
+int structs_cow_pointer_copy(const struct structs_type *type,
+			     const void *from, void *to)
+{
+	const struct structs_type *const ptype = type->args[0].v;
+	void *const fbuf = *((void *const *)from);
+	struct structs_cow *const cow = STRUCTS_COW_HDR(fbuf);
+	void *buf;
+
+	/* Share the referent if it came from the same allocator */
+	if (cow->alloc == structs_get_allocator()) {
+		__atomic_add_fetch(&cow->refs, 1, __ATOMIC_RELAXED);
+		*((void **)to) = fbuf;
+		return (0);
+	}
+
+	/* Otherwise make a copy of it */
+	if ((buf = structs_cow_pointer_new(ptype)) == NULL)
+		return (-1);
+	if ((*ptype->copy) (ptype, fbuf, buf) == -1) {
+		structs_cow_release(buf);
+		return (-1);
+	}
+	*((void **)to) = buf;
+	return (0);
+}
+
+int structs_cow_pointer_equal(const struct structs_type *type,
+			      const void *v1, const void *v2)
+{
+	const struct structs_type *const ptype = type->args[0].v;
+	const void *const buf1 = *((void *const *)v1);
+	const void *const buf2 = *((void *const *)v2);
+
+	return (buf1 == buf2 || (*ptype->equal) (ptype, buf1, buf2));
+}
+
+int structs_cow_pointer_binify(const struct structs_type *type,
+			       const char *ascii, void *data,
+			       char *ebuf, size_t emax)
+{
+	const struct structs_type *const ptype = type->args[0].v;
+	void *buf;
+
+	if ((buf = structs_cow_pointer_new(ptype)) == NULL) {
+		strncpy(ebuf, strerror(errno), emax);
+		return (-1);
+	}
+	if ((*ptype->binify) (ptype, ascii, buf, ebuf, emax) == -1) {
+		structs_cow_release(buf);
+		return (-1);
+	}
+	*((void **)data) = buf;
+	return (0);
+}
+
+int structs_cow_pointer_decode(const struct structs_type *type,
+			       const u_char *code, size_t cmax, void *data,
+			       char *ebuf, size_t emax)
+{
+	const struct structs_type *const ptype = type->args[0].v;
+	void *buf;
+	int r;
+
+	if ((buf = structs_cow_pointer_new(ptype)) == NULL) {
+		strncpy(ebuf, strerror(errno), emax);
+		return (-1);
+	}
+	if ((r = (*ptype->decode) (ptype, code, cmax, buf, ebuf, emax)) == -1) {
+		structs_cow_release(buf);
+		return (-1);
+	}
+	*((void **)data) = buf;
+	return (r);
+}
+
+void structs_cow_pointer_free(const struct structs_type *type, void *data)
+{
+	const struct structs_type *const ptype = type->args[0].v;
+	void *const buf = *((void **)data);
+
+	if (buf != NULL)
+		structs_cow_pointer_release(ptype, buf);
+	*((void **)data) = NULL;
+}
+
+void structs_cow_pointer_memsize(const struct structs_type *type,
+				 const void *data, structs_memblock_t *block,
+				 void *arg)
+{
+	const void *const buf = *((void *const *)data);
+
+	if (buf != NULL)
+		structs_cow_memsize(buf, block, arg);
+}
+
+/*
+ * Give a copy-on-write pointer a private referent.
+ */
+int structs_cow_pointer_unshare(const struct structs_type *type, void *data)
+{
+	const struct structs_type *const ptype = type->args[0].v;
+	void *const obuf = *((void **)data);
+	void *buf;
+
+	if (type->copy != structs_cow_pointer_copy
+	    || __atomic_load_n(&STRUCTS_COW_HDR(obuf)->refs,
+			       __ATOMIC_ACQUIRE) == 1)
+		return (0);
+	if ((buf = structs_cow_pointer_new(ptype)) == NULL)
+		return (-1);
+	if ((*ptype->copy) (ptype, obuf, buf) == -1) {
+		structs_cow_release(buf);
+		return (-1);
+	}
+	structs_cow_pointer_release(ptype, obuf);
+	*((void **)data) = buf;
+	return (0);
+}
+
+int structs_cow_unshare(const struct structs_type *type,
+			const char *name, void *data)
+{
+	/* Find item, unsharing pointers on the way */
+	if ((type = structs_find_flags(type, name, (const void **)&data,
+				       STRUCTS_FIND_UNSHARE)) == NULL)
+		return (-1);
+
+	/* Unshare the item itself if it is a pointer */
+	while (type->tclass == STRUCTS_TYPE_POINTER) {
+		if (structs_cow_pointer_unshare(type, data) == -1)
+			return (-1);
+		data = *((void **)data);
+		type = type->args[0].v;
+	}
+	return (0);
+}
+
+/*******************************************************************************
+ * END OF FILE
+ ******************************************************************************/
@@ -0,0 +1,180 @@
+#ifndef _STRUCTS_TYPE_COW_H_
+#define _STRUCTS_TYPE_COW_H_
+
+/*******************************************************************************
+ * COPY-ON-WRITE TYPES
+ ******************************************************************************/
+
+/*
+ * These types have the same values and encodings as structs_type_data
+ * and structs_type_string, but their buffers are reference counted and
+ * shared by copies, so copying one costs the same whatever its length.
+ *
+ * Setting a value (e.g., with structs_set_string() or structs_set_binary())
+ * always gives it a new buffer, so other copies are never affected.
+ * Buffers must never be modified directly, except after calling one
+ * of the *_writable() functions below to obtain a private one.
+ *
+ * Copies only share a buffer if it came from the current allocator
+ * (see structs_alloc.h); otherwise, the buffer is duplicated. So
+ * copying out of an arena with a different allocator works as usual.
+ */
+
+/*
+ * Copy-on-write binary data type. The data is a "struct structs_data".
+ *
+ * Type-specific arguments:
+ *  [const char *]      Encoding character set (or NULL for default
+ *                      or empty string for hex encoding)
+ */
+extern structs_copy_t structs_cow_data_copy;
+extern structs_equal_t structs_cow_data_equal;
+extern structs_binify_t structs_cow_data_binify;
+extern structs_decode_t structs_cow_data_decode;
+extern structs_uninit_t structs_cow_data_free;
+extern structs_memsize_t structs_cow_data_memsize;
+
+#define STRUCTS_COW_DATA_TYPE(charset) {				\
+		sizeof(struct structs_data),				\
+			"cowdata",					\
+			STRUCTS_TYPE_PRIMITIVE,				\
+			structs_region_init,				\
+			structs_cow_data_copy,				\
+			structs_cow_data_equal,				\
+			structs_data_ascify,				\
+			structs_cow_data_binify,			\
+			structs_data_encode,				\
+			structs_cow_data_decode,			\
+			structs_cow_data_free,				\
+		{ { (void *)(charset) }, { NULL }, { NULL } },		\
+			NULL,						\
+			structs_cow_data_memsize,			\
+			structs_data_compare,				\
+			structs_data_hash,				\
+			structs_data_encode_into			\
+	}
+
+/* Copy-on-write type using default charset */
+extern const struct structs_type structs_type_cow_data;
+
+/* Copy-on-write type using hex ASCII encoding */
+extern const struct structs_type structs_type_cow_hexdata;
+
+/*
+ * Make the buffer of a copy-on-write data item private to it, duplicating
+ * it if it is shared, so that it may be modified in place.
+ *
+ * Returns the buffer (NULL if the length is zero), or NULL (and sets
+ * errno) if there was an error.
+ */
+extern unsigned char *structs_cow_data_writable(struct structs_data *d);
+
+/*
+ * Copy-on-write string type. Fields are declared as "const char *"
+ * and are never NULL once initialized.
+ *
+ * No type-specific arguments.
+ */
+extern structs_init_t structs_cow_string_init;
+extern structs_copy_t structs_cow_string_copy;
+extern structs_equal_t structs_cow_string_equal;
+extern structs_ascify_t structs_cow_string_ascify;
+extern structs_ascify_into_t structs_cow_string_ascify_into;
+extern structs_binify_t structs_cow_string_binify;
+extern structs_uninit_t structs_cow_string_free;
+extern structs_memsize_t structs_cow_string_memsize;
+extern structs_compare_t structs_cow_string_compare;
+
+#define STRUCTS_COW_STRING_TYPE {					\
+		sizeof(const char *),					\
+			"cowstring",					\
+			STRUCTS_TYPE_PRIMITIVE,				\
+			structs_cow_string_init,			\
+			structs_cow_string_copy,			\
+			structs_cow_string_equal,			\
+			structs_cow_string_ascify,			\
+			structs_cow_string_binify,			\
+			structs_string_encode,				\
+			structs_string_decode,				\
+			structs_cow_string_free,			\
+		{ { NULL }, { NULL }, { NULL } },			\
+			structs_cow_string_ascify_into,			\
+			structs_cow_string_memsize,			\
+			structs_cow_string_compare,			\
+			structs_string_hash,				\
+			structs_string_encode_into			\
+	}
+
+extern const struct structs_type structs_type_cow_string;
+
+/*
+ * Make the buffer of a copy-on-write string private to it, duplicating
+ * it if it is shared, so that its characters may be modified in place
+ * (its length must not change).
+ *
+ * Returns the buffer, or NULL (and sets errno) if there was an error.
+ */
+extern char *structs_cow_string_writable(const char **sp);
+
+/*
+ * Copy-on-write pointer type. This is the same as STRUCTS_POINTER_TYPE()
+ * (and has the same encodings), except that copies share the referent,
+ * so copying one costs the same however big the referent is. Putting
+ * large subtrees of a data structure behind copy-on-write pointers makes
+ * copies of the whole structure share them.
+ *
+ * Functions that modify an item by name, such as structs_set(),
+ * structs_set_string() and structs_array_insert(), first give each
+ * copy-on-write pointer on the way to it a private referent, so other
+ * copies are never affected. Anything modified directly must first be
+ * made private by calling structs_cow_unshare() with its name. Setting
+ * a copy-on-write pointer itself always gives it a new referent, as
+ * with the other types above.
+ *
+ * Macro arguments:
+ *  [const struct structs_type *] - Referent type
+ */
+extern structs_init_t structs_cow_pointer_init;
+extern structs_copy_t structs_cow_pointer_copy;
+extern structs_equal_t structs_cow_pointer_equal;
+extern structs_binify_t structs_cow_pointer_binify;
+extern structs_decode_t structs_cow_pointer_decode;
+extern structs_uninit_t structs_cow_pointer_free;
+extern structs_memsize_t structs_cow_pointer_memsize;
+
+#define STRUCTS_COW_POINTER_TYPE(reftype) {				\
+		sizeof(void *),						\
+			"cowpointer",					\
+			STRUCTS_TYPE_POINTER,				\
+			structs_cow_pointer_init,			\
+			structs_cow_pointer_copy,			\
+			structs_cow_pointer_equal,			\
+			structs_pointer_ascify,				\
+			structs_cow_pointer_binify,			\
+			structs_pointer_encode,				\
+			structs_cow_pointer_decode,			\
+			structs_cow_pointer_free,			\
+		{ { (void *)(reftype) }, { NULL }, { NULL } },		\
+			structs_pointer_ascify_into,			\
+			structs_cow_pointer_memsize,			\
+			structs_pointer_compare,			\
+			structs_pointer_hash,				\
+			structs_pointer_encode_into			\
+	}
+
+/*
+ * Make item "name" of a data structure safe to modify, by giving each
+ * copy-on-write pointer on the way to it (and the item itself, if it is
+ * one) a private copy of its referent if it is shared. The copies share
+ * everything below them, so this costs time and memory proportional
+ * to the length of the path, not the size of the data structure.
+ *
+ * Returns 0 if successful, or -1 (and sets errno) if there was an error.
+ */
+extern int structs_cow_unshare(const struct structs_type *type,
+			       const char *name, void *data);
+
+#endif /* _STRUCTS_TYPE_COW_H_ */
+/*******************************************************************************
+ * END OF FILE
+ ******************************************************************************/
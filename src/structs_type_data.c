@@ -4,6 +4,7 @@
 
 /* Standard Includes */
 #include <sys/types.h>
+#include <sys/param.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -21,6 +22,7 @@
 
 /* Module Includes */
 #include "structs.h"
+#include "structs_alloc.h"
 #include "structs_type_array.h"
 #include "structs_type_data.h"
 #include "structs_filter.h"
@@ -49,7 +51,7 @@ int structs_data_copy(const struct structs_type *type,
 		memset(tdata, 0, sizeof(*tdata));
 		return (0);
 	}
-	if ((copy = calloc(1, fdata->length)) == NULL)
+	if ((copy = structs_mem_calloc(1, fdata->length)) == NULL)
 		return (-1);
 	memcpy(copy, fdata->data, fdata->length);
 	tdata->data = copy;
@@ -67,6 +69,27 @@ int structs_data_equal(const struct structs_type *type,
 		&& memcmp(d1->data, d2->data, d1->length) == 0);
 }
 
+int structs_data_compare(const struct structs_type *type,
+			 const void *v1, const void *v2)
+{
+	const struct structs_data *const d1 = v1;
+	const struct structs_data *const d2 = v2;
+	const unsigned int len = MIN(d1->length, d2->length);
+	int r;
+
+	if (len > 0 && d1->data != d2->data
+	    && (r = memcmp(d1->data, d2->data, len)) != 0)
+		return (r);
+	return ((d1->length > d2->length) - (d1->length < d2->length));
+}
+
+uint64_t structs_data_hash(const struct structs_type *type, const void *data)
+{
+	const struct structs_data *const d = data;
+
+	return (structs_hash_bytes(STRUCTS_HASH_INIT, d->data, d->length));
+}
+
 char *structs_data_ascify(const struct structs_type *type, const void *data)
 {
 	const char *const charmap = type->args[0].v;
@@ -78,7 +101,7 @@ char *structs_data_ascify(const struct structs_type *type, const void *data)
 
 	/* Handle hex encoding */
 	if (charmap != NULL && *charmap == '\0') {
-		if ((edata = calloc(1, d->length * 2 + 1)) == NULL)
+		if ((edata = structs_mem_calloc(1, d->length * 2 + 1)) == NULL)
 			return (NULL);
 		for (i = 0; i < d->length; i++) {
 			edata[i * 2] = hexchars[(d->data[i] >> 4) & 0x0f];
@@ -117,7 +140,8 @@ int structs_data_binify(const struct structs_type *type,
 
 	/* Handle hex encoding */
 	if (charmap != NULL && *charmap == '\0') {
-		if ((bdata = calloc(1, (strlen(ascii) + 1) / 2)) == NULL)
+		if ((bdata = structs_mem_calloc(1, (strlen(ascii) + 1) / 2))
+		    == NULL)
 			return (-1);
 		for (blen = 0; *ascii != '\0'; blen++) {
 			while (isspace(*ascii))
@@ -130,7 +154,7 @@ int structs_data_binify(const struct structs_type *type,
 					strncpy(ebuf, *ascii == '\0' ?
 						"odd length hex sequence" :
 						"non-hex character seen", emax);
-					free(bdata);
+					structs_mem_free(bdata);
 					return (-1);
 				}
 				bdata[blen] |= HEXVAL(*ascii) << i;
@@ -163,17 +187,26 @@ void structs_data_free(const struct structs_type *type, void *data)
 {
 	struct structs_data *const d = data;
 
-	free(d->data);
+	structs_mem_free(d->data);
 	memset(d, 0, sizeof(*d));
 }
 
+void structs_data_memsize(const struct structs_type *type, const void *data,
+			  structs_memblock_t *block, void *arg)
+{
+	const struct structs_data *const d = data;
+
+	if (d->data != NULL)
+		(*block) (arg, d->data, d->length);
+}
+
 int structs_data_encode(const struct structs_type *type,
 			struct structs_data *code, const void *data)
 {
 	const struct structs_data *const d = data;
 	u_int32_t elength;
 
-	if ((code->data = calloc(1, 4 + d->length)) == NULL)
+	if ((code->data = structs_mem_calloc(1, 4 + d->length)) == NULL)
 		return (-1);
 	elength = htonl(d->length);
 	memcpy(code->data, &elength, 4);
@@ -182,6 +215,21 @@ int structs_data_encode(const struct structs_type *type,
 	return (0);
 }
 
+int structs_data_encode_into(const struct structs_type *type,
+			     struct structs_encoder *enc, const void *data)
+{
+	const struct structs_data *const d = data;
+	unsigned char *code;
+	u_int32_t elength;
+
+	if ((code = structs_encoder_reserve(enc, 4 + d->length)) == NULL)
+		return (-1);
+	elength = htonl(d->length);
+	memcpy(code, &elength, 4);
+	memcpy(code + 4, d->data, d->length);
+	return (0);
+}
+
 int structs_data_decode(const struct structs_type *type,
 			const unsigned char *code, size_t cmax,
 			void *data, char *ebuf, size_t emax)
@@ -198,7 +246,7 @@ bogus:		strncpy(ebuf, "encoded data is corrupted", emax);
 		errno = EINVAL;
 		return (-1);
 	}
-	if ((d->data = calloc(1, d->length)) == NULL)
+	if ((d->data = structs_mem_calloc(1, d->length)) == NULL)
 		return (-1);
 	memcpy(d->data, code + 4, d->length);
 	return (4 + d->length);
@@ -219,7 +267,7 @@ char *structs_fixeddata_ascify(const struct structs_type *type,
 	char *s;
 	int i;
 
-	if ((s = calloc(1, type->size * 2 + 1)) == NULL)
+	if ((s = structs_mem_calloc(1, type->size * 2 + 1)) == NULL)
 		return (NULL);
 	for (i = 0; i < type->size; i++) {
 		s[i * 2] = hexchars[(bytes[i] >> 4) & 0x0f];
@@ -265,7 +313,7 @@ fail:		errno = EINVAL;
 int structs_fixeddata_encode(const struct structs_type *type,
 			     struct structs_data *code, const void *data)
 {
-	if ((code->data = calloc(1, type->size)) == NULL)
+	if ((code->data = structs_mem_calloc(1, type->size)) == NULL)
 		return (-1);
 	memcpy(code->data, data, type->size);
 	code->length = type->size;
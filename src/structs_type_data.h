@@ -24,8 +24,12 @@ extern structs_equal_t structs_data_equal;
 extern structs_ascify_t structs_data_ascify;
 extern structs_binify_t structs_data_binify;
 extern structs_encode_t structs_data_encode;
+extern structs_encode_into_t structs_data_encode_into;
 extern structs_decode_t structs_data_decode;
 extern structs_uninit_t structs_data_free;
+extern structs_memsize_t structs_data_memsize;
+extern structs_compare_t structs_data_compare;
+extern structs_hash_t structs_data_hash;
 
 /*
  * Macro arguments:
@@ -45,7 +49,12 @@ extern structs_uninit_t structs_data_free;
 			structs_data_encode,			\
 			structs_data_decode,			\
 			structs_data_free,			\
-		{ { (void *)(charset) }, { NULL }, { NULL } }   \
+		{ { (void *)(charset) }, { NULL }, { NULL } },  \
+			NULL,					\
+			structs_data_memsize,			\
+			structs_data_compare,			\
+			structs_data_hash,			\
+			structs_data_encode_into		\
 	}
 
 /*
@@ -88,7 +97,12 @@ extern structs_decode_t structs_fixeddata_decode;
 			structs_fixeddata_encode,	\
 			structs_fixeddata_decode,	\
 			structs_nothing_free,		\
-		{ { NULL }, { NULL }, { NULL } }	\
+		{ { NULL }, { NULL }, { NULL } },	\
+			NULL,				\
+			NULL,				\
+			structs_region_compare,		\
+			structs_region_hash,		\
+			structs_region_encode_into	\
 	}
 
 #endif /* _STRUCTS_TYPE_DATA_H_ */
@@ -15,6 +15,7 @@
 
 /* Module Includes */
 #include "structs.h"
+#include "structs_alloc.h"
 #include "structs_type_array.h"
 #include "structs_type_ether.h"
 
@@ -23,20 +24,30 @@
  ******************************************************************************/
 
 static structs_ascify_t structs_ether_ascify;
+static structs_ascify_into_t structs_ether_ascify_into;
 static structs_binify_t structs_ether_binify;
 
 static char *structs_ether_ascify(const struct structs_type *type,
 				  const void *data)
+{
+	char buf[18];
+
+	structs_ether_ascify_into(type, data, buf, sizeof(buf));
+	return (structs_mem_strdup(buf));
+}
+
+static int structs_ether_ascify_into(const struct structs_type *type,
+				     const void *data, char *buf,
+				     size_t bufmax)
 {
 	const int colons = type->args[0].i;
 	const char *fmt = colons ?
 		"%02x:%02x:%02x:%02x:%02x:%02x" : "%02x%02x%02x%02x%02x%02x";
 	const unsigned char *const ether = data;
-	char buf[18];
 
-	snprintf(buf, sizeof(buf), fmt,
-		 ether[0], ether[1], ether[2], ether[3], ether[4], ether[5]);
-	return (strdup(buf));
+	return (snprintf(buf, bufmax, fmt,
+			 ether[0], ether[1], ether[2],
+			 ether[3], ether[4], ether[5]));
 }
 
 static int structs_ether_binify(const struct structs_type *type,
@@ -92,7 +103,12 @@ const struct structs_type structs_type_ether = {
 	structs_region_encode,
 	structs_region_decode,
 	structs_nothing_free,
-	{ { (void *)1} }
+	{ { (void *)1} },
+	structs_ether_ascify_into,
+	NULL,
+	structs_region_compare,
+	structs_region_hash,
+	structs_region_encode_into
 };
 
 const struct structs_type structs_type_ether_nocolon = {
@@ -107,7 +123,12 @@ const struct structs_type structs_type_ether_nocolon = {
 	structs_region_encode,
 	structs_region_decode,
 	structs_nothing_free,
-	{ { (void *)0} }
+	{ { (void *)0} },
+	structs_ether_ascify_into,
+	NULL,
+	structs_region_compare,
+	structs_region_hash,
+	structs_region_encode_into
 };
 
 /*******************************************************************************
@@ -16,6 +16,7 @@
 
 /* Module Includes */
 #include "structs.h"
+#include "structs_alloc.h"
 #include "structs_type_array.h"
 #include "structs_type_float.h"
 
@@ -34,7 +35,10 @@
 
 static structs_equal_t structs_float_equal;
 static structs_ascify_t structs_float_ascify;
+static structs_ascify_into_t structs_float_ascify_into;
 static structs_binify_t structs_float_binify;
+static structs_compare_t structs_float_compare;
+static structs_hash_t structs_float_hash;
 
 #define FTYPE_FLOAT 0
 #define FTYPE_DOUBLE 1
@@ -52,7 +56,12 @@ static structs_binify_t structs_float_binify;
 		structs_region_encode_netorder,			\
 		structs_region_decode_netorder,			\
 		structs_nothing_free,				\
-		{ { (void *)(ftype) } }                         \
+		{ { (void *)(ftype) } },                        \
+		structs_float_ascify_into,			\
+		NULL,						\
+		structs_float_compare,				\
+		structs_float_hash,				\
+		structs_region_encode_netorder_into		\
 	}							\
 
 /* Define the types */
@@ -85,31 +94,98 @@ int structs_float_equal(const struct structs_type *type,
 	}
 }
 
+/*
+ * Numbers are in their usual order, with NaNs after all of them. NaNs
+ * compare equal to each other, unlike in structs_float_equal().
+ */
+int structs_float_compare(const struct structs_type *type,
+			  const void *v1, const void *v2)
+{
+	double d1;
+	double d2;
+
+	switch (type->args[0].i) {
+	case FTYPE_FLOAT:
+		d1 = *((const float *)v1);
+		d2 = *((const float *)v2);
+		break;
+	case FTYPE_DOUBLE:
+		d1 = *((const double *)v1);
+		d2 = *((const double *)v2);
+		break;
+	default:
+		assert(0);
+		errno = EDOM;
+		return (0);
+	}
+	if (d1 < d2)
+		return (-1);
+	if (d1 > d2)
+		return (1);
+	return ((isnan(d1) != 0) - (isnan(d2) != 0));
+}
+
+/*
+ * Zero and negative zero are equal, so they must hash the same.
+ */
+uint64_t structs_float_hash(const struct structs_type *type, const void *data)
+{
+	switch (type->args[0].i) {
+	case FTYPE_FLOAT:
+	{
+		float f = *((const float *)data);
+
+		if (f == 0)
+			f = 0;
+		return (structs_hash_bytes(STRUCTS_HASH_INIT, &f, sizeof(f)));
+	}
+	case FTYPE_DOUBLE:
+	{
+		double d = *((const double *)data);
+
+		if (d == 0)
+			d = 0;
+		return (structs_hash_bytes(STRUCTS_HASH_INIT, &d, sizeof(d)));
+	}
+	default:
+		assert(0);
+		errno = EDOM;
+		return (0);
+	}
+}
+
 char *structs_float_ascify(const struct structs_type *type, const void *data)
 {
-	const int ftype = type->args[0].i;
 	char buf[32];
 
+	if (structs_float_ascify_into(type, data, buf, sizeof(buf)) == -1)
+		return (NULL);
+	return (structs_mem_strdup(buf));
+}
+
+int structs_float_ascify_into(const struct structs_type *type,
+			      const void *data, char *buf, size_t bufmax)
+{
+	const int ftype = type->args[0].i;
+
 	switch (ftype) {
 	case FTYPE_FLOAT:
 	{
 		const float *f = (const float *)data;
 
-		snprintf(buf, sizeof(buf), "%.16g", *f);
-		break;
+		return (snprintf(buf, bufmax, "%.16g", *f));
 	}
 	case FTYPE_DOUBLE:
 	{
 		const double *d = (const double *)data;
 
-		snprintf(buf, sizeof(buf), "%.16g", *d);
-		break;
+		return (snprintf(buf, bufmax, "%.16g", *d));
 	}
 	default:
 		assert(0);
-		return (NULL);
+		errno = EINVAL;
+		return (-1);
 	}
-	return (strdup(buf));
 }
 
 int structs_float_binify(const struct structs_type *type,
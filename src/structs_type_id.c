@@ -13,6 +13,7 @@
 
 /* Module Includes */
 #include "structs.h"
+#include "structs_alloc.h"
 #include "structs_type_array.h"
 #include "structs_type_id.h"
 
@@ -20,6 +21,9 @@
  * IDENTIFIER TYPES
  ******************************************************************************/
 
+static const char *structs_id_name(const struct structs_type *type,
+				   const void *data);
+
 int structs_id_init(const struct structs_type *type, void *data)
 {
 	const struct structs_id *const ids = type->args[0].v;
@@ -53,6 +57,21 @@ int structs_id_init(const struct structs_type *type, void *data)
 }
 
 char *structs_id_ascify(const struct structs_type *type, const void *data)
+{
+	return (structs_mem_strdup(structs_id_name(type, data)));
+}
+
+int structs_id_ascify_into(const struct structs_type *type,
+			   const void *data, char *buf, size_t bufmax)
+{
+	return (snprintf(buf, bufmax, "%s", structs_id_name(type, data)));
+}
+
+/*
+ * Get the string representation of an identifier value.
+ */
+static const char *structs_id_name(const struct structs_type *type,
+				   const void *data)
 {
 	const struct structs_id *id;
 	u_int32_t value = 0;
@@ -72,9 +91,9 @@ char *structs_id_ascify(const struct structs_type *type, const void *data)
 	}
 	for (id = type->args[0].v; id->id != NULL; id++) {
 		if (value == id->value)
-			return (strdup(id->id));
+			return (id->id);
 	}
-	return (strdup("INVALID"));
+	return ("INVALID");
 }
 
 int structs_id_binify(const struct structs_type *type,
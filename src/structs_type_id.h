@@ -27,6 +27,7 @@ struct structs_id {
 
 extern structs_init_t structs_id_init;
 extern structs_ascify_t structs_id_ascify;
+extern structs_ascify_into_t structs_id_ascify_into;
 extern structs_binify_t structs_id_binify;
 
 #define STRUCTS_ID_TYPE(idlist, vsize) {		\
@@ -41,7 +42,12 @@ extern structs_binify_t structs_id_binify;
 			structs_region_encode_netorder,	\
 			structs_region_decode_netorder,	\
 			structs_nothing_free,		\
-		{ { (idlist) }, { NULL }, { NULL } }    \
+		{ { (idlist) }, { NULL }, { NULL } },   \
+			structs_id_ascify_into,		\
+			NULL,				\
+			structs_region_compare,		\
+			structs_region_hash,		\
+			structs_region_encode_netorder_into\
 	}
 
 #endif /* _STRUCTS_TYPE_ID_H_ */
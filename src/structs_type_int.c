@@ -15,6 +15,7 @@
 
 /* Module Includes */
 #include "structs.h"
+#include "structs_alloc.h"
 #include "structs_type_array.h"
 #include "structs_type_int.h"
 
@@ -54,7 +55,12 @@
 		structs_region_encode_netorder,			\
 		structs_region_decode_netorder,			\
 		structs_nothing_free,				\
-		{ { (void *)(arg1) }, { (void *)0 } }           \
+		{ { (void *)(arg1) }, { (void *)0 } },          \
+		structs_int_ascify_into,			\
+		NULL,						\
+		structs_int_compare,				\
+		structs_region_hash,				\
+		structs_region_encode_netorder_into		\
 	};							\
 	const struct structs_type structs_type_ ## name = {	\
 		(size),                                         \
@@ -68,7 +74,12 @@
 		structs_region_encode_netorder,			\
 		structs_region_decode_netorder,			\
 		structs_nothing_free,				\
-		{ { (void *)(arg1) }, { (void *)1 } }           \
+		{ { (void *)(arg1) }, { (void *)1 } },          \
+		structs_int_ascify_into,			\
+		NULL,						\
+		structs_int_compare,				\
+		structs_region_hash,				\
+		structs_region_encode_netorder_into		\
 	};							\
 	const struct structs_type structs_type_h ## name = {	\
 		(size),                                         \
@@ -82,7 +93,12 @@
 		structs_region_encode_netorder,			\
 		structs_region_decode_netorder,			\
 		structs_nothing_free,				\
-		{ { (void *)(arg1) }, { (void *)2 } }           \
+		{ { (void *)(arg1) }, { (void *)2 } },          \
+		structs_int_ascify_into,			\
+		NULL,						\
+		structs_int_compare,				\
+		structs_region_hash,				\
+		structs_region_encode_netorder_into		\
 	}
 
 /* Define the types */
@@ -95,7 +111,58 @@ INTTYPES(int16, sizeof(int16_t), 5);
 INTTYPES(int32, sizeof(int32_t), 6);
 INTTYPES(int64, sizeof(int64_t), 7);
 
+/* Compare two integers of type "itype" */
+#define STRUCTS_INT_CMP(itype, v1, v2)					\
+	((*(const itype *)(v1) > *(const itype *)(v2))			\
+	    - (*(const itype *)(v1) < *(const itype *)(v2)))
+
+int structs_int_compare(const struct structs_type *type,
+			const void *v1, const void *v2)
+{
+	const int is_signed = (type->args[1].i == 1);
+
+	switch (type->args[0].i) {
+	case 0:
+		return (is_signed ? STRUCTS_INT_CMP(signed char, v1, v2) :
+			STRUCTS_INT_CMP(unsigned char, v1, v2));
+	case 1:
+		return (is_signed ? STRUCTS_INT_CMP(short, v1, v2) :
+			STRUCTS_INT_CMP(unsigned short, v1, v2));
+	case 2:
+		return (is_signed ? STRUCTS_INT_CMP(int, v1, v2) :
+			STRUCTS_INT_CMP(unsigned int, v1, v2));
+	case 3:
+		return (is_signed ? STRUCTS_INT_CMP(long, v1, v2) :
+			STRUCTS_INT_CMP(unsigned long, v1, v2));
+	case 4:
+		return (is_signed ? STRUCTS_INT_CMP(int8_t, v1, v2) :
+			STRUCTS_INT_CMP(u_int8_t, v1, v2));
+	case 5:
+		return (is_signed ? STRUCTS_INT_CMP(int16_t, v1, v2) :
+			STRUCTS_INT_CMP(u_int16_t, v1, v2));
+	case 6:
+		return (is_signed ? STRUCTS_INT_CMP(int32_t, v1, v2) :
+			STRUCTS_INT_CMP(u_int32_t, v1, v2));
+	case 7:
+		return (is_signed ? STRUCTS_INT_CMP(int64_t, v1, v2) :
+			STRUCTS_INT_CMP(u_int64_t, v1, v2));
+	default:
+		errno = EDOM;
+		return (0);
+	}
+}
+
 char *structs_int_ascify(const struct structs_type *type, const void *data)
+{
+	char buf[32];
+
+	if (structs_int_ascify_into(type, data, buf, sizeof(buf)) == -1)
+		return (NULL);
+	return (structs_mem_strdup(buf));
+}
+
+int structs_int_ascify_into(const struct structs_type *type,
+			    const void *data, char *buf, size_t bufmax)
 {
 	const char *const fmts[8][3] = {
 		{ "%u", "%d", "0x%02x" },	/* char */
@@ -108,47 +175,37 @@ char *structs_int_ascify(const struct structs_type *type, const void *data)
 		{ "%qu", "%qd", "0x%qx" },	/* int64_t */
 	};
 	const char *fmt;
-	char buf[32];
 
 	fmt = fmts[type->args[0].i][type->args[1].i];
 	switch (type->args[0].i) {
 	case 0:
-		snprintf(buf, sizeof(buf), fmt, (type->args[1].i == 1) ?
-			 *((char *)data) : *((unsigned char *)data));
-		break;
+		return (snprintf(buf, bufmax, fmt, (type->args[1].i == 1) ?
+			 *((char *)data) : *((unsigned char *)data)));
 	case 1:
-		snprintf(buf, sizeof(buf), fmt, (type->args[1].i == 1) ?
-			 *((short *)data) : *((unsigned short *)data));
-		break;
+		return (snprintf(buf, bufmax, fmt, (type->args[1].i == 1) ?
+			 *((short *)data) : *((unsigned short *)data)));
 	case 2:
-		snprintf(buf, sizeof(buf), fmt, (type->args[1].i == 1) ?
-			 *((int *)data) : *((unsigned int *)data));
-		break;
+		return (snprintf(buf, bufmax, fmt, (type->args[1].i == 1) ?
+			 *((int *)data) : *((unsigned int *)data)));
 	case 3:
-		snprintf(buf, sizeof(buf), fmt, (type->args[1].i == 1) ?
-			 *((long *)data) : *((unsigned long *)data));
-		break;
+		return (snprintf(buf, bufmax, fmt, (type->args[1].i == 1) ?
+			 *((long *)data) : *((unsigned long *)data)));
 	case 4:
-		snprintf(buf, sizeof(buf), fmt, (type->args[1].i == 1) ?
-			 *((int8_t *) data) : *((u_int8_t *) data));
-		break;
+		return (snprintf(buf, bufmax, fmt, (type->args[1].i == 1) ?
+			 *((int8_t *) data) : *((u_int8_t *) data)));
 	case 5:
-		snprintf(buf, sizeof(buf), fmt, (type->args[1].i == 1) ?
-			 *((int16_t *) data) : *((u_int16_t *) data));
-		break;
+		return (snprintf(buf, bufmax, fmt, (type->args[1].i == 1) ?
+			 *((int16_t *) data) : *((u_int16_t *) data)));
 	case 6:
-		snprintf(buf, sizeof(buf), fmt, (type->args[1].i == 1) ?
-			 *((int32_t *) data) : *((u_int32_t *) data));
-		break;
+		return (snprintf(buf, bufmax, fmt, (type->args[1].i == 1) ?
+			 *((int32_t *) data) : *((u_int32_t *) data)));
 	case 7:
-		snprintf(buf, sizeof(buf), fmt, (type->args[1].i == 1) ?
-			 *((int64_t *) data) : *((u_int64_t *) data));
-		break;
+		return (snprintf(buf, bufmax, fmt, (type->args[1].i == 1) ?
+			 *((int64_t *) data) : *((u_int64_t *) data)));
 	default:
 		errno = EDOM;
-		return (NULL);
+		return (-1);
 	}
-	return (strdup(buf));
 }
 
 int structs_int_binify(const struct structs_type *type,
@@ -31,7 +31,9 @@ extern const struct structs_type structs_type_uint64;
 extern const struct structs_type structs_type_hint64;
 
 extern structs_ascify_t structs_int_ascify;
+extern structs_ascify_into_t structs_int_ascify_into;
 extern structs_binify_t structs_int_binify;
+extern structs_compare_t structs_int_compare;
 
 #endif /* _STRUCTS_TYPE_INT_H_ */
 /*******************************************************************************
@@ -0,0 +1,328 @@
+/*******************************************************************************
+ * HEADERS
+ ******************************************************************************/
+
+/* Standard Includes */
+#include <sys/types.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+/* Module Includes */
+#include "structs.h"
+#include "structs_alloc.h"
+#include "structs_type_string.h"
+#include "structs_type_intern.h"
+
+/*******************************************************************************
+ * MACROS/VARIABLES
+ ******************************************************************************/
+
+/* Initial number of hash buckets */
+#define STRUCTS_INTERN_MIN_BUCKETS	64
+
+/* An interned string */
+struct structs_intern {
+	struct structs_intern *next;	/* next entry in hash bucket */
+	uint32_t hash;		/* hash of string */
+	unsigned int refs;	/* number of references */
+	size_t len;		/* length of string */
+	char str[];		/* the string itself */
+};
+
+/* Get the entry for an interned string */
+#define STRUCTS_INTERN_ENTRY(s)						\
+	((struct structs_intern *)((char *)(s)				\
+	    - offsetof(struct structs_intern, str)))
+
+/*
+ * The empty string is permanently interned here. It has no entry
+ * and is never counted.
+ */
+static const char structs_intern_empty[] = "";
+
+/*
+ * Intern table. A reference count may be incremented without the lock
+ * only by a thread that already holds a reference, and may only drop
+ * to zero with the lock held, so an entry found under the lock is
+ * never being freed.
+ */
+static struct structs_intern **structs_intern_buckets;
+static unsigned int structs_intern_nbuckets;
+static unsigned int structs_intern_count;
+static pthread_mutex_t structs_intern_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ * FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+static int structs_intern_grow(void);
+static uint32_t structs_intern_hash(const char *s, size_t len);
+
+/*******************************************************************************
+ * FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+const char *structs_intern(const char *s)
+{
+	return (structs_intern_len(s, strlen(s)));
+}
+
+const char *structs_intern_len(const char *s, size_t len)
+{
+	const uint32_t hash = structs_intern_hash(s, len);
+	struct structs_intern *entry;
+	unsigned int i;
+	int r;
+
+	/* The empty string is always there */
+	if (len == 0)
+		return (structs_intern_empty);
+
+	/* Lock table */
+	r = pthread_mutex_lock(&structs_intern_mutex);
+	assert(r == 0);
+
+	/* Look for an existing entry */
+	if (structs_intern_nbuckets > 0) {
+		i = hash & (structs_intern_nbuckets - 1);
+		for (entry = structs_intern_buckets[i];
+		     entry != NULL; entry = entry->next) {
+			if (entry->hash == hash && entry->len == len
+			    && memcmp(entry->str, s, len) == 0) {
+				__atomic_add_fetch(&entry->refs, 1,
+						   __ATOMIC_RELAXED);
+				goto done;
+			}
+		}
+	}
+
+	/* Add a new entry */
+	if (structs_intern_count >= structs_intern_nbuckets
+	    && structs_intern_grow() == -1) {
+		entry = NULL;
+		goto done;
+	}
+	if ((entry = malloc(sizeof(*entry) + len + 1)) == NULL)
+		goto done;
+	entry->hash = hash;
+	entry->refs = 1;
+	entry->len = len;
+	memcpy(entry->str, s, len);
+	entry->str[len] = '\0';
+	i = hash & (structs_intern_nbuckets - 1);
+	entry->next = structs_intern_buckets[i];
+	structs_intern_buckets[i] = entry;
+	structs_intern_count++;
+
+done:
+	/* Unlock table */
+	r = pthread_mutex_unlock(&structs_intern_mutex);
+	assert(r == 0);
+	return (entry != NULL ? entry->str : NULL);
+}
+
+void structs_intern_release(const char *s)
+{
+	struct structs_intern *const entry = (s != NULL
+					      && s != structs_intern_empty) ?
+	    STRUCTS_INTERN_ENTRY(s) : NULL;
+	struct structs_intern **ep;
+	unsigned int refs;
+	int r;
+
+	/* Ignore uncounted strings */
+	if (entry == NULL)
+		return;
+
+	/* Drop a reference without locking, unless it's the last one */
+	refs = __atomic_load_n(&entry->refs, __ATOMIC_RELAXED);
+	while (refs > 1) {
+		if (__atomic_compare_exchange_n(&entry->refs, &refs, refs - 1,
+						0, __ATOMIC_RELEASE,
+						__ATOMIC_RELAXED))
+			return;
+	}
+
+	/* Drop the last reference with the table locked */
+	r = pthread_mutex_lock(&structs_intern_mutex);
+	assert(r == 0);
+	if (__atomic_sub_fetch(&entry->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+		for (ep = &structs_intern_buckets
+		     [entry->hash & (structs_intern_nbuckets - 1)];
+		     *ep != entry; ep = &(*ep)->next) ;
+		*ep = entry->next;
+		free(entry);
+
+		/* Free the table when it becomes empty */
+		if (--structs_intern_count == 0) {
+			free(structs_intern_buckets);
+			structs_intern_buckets = NULL;
+			structs_intern_nbuckets = 0;
+		}
+	}
+	r = pthread_mutex_unlock(&structs_intern_mutex);
+	assert(r == 0);
+}
+
+/*
+ * Double the number of hash buckets. The table must be locked.
+ */
+static int structs_intern_grow(void)
+{
+	const unsigned int nbuckets = structs_intern_nbuckets > 0 ?
+	    structs_intern_nbuckets * 2 : STRUCTS_INTERN_MIN_BUCKETS;
+	struct structs_intern **buckets;
+	struct structs_intern *entry;
+	unsigned int i;
+
+	if ((buckets = calloc(nbuckets, sizeof(*buckets))) == NULL)
+		return (-1);
+	for (i = 0; i < structs_intern_nbuckets; i++) {
+		while ((entry = structs_intern_buckets[i]) != NULL) {
+			structs_intern_buckets[i] = entry->next;
+			entry->next = buckets[entry->hash & (nbuckets - 1)];
+			buckets[entry->hash & (nbuckets - 1)] = entry;
+		}
+	}
+	free(structs_intern_buckets);
+	structs_intern_buckets = buckets;
+	structs_intern_nbuckets = nbuckets;
+	return (0);
+}
+
+/*
+ * FNV-1a hash of a string.
+ */
+static uint32_t structs_intern_hash(const char *s, size_t len)
+{
+	uint32_t h = 2166136261U;
+
+	while (len-- > 0) {
+		h ^= (unsigned char)*s++;
+		h *= 16777619U;
+	}
+	return (h);
+}
+
+/*******************************************************************************
+ * INTERNED STRING TYPE
+ ******************************************************************************/
+
+int structs_interned_string_init(const struct structs_type *type, void *data)
+{
+	*((const char **)data) = structs_intern_empty;
+	return (0);
+}
+
+int structs_interned_string_copy(const struct structs_type *type,
+				 const void *from, void *to)
+{
+	const char *const s = *((const char *const *)from);
+
+	if (s != NULL && s != structs_intern_empty)
+		__atomic_add_fetch(&STRUCTS_INTERN_ENTRY(s)->refs, 1,
+				   __ATOMIC_RELAXED);
+	*((const char **)to) = s != NULL ? s : structs_intern_empty;
+	return (0);
+}
+
+int structs_interned_string_equal(const struct structs_type *type,
+				  const void *v1, const void *v2)
+{
+	const char *s1 = *((const char *const *)v1);
+	const char *s2 = *((const char *const *)v2);
+
+	if (s1 == NULL)
+		s1 = structs_intern_empty;
+	if (s2 == NULL)
+		s2 = structs_intern_empty;
+	return (s1 == s2);
+}
+
+int structs_interned_string_compare(const struct structs_type *type,
+				    const void *v1, const void *v2)
+{
+	const char *s1 = *((const char *const *)v1);
+	const char *s2 = *((const char *const *)v2);
+
+	if (s1 == NULL)
+		s1 = structs_intern_empty;
+	if (s2 == NULL)
+		s2 = structs_intern_empty;
+	if (s1 == s2)
+		return (0);
+	return (strcmp(s1, s2));
+}
+
+uint64_t structs_interned_string_hash(const struct structs_type *type,
+				      const void *data)
+{
+	const char *const s = *((const char *const *)data);
+
+	if (s == NULL || s == structs_intern_empty)
+		return (STRUCTS_HASH_INIT);
+	return (structs_hash_bytes(STRUCTS_HASH_INIT, s,
+				   STRUCTS_INTERN_ENTRY(s)->len));
+}
+
+char *structs_interned_string_ascify(const struct structs_type *type,
+				     const void *data)
+{
+	const char *const s = *((const char *const *)data);
+
+	return (structs_mem_strdup(s != NULL ? s : ""));
+}
+
+int structs_interned_string_ascify_into(const struct structs_type *type,
+					const void *data, char *buf,
+					size_t bufmax)
+{
+	const char *const s = *((const char *const *)data);
+
+	return (snprintf(buf, bufmax, "%s", s != NULL ? s : ""));
+}
+
+int structs_interned_string_binify(const struct structs_type *type,
+				   const char *ascii, void *data,
+				   char *ebuf, size_t emax)
+{
+	const char *s;
+
+	if ((s = structs_intern(ascii)) == NULL)
+		return (-1);
+	*((const char **)data) = s;
+	return (0);
+}
+
+void structs_interned_string_free(const struct structs_type *type, void *data)
+{
+	structs_intern_release(*((const char **)data));
+	*((const char **)data) = NULL;
+}
+
+void structs_interned_string_memsize(const struct structs_type *type,
+				     const void *data,
+				     structs_memblock_t *block, void *arg)
+{
+	const char *const s = *((const char *const *)data);
+	const struct structs_intern *entry;
+
+	if (s == NULL || s == structs_intern_empty)
+		return;
+	entry = STRUCTS_INTERN_ENTRY(s);
+	(*block) (arg, entry, sizeof(*entry) + entry->len + 1);
+}
+
+const struct structs_type structs_type_interned_string =
+    STRUCTS_INTERNED_STRING_TYPE;
+
+/*******************************************************************************
+ * END OF FILE
+ ******************************************************************************/
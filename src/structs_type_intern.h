@@ -0,0 +1,80 @@
+#ifndef _STRUCTS_TYPE_INTERN_H_
+#define _STRUCTS_TYPE_INTERN_H_
+
+/*******************************************************************************
+ * INTERNED STRING TYPES
+ ******************************************************************************/
+
+/*
+ * Interned strings are kept in a global, reference counted table so that
+ * there is only ever one copy of each distinct string. This suits strings
+ * that have few distinct values but appear in many data structures:
+ * copying one just adds a reference, and two are equal exactly when they
+ * are the same pointer.
+ *
+ * The table may be used by any number of threads at once. Its memory
+ * always comes from structs_allocator_default, as it is shared by
+ * all data structures; so interned strings in data structures released
+ * with structs_arena_release() are never released.
+ *
+ * Interned strings must never be modified.
+ */
+
+/*
+ * Intern a string, or the first "len" characters of a string,
+ * and return a new reference to the interned copy.
+ *
+ * Returns NULL (and sets errno) if there was an error.
+ */
+extern const char *structs_intern(const char *s);
+extern const char *structs_intern_len(const char *s, size_t len);
+
+/*
+ * Release a reference to an interned string. NULL is ignored.
+ */
+extern void structs_intern_release(const char *s);
+
+/*
+ * Interned string type. Fields are declared as "const char *" and are
+ * never NULL once initialized. The value and encodings are the same
+ * as structs_type_string.
+ *
+ * No type-specific arguments.
+ */
+extern structs_init_t structs_interned_string_init;
+extern structs_copy_t structs_interned_string_copy;
+extern structs_equal_t structs_interned_string_equal;
+extern structs_ascify_t structs_interned_string_ascify;
+extern structs_ascify_into_t structs_interned_string_ascify_into;
+extern structs_binify_t structs_interned_string_binify;
+extern structs_uninit_t structs_interned_string_free;
+extern structs_memsize_t structs_interned_string_memsize;
+extern structs_compare_t structs_interned_string_compare;
+extern structs_hash_t structs_interned_string_hash;
+
+#define STRUCTS_INTERNED_STRING_TYPE {					\
+		sizeof(const char *),					\
+			"internedstring",				\
+			STRUCTS_TYPE_PRIMITIVE,				\
+			structs_interned_string_init,			\
+			structs_interned_string_copy,			\
+			structs_interned_string_equal,			\
+			structs_interned_string_ascify,			\
+			structs_interned_string_binify,			\
+			structs_string_encode,				\
+			structs_string_decode,				\
+			structs_interned_string_free,			\
+		{ { NULL }, { NULL }, { NULL } },			\
+			structs_interned_string_ascify_into,		\
+			structs_interned_string_memsize,		\
+			structs_interned_string_compare,		\
+			structs_interned_string_hash,			\
+			structs_string_encode_into			\
+	}
+
+extern const struct structs_type structs_type_interned_string;
+
+#endif /* _STRUCTS_TYPE_INTERN_H_ */
+/*******************************************************************************
+ * END OF FILE
+ ******************************************************************************/
@@ -18,6 +18,7 @@
 
 /* Module Includes */
 #include "structs.h"
+#include "structs_alloc.h"
 #include "structs_type_array.h"
 #include "structs_type_ip4.h"
 
@@ -26,19 +27,27 @@
  ******************************************************************************/
 
 static structs_ascify_t structs_ip4_ascify;
+static structs_ascify_into_t structs_ip4_ascify_into;
 static structs_binify_t structs_ip4_binify;
 
 static char *structs_ip4_ascify(const struct structs_type *type,
 				const void *data)
+{
+	char buf[16];
+
+	structs_ip4_ascify_into(type, data, buf, sizeof(buf));
+	return (structs_mem_strdup(buf));
+}
+
+static int structs_ip4_ascify_into(const struct structs_type *type,
+				   const void *data, char *buf, size_t bufmax)
 {
 	const unsigned char *const bytes
 	    = (const unsigned char *)&((const struct in_addr *)data)->s_addr;
-	char buf[16];
 
 	/* Don't use inet_ntoa(), it's not thread safe */
-	snprintf(buf, sizeof(buf), "%u.%u.%u.%u",
-		 bytes[0], bytes[1], bytes[2], bytes[3]);
-	return (strdup(buf));
+	return (snprintf(buf, bufmax, "%u.%u.%u.%u",
+			 bytes[0], bytes[1], bytes[2], bytes[3]));
 }
 
 static int structs_ip4_binify(const struct structs_type *type,
@@ -92,6 +101,12 @@ const struct structs_type structs_type_ip4 = {
 	structs_region_encode,
 	structs_region_decode,
 	structs_nothing_free,
+	{ { NULL } },
+	structs_ip4_ascify_into,
+	NULL,
+	structs_region_compare,
+	structs_region_hash,
+	structs_region_encode_into
 };
 
 /*******************************************************************************
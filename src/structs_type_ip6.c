@@ -19,6 +19,7 @@
 
 /* Module Includes */
 #include "structs.h"
+#include "structs_alloc.h"
 #include "structs_type_array.h"
 #include "structs_type_ip6.h"
 
@@ -27,6 +28,7 @@
  ******************************************************************************/
 
 static structs_ascify_t structs_ip6_ascify;
+static structs_ascify_into_t structs_ip6_ascify_into;
 static structs_binify_t structs_ip6_binify;
 
 static char *structs_ip6_ascify(const struct structs_type *type,
@@ -34,11 +36,21 @@ static char *structs_ip6_ascify(const struct structs_type *type,
 {
 	char *res;
 
-	if ((res = calloc(1, INET6_ADDRSTRLEN + 1)) != NULL)
+	if ((res = structs_mem_calloc(1, INET6_ADDRSTRLEN + 1)) != NULL)
 		inet_ntop(AF_INET6, data, res, INET6_ADDRSTRLEN);
 	return (res);
 }
 
+static int structs_ip6_ascify_into(const struct structs_type *type,
+				   const void *data, char *buf, size_t bufmax)
+{
+	char abuf[INET6_ADDRSTRLEN];
+
+	if (inet_ntop(AF_INET6, data, abuf, sizeof(abuf)) == NULL)
+		return (-1);
+	return (snprintf(buf, bufmax, "%s", abuf));
+}
+
 static int
 structs_ip6_binify(const struct structs_type *type,
 		   const char *ascii, void *data, char *ebuf, size_t emax)
@@ -68,6 +80,12 @@ const struct structs_type structs_type_ip6 = {
 	structs_region_encode,
 	structs_region_decode,
 	structs_nothing_free,
+	{ { NULL } },
+	structs_ip6_ascify_into,
+	NULL,
+	structs_region_compare,
+	structs_region_hash,
+	structs_region_encode_into
 };
 
 /*******************************************************************************
@@ -12,8 +12,10 @@
 
 /* Module Includes */
 #include "structs.h"
+#include "structs_alloc.h"
 #include "structs_type_array.h"
 #include "structs_type_pointer.h"
+#include "structs_internal.h"
 
 /*******************************************************************************
  * POINTER TYPE
@@ -25,12 +27,12 @@ int structs_pointer_init(const struct structs_type *type, void *data)
 	void *pdata;
 
 	/* Create a new instance of the pointed to thing */
-	if ((pdata = calloc(1, ptype->size)) == NULL)
+	if ((pdata = structs_mem_calloc(1, ptype->size)) == NULL)
 		return (-1);
 
 	/* Initialize it */
 	if ((*ptype->init) (ptype, pdata) == -1) {
-		free(pdata);
+		structs_mem_free(pdata);
 		return (-1);
 	}
 
@@ -47,12 +49,12 @@ int structs_pointer_copy(const struct structs_type *type,
 	void *to_pdata;
 
 	/* Create a new instance of the pointed to thing */
-	if ((to_pdata = calloc(1, ptype->size)) == NULL)
+	if ((to_pdata = structs_mem_calloc(1, ptype->size)) == NULL)
 		return (-1);
 
 	/* Copy into it */
 	if ((*ptype->copy) (ptype, from_pdata, to_pdata) == -1) {
-		free(to_pdata);
+		structs_mem_free(to_pdata);
 		return (-1);
 	}
 
@@ -71,6 +73,24 @@ int structs_pointer_equal(const struct structs_type *type,
 	return ((*ptype->equal) (ptype, pdata1, pdata2));
 }
 
+int structs_pointer_compare(const struct structs_type *type,
+			    const void *v1, const void *v2)
+{
+	const struct structs_type *const ptype = type->args[0].v;
+	const void *const pdata1 = *((void *const *)v1);
+	const void *const pdata2 = *((void *const *)v2);
+
+	return (structs_compare_item(ptype, pdata1, pdata2));
+}
+
+uint64_t structs_pointer_hash(const struct structs_type *type,
+			      const void *data)
+{
+	const struct structs_type *const ptype = type->args[0].v;
+
+	return (structs_hash_item(ptype, *((void *const *)data)));
+}
+
 char *structs_pointer_ascify(const struct structs_type *type, const void *data)
 {
 	const struct structs_type *const ptype = type->args[0].v;
@@ -79,6 +99,15 @@ char *structs_pointer_ascify(const struct structs_type *type, const void *data)
 	return ((*ptype->ascify) (ptype, pdata));
 }
 
+int structs_pointer_ascify_into(const struct structs_type *type,
+				const void *data, char *buf, size_t bufmax)
+{
+	const struct structs_type *const ptype = type->args[0].v;
+	void *const pdata = *((void **)data);
+
+	return (structs_ascify_into(ptype, pdata, buf, bufmax));
+}
+
 int structs_pointer_binify(const struct structs_type *type,
 			   const char *ascii, void *data,
 			   char *ebuf, size_t emax)
@@ -87,12 +116,12 @@ int structs_pointer_binify(const struct structs_type *type,
 	void *pdata;
 
 	/* Allocate new data area */
-	if ((pdata = calloc(1, ptype->size)) == NULL)
+	if ((pdata = structs_mem_calloc(1, ptype->size)) == NULL)
 		return (-1);
 
 	/* Binify string into data area */
 	if ((*ptype->binify) (ptype, ascii, pdata, ebuf, emax) == -1) {
-		free(pdata);
+		structs_mem_free(pdata);
 		return (-1);
 	}
 
@@ -110,6 +139,15 @@ int structs_pointer_encode(const struct structs_type *type,
 	return ((*ptype->encode) (ptype, code, pdata));
 }
 
+int structs_pointer_encode_into(const struct structs_type *type,
+				struct structs_encoder *enc, const void *data)
+{
+	const struct structs_type *const ptype = type->args[0].v;
+	const void *const pdata = *((void *const *)data);
+
+	return (structs_encode_into(ptype, enc, pdata));
+}
+
 int structs_pointer_decode(const struct structs_type *type,
 			   const unsigned char *code, size_t cmax, void *data,
 			   char *ebuf, size_t emax)
@@ -119,12 +157,12 @@ int structs_pointer_decode(const struct structs_type *type,
 	int r;
 
 	/* Allocate new data area */
-	if ((pdata = calloc(1, ptype->size)) == NULL)
+	if ((pdata = structs_mem_calloc(1, ptype->size)) == NULL)
 		return (-1);
 
 	/* Decode referent data */
 	if ((r = (*ptype->decode) (ptype, code, cmax, pdata, ebuf, emax)) == -1) {
-		free(pdata);
+		structs_mem_free(pdata);
 		return (-1);
 	}
 
@@ -140,10 +178,21 @@ void structs_pointer_free(const struct structs_type *type, void *data)
 
 	/* Recursively free data pointed to by pointer */
 	(*ptype->uninit) (ptype, pdata);
-	free(pdata);
+	structs_mem_free(pdata);
 	*((void **)data) = NULL;
 }
 
+void structs_pointer_memsize(const struct structs_type *type,
+			     const void *data, structs_memblock_t *block,
+			     void *arg)
+{
+	const struct structs_type *const ptype = type->args[0].v;
+	const void *const pdata = *((void *const *)data);
+
+	if (pdata != NULL)
+		(*block) (arg, pdata, ptype->size);
+}
+
 /*******************************************************************************
  * END OF FILE
  ******************************************************************************/
@@ -13,10 +13,15 @@ extern structs_init_t structs_pointer_init;
 extern structs_copy_t structs_pointer_copy;
 extern structs_equal_t structs_pointer_equal;
 extern structs_ascify_t structs_pointer_ascify;
+extern structs_ascify_into_t structs_pointer_ascify_into;
 extern structs_binify_t structs_pointer_binify;
 extern structs_encode_t structs_pointer_encode;
+extern structs_encode_into_t structs_pointer_encode_into;
 extern structs_decode_t structs_pointer_decode;
 extern structs_uninit_t structs_pointer_free;
+extern structs_memsize_t structs_pointer_memsize;
+extern structs_compare_t structs_pointer_compare;
+extern structs_hash_t structs_pointer_hash;
 
 /*
  * Macro arguments:
@@ -34,7 +39,12 @@ extern structs_uninit_t structs_pointer_free;
 			structs_pointer_encode,			\
 			structs_pointer_decode,			\
 			structs_pointer_free,			\
-		{ { (void *)(reftype) }, { NULL }, { NULL } }   \
+		{ { (void *)(reftype) }, { NULL }, { NULL } },  \
+			structs_pointer_ascify_into,		\
+			structs_pointer_memsize,		\
+			structs_pointer_compare,		\
+			structs_pointer_hash,			\
+			structs_pointer_encode_into		\
 	}
 
 #endif /* _STRUCTS_TYPE_POINTER_H_ */
@@ -13,8 +13,10 @@
 
 /* Module Includes */
 #include "structs.h"
+#include "structs_alloc.h"
 #include "structs_type_array.h"
 #include "structs_type_string.h"
+#include "structs_internal.h"
 
 /*******************************************************************************
  * DYNAMICALLY ALLOCATED STRING TYPE
@@ -52,7 +54,18 @@ char *structs_string_ascify(const struct structs_type *type, const void *data)
 
 	if (as_null && s == NULL)
 		s = "";
-	return (strdup(s));
+	return (structs_mem_strdup(s));
+}
+
+int structs_string_ascify_into(const struct structs_type *type,
+			       const void *data, char *buf, size_t bufmax)
+{
+	const int as_null = type->args[0].i;
+	const char *s = *((char **)data);
+
+	if (as_null && s == NULL)
+		s = "";
+	return (snprintf(buf, bufmax, "%s", s));
 }
 
 int structs_string_binify(const struct structs_type *type,
@@ -64,7 +77,7 @@ int structs_string_binify(const struct structs_type *type,
 
 	if (as_null && *ascii == '\0')
 		s = NULL;
-	else if ((s = strdup(ascii)) == NULL)
+	else if ((s = structs_mem_strdup(ascii)) == NULL)
 		return (-1);
 	*((char **)data) = s;
 	return (0);
@@ -85,6 +98,37 @@ int structs_string_encode(const struct structs_type *type,
 	return (0);
 }
 
+/*
+ * Same as structs_string_encode(), but appending to an encoder.
+ */
+int structs_string_encode_into(const struct structs_type *type,
+			       struct structs_encoder *enc, const void *data)
+{
+	size_t room;
+	char *s;
+	int len;
+
+	/* Ascify into the free space at the end of the buffer if it fits */
+	if (structs_encoder_reserve(enc, 0) == NULL)
+		return (-1);
+	room = enc->size - enc->length;
+	if ((len = structs_ascify_into(type, data,
+				       (char *)enc->data + enc->length,
+				       room)) == -1)
+		return (-1);
+	if ((size_t)len < room) {
+		enc->length += len + 1;
+		return (0);
+	}
+
+	/* Otherwise make room for it and do it again */
+	if ((s = (char *)structs_encoder_reserve(enc, len + 1)) == NULL)
+		return (-1);
+	if (structs_ascify_into(type, data, s, len + 1) == -1)
+		return (-1);
+	return (0);
+}
+
 /*
  * This can be used by any type that wishes to encode its
  * value using its ASCII string representation.
@@ -116,11 +160,40 @@ void structs_string_free(const struct structs_type *type, void *data)
 	char *const s = *((char **)data);
 
 	if (s != NULL) {
-		free(s);
+		structs_mem_free(s);
 		*((char **)data) = NULL;
 	}
 }
 
+void structs_string_memsize(const struct structs_type *type,
+			    const void *data, structs_memblock_t *block,
+			    void *arg)
+{
+	const char *const s = *((const char *const *)data);
+
+	if (s != NULL)
+		(*block) (arg, s, strlen(s) + 1);
+}
+
+int structs_string_compare(const struct structs_type *type,
+			   const void *v1, const void *v2)
+{
+	const char *const s1 = *((const char **)v1);
+	const char *const s2 = *((const char **)v2);
+
+	return (strcmp(s1 != NULL ? s1 : "", s2 != NULL ? s2 : ""));
+}
+
+uint64_t structs_string_hash(const struct structs_type *type,
+			     const void *data)
+{
+	const char *const s = *((const char **)data);
+
+	if (s == NULL)
+		return (STRUCTS_HASH_INIT);
+	return (structs_hash_bytes(STRUCTS_HASH_INIT, s, strlen(s)));
+}
+
 const struct structs_type structs_type_string = STRUCTS_STRING_TYPE(0);
 const struct structs_type structs_type_string_null = STRUCTS_STRING_TYPE(1);
 
@@ -211,6 +284,19 @@ int structs_bstring_equal(const struct structs_type *type,
 	return (strncmp(s1, s2, type->size) == 0);
 }
 
+int structs_bstring_compare(const struct structs_type *type,
+			    const void *v1, const void *v2)
+{
+	return (strncmp(v1, v2, type->size));
+}
+
+uint64_t structs_bstring_hash(const struct structs_type *type,
+			      const void *data)
+{
+	return (structs_hash_bytes(STRUCTS_HASH_INIT, data,
+				   c_strnlen(data, type->size)));
+}
+
 char *structs_bstring_ascify(const struct structs_type *type, const void *data)
 {
 	const char *const s = data;
@@ -218,9 +304,9 @@ char *structs_bstring_ascify(const struct structs_type *type, const void *data)
 	unsigned int outlen = (type->size * 3);
 	unsigned int slen = c_strnlen(s, type->size);
 
-	out = malloc(outlen + 1);
+	out = structs_mem_malloc(outlen + 1);
 	if (!out)
-		return strdup(" ");
+		return structs_mem_strdup(" ");
 	encode_quopri(s, slen, out, outlen);
 	return (out);
 }
@@ -241,6 +327,112 @@ int structs_bstring_binify(const struct structs_type *type,
 	return (0);
 }
 
+/*******************************************************************************
+ * SMALL STRING OPTIMIZED STRING TYPE
+ ******************************************************************************/
+
+/* Layout shared by all STRUCTS_SSO_STRING(cap) structures */
+struct structs_sso_string {
+	char *heap;		/* long string, or NULL */
+	char buf[];		/* short string */
+};
+
+int structs_sso_string_copy(const struct structs_type *type,
+			    const void *from, void *to)
+{
+	const struct structs_sso_string *const fstr = from;
+	struct structs_sso_string *const tstr = to;
+
+	/* Short strings are copied as is */
+	if (fstr->heap == NULL) {
+		memcpy(to, from, type->size);
+		return (0);
+	}
+
+	/* Long strings are duplicated */
+	memset(to, 0, type->size);
+	if ((tstr->heap = structs_mem_strdup(fstr->heap)) == NULL)
+		return (-1);
+	return (0);
+}
+
+int structs_sso_string_equal(const struct structs_type *type,
+			     const void *v1, const void *v2)
+{
+	return (strcmp(STRUCTS_SSO_STRING_VALUE
+		       ((const struct structs_sso_string *)v1),
+		       STRUCTS_SSO_STRING_VALUE
+		       ((const struct structs_sso_string *)v2)) == 0);
+}
+
+int structs_sso_string_compare(const struct structs_type *type,
+			       const void *v1, const void *v2)
+{
+	return (strcmp(STRUCTS_SSO_STRING_VALUE
+		       ((const struct structs_sso_string *)v1),
+		       STRUCTS_SSO_STRING_VALUE
+		       ((const struct structs_sso_string *)v2)));
+}
+
+uint64_t structs_sso_string_hash(const struct structs_type *type,
+				 const void *data)
+{
+	const char *const s = STRUCTS_SSO_STRING_VALUE
+	    ((const struct structs_sso_string *)data);
+
+	return (structs_hash_bytes(STRUCTS_HASH_INIT, s, strlen(s)));
+}
+
+char *structs_sso_string_ascify(const struct structs_type *type,
+				const void *data)
+{
+	return (structs_mem_strdup(STRUCTS_SSO_STRING_VALUE
+				   ((const struct structs_sso_string *)data)));
+}
+
+int structs_sso_string_ascify_into(const struct structs_type *type,
+				   const void *data, char *buf, size_t bufmax)
+{
+	return (snprintf(buf, bufmax, "%s", STRUCTS_SSO_STRING_VALUE
+			 ((const struct structs_sso_string *)data)));
+}
+
+int structs_sso_string_binify(const struct structs_type *type,
+			      const char *ascii, void *data,
+			      char *ebuf, size_t emax)
+{
+	struct structs_sso_string *const str = data;
+	const size_t cap = type->args[0].i;
+	const size_t alen = strlen(ascii);
+
+	memset(data, 0, type->size);
+	if (alen <= cap) {
+		memcpy(str->buf, ascii, alen + 1);
+		return (0);
+	}
+	if ((str->heap = structs_mem_strdup(ascii)) == NULL)
+		return (-1);
+	return (0);
+}
+
+void structs_sso_string_free(const struct structs_type *type, void *data)
+{
+	struct structs_sso_string *const str = data;
+
+	structs_mem_free(str->heap);
+	memset(data, 0, type->size);
+}
+
+void structs_sso_string_memsize(const struct structs_type *type,
+				const void *data, structs_memblock_t *block,
+				void *arg)
+{
+	const struct structs_sso_string *const str = data;
+
+	if (str->heap != NULL)
+		(*block) (arg, str->heap, strlen(str->heap) + 1);
+}
+
 /*******************************************************************************
  * END OF FILE
  ******************************************************************************/
@@ -14,10 +14,15 @@
 extern structs_init_t structs_string_init;
 extern structs_equal_t structs_string_equal;
 extern structs_ascify_t structs_string_ascify;
+extern structs_ascify_into_t structs_string_ascify_into;
 extern structs_binify_t structs_string_binify;
 extern structs_encode_t structs_string_encode;
+extern structs_encode_into_t structs_string_encode_into;
 extern structs_decode_t structs_string_decode;
 extern structs_uninit_t structs_string_free;
+extern structs_memsize_t structs_string_memsize;
+extern structs_compare_t structs_string_compare;
+extern structs_hash_t structs_string_hash;
 
 #define STRUCTS_STRING_TYPE(asnull) {				\
 		sizeof(char *),					\
@@ -31,7 +36,12 @@ extern structs_uninit_t structs_string_free;
 			structs_string_encode,			\
 			structs_string_decode,			\
 			structs_string_free,			\
-		{ { (void *)(asnull) }, { NULL }, { NULL } }	\
+		{ { (void *)(asnull) }, { NULL }, { NULL } },	\
+			structs_string_ascify_into,		\
+			structs_string_memsize,			\
+			structs_string_compare,			\
+			structs_string_hash,			\
+			structs_string_encode_into		\
 	}
 
 /* A string type with allocation type "structs_type_string" and never NULL */
@@ -53,6 +63,8 @@ extern const struct structs_type structs_type_string_null;
 extern structs_equal_t structs_bstring_equal;
 extern structs_ascify_t structs_bstring_ascify;
 extern structs_binify_t structs_bstring_binify;
+extern structs_compare_t structs_bstring_compare;
+extern structs_hash_t structs_bstring_hash;
 
 #define STRUCTS_FIXEDSTRING_TYPE(bufsize) {		\
 		(bufsize),				\
@@ -66,7 +78,67 @@ extern structs_binify_t structs_bstring_binify;
 			structs_string_encode,		\
 			structs_string_decode,		\
 			structs_nothing_free,		\
-		{ { NULL }, { NULL }, { NULL } }	\
+		{ { NULL }, { NULL }, { NULL } },	\
+			NULL,				\
+			NULL,				\
+			structs_bstring_compare,	\
+			structs_bstring_hash,		\
+			structs_string_encode_into	\
+	}
+
+/*******************************************************************************
+ * SMALL STRING OPTIMIZED STRING TYPES
+ ******************************************************************************/
+
+/*
+ * Strings with the same value and encodings as structs_type_string,
+ * but stored inline if they are at most "cap" characters long, so only
+ * longer strings require a dynamic allocation.
+ *
+ * Declare fields as "STRUCTS_SSO_STRING(cap) name;" and read their
+ * values using STRUCTS_SSO_STRING_VALUE(&name).
+ *
+ * Type-specific arguments:
+ *  [int] Inline capacity
+ */
+#define STRUCTS_SSO_STRING(cap)						\
+	struct {							\
+		char *heap;	/* long string, or NULL */		\
+		char buf[(cap) + 1];	/* short string */		\
+	}
+
+#define STRUCTS_SSO_STRING_VALUE(s)					\
+	((s)->heap != NULL ?						\
+	 (const char *)(s)->heap : (const char *)(s)->buf)
+
+extern structs_copy_t structs_sso_string_copy;
+extern structs_equal_t structs_sso_string_equal;
+extern structs_ascify_t structs_sso_string_ascify;
+extern structs_ascify_into_t structs_sso_string_ascify_into;
+extern structs_binify_t structs_sso_string_binify;
+extern structs_uninit_t structs_sso_string_free;
+extern structs_memsize_t structs_sso_string_memsize;
+extern structs_compare_t structs_sso_string_compare;
+extern structs_hash_t structs_sso_string_hash;
+
+#define STRUCTS_SSO_STRING_TYPE(cap) {					\
+		sizeof(STRUCTS_SSO_STRING(cap)),			\
+			"ssostring",					\
+			STRUCTS_TYPE_PRIMITIVE,				\
+			structs_region_init,				\
+			structs_sso_string_copy,			\
+			structs_sso_string_equal,			\
+			structs_sso_string_ascify,			\
+			structs_sso_string_binify,			\
+			structs_string_encode,				\
+			structs_string_decode,				\
+			structs_sso_string_free,			\
+		{ { (void *)(cap) }, { NULL }, { NULL } },		\
+			structs_sso_string_ascify_into,			\
+			structs_sso_string_memsize,			\
+			structs_sso_string_compare,			\
+			structs_sso_string_hash,			\
+			structs_string_encode_into			\
 	}
 
 #endif /* _STRUCTS_TYPE_STRING_H_ */
@@ -14,8 +14,10 @@
 
 /* Module Includes */
 #include "structs.h"
+#include "structs_alloc.h"
 #include "structs_type_array.h"
 #include "structs_type_struct.h"
+#include "structs_internal.h"
 
 /*******************************************************************************
  * STRUCTURE TYPES
@@ -23,8 +25,23 @@
 
 #define NUM_BYTES(x) (((x) + 7) / 8)
 
+/*
+ * Get the cached information for a structure type, if available.
+ */
+static const struct structs_typeinfo *structs_struct_info(const struct
+							  structs_type *type)
+{
+	const int errno_save = errno;
+	const struct structs_typeinfo *info;
+
+	if ((info = structs_typeinfo_get(type)) == NULL)
+		errno = errno_save;
+	return (info);
+}
+
 int structs_struct_init(const struct structs_type *type, void *data)
 {
+	const struct structs_typeinfo *info;
 	const struct structs_field *field;
 
 	/* Make sure it's really a structure type */
@@ -33,6 +50,16 @@ int structs_struct_init(const struct structs_type *type, void *data)
 		return (-1);
 	}
 
+	/* Zero it all at once, or use the execution plan, if possible */
+	if ((info = structs_struct_info(type)) != NULL) {
+		if ((info->pod & STRUCTS_POD_INIT) != 0) {
+			memset(data, 0, type->size);
+			return (0);
+		}
+		if (info->plan != NULL)
+			return (structs_plan_init(info->plan, type, data));
+	}
+
 	/* Initialize each field */
 	memset(data, 0, type->size);
 	for (field = type->args[0].v; field->name != NULL; field++) {
@@ -57,6 +84,7 @@ int structs_struct_init(const struct structs_type *type, void *data)
 int structs_struct_copy(const struct structs_type *type,
 			const void *from, void *to)
 {
+	const struct structs_typeinfo *info;
 	const struct structs_field *field;
 
 	/* Make sure it's really a structure type */
@@ -65,6 +93,16 @@ int structs_struct_copy(const struct structs_type *type,
 		return (-1);
 	}
 
+	/* Copy it all at once, or use the execution plan, if possible */
+	if ((info = structs_struct_info(type)) != NULL) {
+		if ((info->pod & STRUCTS_POD_COPY) != 0) {
+			memcpy(to, from, type->size);
+			return (0);
+		}
+		if (info->plan != NULL)
+			return (structs_plan_copy(info->plan, type, from, to));
+	}
+
 	/* Copy each field */
 	memset(to, 0, type->size);
 	for (field = type->args[0].v; field->name != NULL; field++) {
@@ -82,6 +120,7 @@ int structs_struct_copy(const struct structs_type *type,
 						(char *)to + field->offset);
 		}
 		memset((char *)to, 0, type->size);
+		return (-1);
 	}
 	return (0);
 }
@@ -89,12 +128,21 @@ int structs_struct_copy(const struct structs_type *type,
 int structs_struct_equal(const struct structs_type *type,
 			 const void *v1, const void *v2)
 {
+	const struct structs_typeinfo *info;
 	const struct structs_field *field;
 
 	/* Make sure it's really a structure type */
 	if (type->tclass != STRUCTS_TYPE_STRUCTURE)
 		return (0);
 
+	/* Compare it all at once, or use the execution plan, if possible */
+	if ((info = structs_struct_info(type)) != NULL) {
+		if ((info->pod & STRUCTS_POD_EQUAL) != 0)
+			return (memcmp(v1, v2, type->size) == 0);
+		if (info->plan != NULL)
+			return (structs_plan_equal(info->plan, v1, v2));
+	}
+
 	/* Compare all fields */
 	for (field = type->args[0].v; field->name != NULL; field++) {
 		const void *const data1 = (char *)v1 + field->offset;
@@ -106,15 +154,69 @@ int structs_struct_equal(const struct structs_type *type,
 	return (1);
 }
 
+int structs_struct_compare(const struct structs_type *type,
+			   const void *v1, const void *v2)
+{
+	const struct structs_field *field;
+	int r;
+
+	/* Make sure it's really a structure type */
+	if (type->tclass != STRUCTS_TYPE_STRUCTURE) {
+		errno = EINVAL;
+		return (0);
+	}
+
+	/* Compare fields in order */
+	for (field = type->args[0].v; field->name != NULL; field++) {
+		const void *const data1 = (char *)v1 + field->offset;
+		const void *const data2 = (char *)v2 + field->offset;
+
+		if ((r = structs_compare_item(field->type, data1, data2)) != 0)
+			return (r);
+	}
+	return (0);
+}
+
+uint64_t structs_struct_hash(const struct structs_type *type, const void *data)
+{
+	const struct structs_typeinfo *info;
+	const struct structs_field *field;
+	uint64_t hash = STRUCTS_HASH_INIT;
+	uint64_t fhash;
+
+	/* Make sure it's really a structure type */
+	if (type->tclass != STRUCTS_TYPE_STRUCTURE) {
+		errno = EINVAL;
+		return (0);
+	}
+
+	/* Hash it all at once, if possible */
+	if ((info = structs_struct_info(type)) != NULL
+	    && (info->pod & STRUCTS_POD_EQUAL) != 0)
+		return (structs_hash_bytes(hash, data, type->size));
+
+	/* Combine hashes of all fields */
+	for (field = type->args[0].v; field->name != NULL; field++) {
+		fhash = structs_hash_item(field->type,
+					  (char *)data + field->offset);
+		hash = structs_hash_bytes(hash, &fhash, sizeof(fhash));
+	}
+	return (hash);
+}
+
 int structs_struct_encode(const struct structs_type *type,
 			  struct structs_data *code, const void *data)
 {
-	struct structs_data *fcodes;
+	return (structs_encoder_encode(type, code, data));
+}
+
+int structs_struct_encode_into(const struct structs_type *type,
+			       struct structs_encoder *enc, const void *data)
+{
 	unsigned int nfields;
 	unsigned int bitslen;
 	unsigned char *bits;
-	int r = -1;
-	unsigned int tlen;
+	size_t boff;
 	unsigned int i;
 
 	/* Count number of fields */
@@ -122,75 +224,34 @@ int structs_struct_encode(const struct structs_type *type,
 	     ((struct structs_field *)type->args[0].v)[nfields].name != NULL;
 	     nfields++) ;
 
-	/* Create bit array. Each bit indicates a field as being present. */
+	/* Append bit array. Each bit indicates a field as being present. */
 	bitslen = NUM_BYTES(nfields);
-	if ((bits = calloc(1, bitslen)) == NULL)
+	boff = enc->length;
+	if ((bits = structs_encoder_reserve(enc, bitslen)) == NULL)
 		return (-1);
 	memset(bits, 0, bitslen);
-	tlen = bitslen;
 
-	/* Create array of individual encodings, one per field */
-	if ((fcodes = calloc(1, nfields * sizeof(*fcodes))) == NULL)
-		goto fail1;
+	/* Append encoded fields */
 	for (i = 0; i < nfields; i++) {
 		const struct structs_field *const field
 			= (struct structs_field *)type->args[0].v + i;
 		const void *const fdata = (char *)data + field->offset;
-		struct structs_data *const fcode = &fcodes[i];
-		void *dval;
-		int equal;
+		const void *dval;
 
 		/* Compare this field to the default value */
-		if ((dval = calloc(1, field->type->size)) == NULL)
-			goto fail2;
-		if (structs_init(field->type, NULL, dval) == -1) {
-			free(dval);
-			goto fail2;
-		}
-		equal = (*field->type->equal) (field->type, fdata, dval);
-		structs_free(field->type, NULL, dval);
-		free(dval);
+		if ((dval = structs_default(field->type)) == NULL)
+			return (-1);
 
 		/* Omit field if value equals default value */
-		if (equal == 1) {
-			memset(fcode, 0, sizeof(*fcode));
+		if ((*field->type->equal) (field->type, fdata, dval) == 1)
 			continue;
-		}
-		bits[i / 8] |= (1 << (i % 8));
+		enc->data[boff + i / 8] |= (1 << (i % 8));
 
 		/* Encode this field */
-		if ((*field->type->encode) (field->type, fcode,
-					    (char *)data + field->offset) == -1)
-			goto fail2;
-		tlen += fcode->length;
-	}
-
-	/* Allocate final encoded region */
-	if ((code->data = calloc(1, tlen)) == NULL)
-		goto done;
-
-	/* Copy bits */
-	memcpy(code->data, bits, bitslen);
-	code->length = bitslen;
-
-	/* Copy encoded fields */
-	for (i = 0; i < nfields; i++) {
-		struct structs_data *const fcode = &fcodes[i];
-
-		memcpy(code->data + code->length, fcode->data, fcode->length);
-		code->length += fcode->length;
+		if (structs_encode_into(field->type, enc, fdata) == -1)
+			return (-1);
 	}
-
-	/* OK */
-	r = 0;
-
-done:
-	/* Clean up and exit */
-fail2:	while (i-- > 0)
-		free(fcodes[i].data);
-	free(fcodes);
-fail1:	free(bits);
-	return (r);
+	return (0);
 }
 
 int structs_struct_decode(const struct structs_type *type,
@@ -263,12 +324,25 @@ int structs_struct_decode(const struct structs_type *type,
 
 void structs_struct_free(const struct structs_type *type, void *data)
 {
+	const struct structs_typeinfo *info;
 	const struct structs_field *field;
 
 	/* Make sure it's really a structure type */
 	if (type->tclass != STRUCTS_TYPE_STRUCTURE)
 		return;
 
+	/* Skip the fields, or use the execution plan, if possible */
+	if ((info = structs_struct_info(type)) != NULL) {
+		if ((info->pod & STRUCTS_POD_FREE) != 0) {
+			memset(data, 0, type->size);
+			return;
+		}
+		if (info->plan != NULL) {
+			structs_plan_free(info->plan, type, data);
+			return;
+		}
+	}
+
 	/* Free all fields */
 	for (field = type->args[0].v; field->name != NULL; field++) {
 		(*field->type->uninit) (field->type,
@@ -52,15 +52,23 @@ typedef struct structs_field {
 			structs_struct_encode,			\
 			structs_struct_decode,			\
 			structs_struct_free,			\
-		{ { (void *)(flist) }, { NULL }, { NULL } }	\
+		{ { (void *)(flist) }, { NULL }, { NULL } },	\
+			NULL,					\
+			NULL,					\
+			structs_struct_compare,			\
+			structs_struct_hash,			\
+			structs_struct_encode_into		\
 	}
 
 extern structs_init_t structs_struct_init;
 extern structs_copy_t structs_struct_copy;
 extern structs_equal_t structs_struct_equal;
 extern structs_encode_t structs_struct_encode;
+extern structs_encode_into_t structs_struct_encode_into;
 extern structs_decode_t structs_struct_decode;
 extern structs_uninit_t structs_struct_free;
+extern structs_compare_t structs_struct_compare;
+extern structs_hash_t structs_struct_hash;
 
 #endif /* _STRUCTS_TYPE_STRUCT_H_ */
 /*******************************************************************************
@@ -15,6 +15,7 @@
 
 /* Module Includes */
 #include "structs.h"
+#include "structs_alloc.h"
 #include "structs_type_array.h"
 #include "structs_type_int.h"
 #include "structs_type_time.h"
@@ -28,23 +29,35 @@
 #define FMT_IS08601 "%Y%m%dT%H:%M:%S"
 
 static structs_ascify_t structs_time_ascify;
+static structs_ascify_into_t structs_time_ascify_into;
 static structs_binify_t structs_time_binify;
+static structs_compare_t structs_time_compare;
 
 static char *structs_time_ascify(const struct structs_type *type,
 				 const void *data)
+{
+	char buf[64];
+
+	structs_time_ascify_into(type, data, buf, sizeof(buf));
+	return (structs_mem_strdup(buf));
+}
+
+static int structs_time_ascify_into(const struct structs_type *type,
+				    const void *data, char *buf, size_t bufmax)
 {
 	const char *fmt = type->args[0].s;
 	const int local = type->args[1].i;
 	const time_t when = *((time_t *) data);
 	struct tm tm;
-	char buf[64];
+	char tbuf[64];
 
 	if (local)
 		localtime_r(&when, &tm);
 	else
 		gmtime_r(&when, &tm);
-	strftime(buf, sizeof(buf), fmt, &tm);
-	return (strdup(buf));
+	if (strftime(tbuf, sizeof(tbuf), fmt, &tm) == 0)
+		tbuf[0] = '\0';
+	return (snprintf(buf, bufmax, "%s", tbuf));
 }
 
 static int structs_time_binify(const struct structs_type *type,
@@ -80,6 +93,16 @@ static int structs_time_binify(const struct structs_type *type,
 	return (0);
 }
 
+/* Also used by the absolute and relative time types */
+static int structs_time_compare(const struct structs_type *type,
+				const void *v1, const void *v2)
+{
+	const time_t t1 = *((const time_t *)v1);
+	const time_t t2 = *((const time_t *)v2);
+
+	return ((t1 > t2) - (t1 < t2));
+}
+
 const struct structs_type structs_type_time_gmt = {
 	sizeof(time_t),
 	"time",
@@ -92,7 +115,12 @@ const struct structs_type structs_type_time_gmt = {
 	structs_region_encode_netorder,
 	structs_region_decode_netorder,
 	structs_nothing_free,
-	{ { (void *)FMT_GMT}, { (void *)0} }
+	{ { (void *)FMT_GMT}, { (void *)0} },
+	structs_time_ascify_into,
+	NULL,
+	structs_time_compare,
+	structs_region_hash,
+	structs_region_encode_netorder_into
 };
 
 const struct structs_type structs_type_time_local = {
@@ -107,7 +135,12 @@ const struct structs_type structs_type_time_local = {
 	structs_region_encode_netorder,
 	structs_region_decode_netorder,
 	structs_nothing_free,
-	{ { (void *)FMT_LOCAL}, { (void *)1} }
+	{ { (void *)FMT_LOCAL}, { (void *)1} },
+	structs_time_ascify_into,
+	NULL,
+	structs_time_compare,
+	structs_region_hash,
+	structs_region_encode_netorder_into
 };
 
 const struct structs_type structs_type_time_iso8601 = {
@@ -122,7 +155,12 @@ const struct structs_type structs_type_time_iso8601 = {
 	structs_region_encode_netorder,
 	structs_region_decode_netorder,
 	structs_nothing_free,
-	{ { (void *)FMT_IS08601}, { (void *)0} }
+	{ { (void *)FMT_IS08601}, { (void *)0} },
+	structs_time_ascify_into,
+	NULL,
+	structs_time_compare,
+	structs_region_hash,
+	structs_region_encode_netorder_into
 };
 
 /*
@@ -135,6 +173,7 @@ const struct structs_type structs_type_time_iso8601 = {
 /* XXX This assumes sizeof(time_t) <= sizeof(long) */
 
 static structs_ascify_t structs_time_abs_ascify;
+static structs_ascify_into_t structs_time_abs_ascify_into;
 static structs_binify_t structs_time_abs_binify;
 
 static char *structs_time_abs_ascify(const struct structs_type *type,
@@ -145,6 +184,16 @@ static char *structs_time_abs_ascify(const struct structs_type *type,
 	return (structs_type_ulong.ascify(&structs_type_ulong, &when));
 }
 
+static int structs_time_abs_ascify_into(const struct structs_type *type,
+					const void *data, char *buf,
+					size_t bufmax)
+{
+	const u_long when = (u_long) * ((time_t *) data);
+
+	return (structs_int_ascify_into(&structs_type_ulong, &when,
+					buf, bufmax));
+}
+
 static int structs_time_abs_binify(const struct structs_type *type,
 				   const char *ascii, void *data,
 				   char *ebuf, size_t emax)
@@ -170,6 +219,12 @@ const struct structs_type structs_type_time_abs = {
 	structs_region_encode_netorder,
 	structs_region_decode_netorder,
 	structs_nothing_free,
+	{ { NULL } },
+	structs_time_abs_ascify_into,
+	NULL,
+	structs_time_compare,
+	structs_region_hash,
+	structs_region_encode_netorder_into
 };
 
 /*
@@ -177,19 +232,28 @@ const struct structs_type structs_type_time_abs = {
  */
 
 static structs_ascify_t structs_reltime_ascify;
+static structs_ascify_into_t structs_reltime_ascify_into;
 static structs_binify_t structs_reltime_binify;
 
 /* XXX This assumes sizeof(time_t) <= sizeof(long) */
 
 static char *structs_reltime_ascify(const struct structs_type *type,
 				    const void *data)
+{
+	char buf[32];
+
+	structs_reltime_ascify_into(type, data, buf, sizeof(buf));
+	return (structs_mem_strdup(buf));
+}
+
+static int structs_reltime_ascify_into(const struct structs_type *type,
+				       const void *data, char *buf,
+				       size_t bufmax)
 {
 	const time_t now = time(NULL);
 	const time_t diff = *((time_t *) data) - now;
-	char buf[32];
 
-	snprintf(buf, sizeof(buf), "%ld", (u_long) diff);
-	return (strdup(buf));
+	return (snprintf(buf, bufmax, "%ld", (u_long) diff));
 }
 
 static int structs_reltime_binify(const struct structs_type *type,
@@ -225,6 +289,12 @@ const struct structs_type structs_type_time_rel = {
 	structs_region_encode_netorder,
 	structs_region_decode_netorder,
 	structs_nothing_free,
+	{ { NULL } },
+	structs_reltime_ascify_into,
+	NULL,
+	structs_time_compare,
+	structs_region_hash,
+	structs_region_encode_netorder_into
 };
 
 /*******************************************************************************
@@ -14,9 +14,34 @@
 
 /* Module Includes */
 #include "structs.h"
+#include "structs_alloc.h"
 #include "structs_type_array.h"
 #include "structs_type_string.h"
 #include "structs_type_union.h"
+#include "structs_internal.h"
+
+/*******************************************************************************
+ * MACROS/VARIABLES
+ ******************************************************************************/
+
+/* Offset of the body of an inline union, or zero if it's not inline */
+#define STRUCTS_UNION_INLINE(type)	((size_t)(type)->args[2].i)
+
+/* Inline union header */
+struct structs_inline_union {
+	unsigned int field_index;	/* index of field in use */
+};
+
+/*******************************************************************************
+ * FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+static void *structs_union_alloc(const struct structs_type *type, void *data,
+				 const struct structs_ufield *field);
+static void structs_union_dealloc(const struct structs_type *type,
+				  void *data);
+static void structs_union_select(const struct structs_type *type, void *data,
+				 const struct structs_ufield *field);
 
 /*******************************************************************************
  * UNION TYPE METHODS
@@ -25,15 +50,16 @@
 int structs_union_set(const struct structs_type *type, const char *name,
 		      void *data, const char *field_name)
 {
-	const struct structs_ufield *fields;
 	const struct structs_ufield *ofield = NULL;
+	const struct structs_ufield *fields;
 	const struct structs_ufield *field;
-	struct structs_union *un;
+	structs_union_buf_t ubuf;
 	void *new_un;
-	int have_old = 1;
+	int i;
 
 	/* Find item */
-	if ((type = structs_find(type, name, (const void **)&data, 0)) == NULL)
+	if ((type = structs_find_flags(type, name, (const void **)&data,
+				       STRUCTS_FIND_UNSHARE)) == NULL)
 		return (-1);
 
 	/* Sanity check */
@@ -44,61 +70,46 @@ int structs_union_set(const struct structs_type *type, const char *name,
 
 	/* Get union info */
 	fields = type->args[0].v;
-	un = data;
 
 	/* Allow 0 initialized union */
-	if (un->field_name == NULL && un->un == NULL) {
-		have_old = 0;
+	if (!STRUCTS_UNION_INLINE(type)
+	    && ((struct structs_union *)data)->field_name == NULL
+	    && ((struct structs_union *)data)->un == NULL)
 		goto union_set_new;
-	}
 
 	/* Find the old field */
-	for (ofield = fields; ofield->name != NULL
-	     && strcmp(ofield->name, un->field_name) != 0; ofield++) ;
-	if (ofield->name == NULL) {
-		assert(0);
-		errno = EINVAL;
+	if ((ofield = structs_union_field(type, data)) == NULL)
 		return (-1);
-	}
 
 	/* Check if the union is already set to the desired field */
-	if (strcmp(un->field_name, field_name) == 0)
+	if (strcmp(ofield->name, field_name) == 0)
 		return (0);
 
 union_set_new:
 
 	/* Find the new field */
-	for (field = fields; field->name != NULL
-	     && strcmp(field->name, field_name) != 0; field++) ;
-	if (field->name == NULL) {
-		errno = ENOENT;
+	if ((i = structs_field_index(type, field_name)) == -1)
 		return (-1);
-	}
+	field = fields + i;
 
 	/* Create a new union with the new field type */
-	if ((new_un = calloc(1, field->type->size)) == NULL)
-		return (-1);
-	if ((*field->type->init) (field->type, new_un) == -1) {
-		free(new_un);
+	if ((new_un = structs_union_new(type, field, &ubuf)) == NULL)
 		return (-1);
-	}
 
 	/* Replace existing union with new one having desired type */
-	if (have_old) {
-		(*ofield->type->uninit) (ofield->type, un->un);
-		free(un->un);
+	if (ofield == NULL) {
+		((struct structs_union *)data)->un = new_un;
+		structs_union_select(type, data, field);
+		return (0);
 	}
-	un->un = new_un;
-
-	/* Set field name */
-	*((const char **)&un->field_name) = field->name;
+	structs_union_replace(type, data, field, new_un, &ubuf);
 	return (0);
 }
 
 int structs_union_init(const struct structs_type *type, void *data)
 {
 	const struct structs_ufield *const field = type->args[0].v;
-	struct structs_union *const un = data;
+	void *body;
 
 	/* Sanity */
 	if (field->name == NULL) {
@@ -108,131 +119,143 @@ int structs_union_init(const struct structs_type *type, void *data)
 	assert(type->tclass == STRUCTS_TYPE_UNION);
 
 	/* Allocate union memory */
-	if ((un->un = calloc(1, field->type->size)) == NULL)
+	if ((body = structs_union_alloc(type, data, field)) == NULL)
 		return (-1);
 
 	/* Initialize field using first member type */
-	if ((*field->type->init) (field->type, un->un) == -1) {
-		free(un->un);
+	if ((*field->type->init) (field->type, body) == -1) {
+		structs_union_dealloc(type, data);
 		return (-1);
 	}
 
 	/* Set field name */
-	*((const char **)&un->field_name) = field->name;
+	structs_union_select(type, data, field);
 	return (0);
 }
 
 int structs_union_copy(const struct structs_type *type,
 		       const void *from, void *to)
 {
-	const struct structs_union *const fun = from;
-	const struct structs_ufield *const fields = type->args[0].v;
 	const struct structs_ufield *field;
-	struct structs_union *const tun = to;
+	void *body;
 
 	/* Sanity check */
 	assert(type->tclass == STRUCTS_TYPE_UNION);
 
 	/* Find field */
-	for (field = fields; field->name != NULL
-	     && strcmp(fun->field_name, field->name) != 0; field++) ;
-	if (field->name == NULL) {
-		assert(0);
-		errno = EINVAL;
+	if ((field = structs_union_field(type, from)) == NULL)
 		return (-1);
-	}
 
 	/* Allocate copy union */
-	if ((tun->un = calloc(1, field->type->size)) == NULL)
+	if ((body = structs_union_alloc(type, to, field)) == NULL)
 		return (-1);
 
 	/* Copy field */
-	if ((*field->type->copy) (field->type, fun->un, tun->un) == -1) {
-		free(tun->un);
+	if ((*field->type->copy) (field->type,
+				  structs_union_body(type, from), body) == -1) {
+		structs_union_dealloc(type, to);
 		return (-1);
 	}
 
 	/* Set field name */
-	*((const char **)&tun->field_name) = fun->field_name;
+	structs_union_select(type, to, field);
 	return (0);
 }
 
 int structs_union_equal(const struct structs_type *type,
 			const void *v1, const void *v2)
 {
-	const struct structs_union *const un1 = v1;
-	const struct structs_union *const un2 = v2;
-	const struct structs_ufield *const fields = type->args[0].v;
-	const struct structs_ufield *field;
+	const struct structs_ufield *field1;
+	const struct structs_ufield *field2;
 
 	/* Sanity check */
 	assert(type->tclass == STRUCTS_TYPE_UNION);
 
+	/* Find fields */
+	if ((field1 = structs_union_field(type, v1)) == NULL
+	    || (field2 = structs_union_field(type, v2)) == NULL)
+		return (-1);
+
 	/* Check if fields are the same */
-	if (strcmp(un1->field_name, un2->field_name) != 0)
+	if (field1 != field2)
 		return (0);
 
-	/* Find field */
-	for (field = fields; field->name != NULL
-	     && strcmp(un1->field_name, field->name) != 0; field++) ;
-	if (field->name == NULL) {
-		assert(0);
-		errno = EINVAL;
-		return (-1);
-	}
-
 	/* Compare them */
-	return ((*field->type->equal) (field->type, un1->un, un2->un));
+	return ((*field1->type->equal) (field1->type,
+					structs_union_body(type, v1),
+					structs_union_body(type, v2)));
 }
 
-int structs_union_encode(const struct structs_type *type,
-			 struct structs_data *code, const void *data)
+int structs_union_compare(const struct structs_type *type,
+			  const void *v1, const void *v2)
+{
+	const struct structs_ufield *field1;
+	const struct structs_ufield *field2;
+
+	/* Sanity check */
+	assert(type->tclass == STRUCTS_TYPE_UNION);
+
+	/* Find fields */
+	if ((field1 = structs_union_field(type, v1)) == NULL
+	    || (field2 = structs_union_field(type, v2)) == NULL)
+		return (0);
+
+	/* Order by field first, in the order they are listed */
+	if (field1 != field2)
+		return (field1 < field2 ? -1 : 1);
+
+	/* Then by contents */
+	return (structs_compare_item(field1->type,
+				     structs_union_body(type, v1),
+				     structs_union_body(type, v2)));
+}
+
+uint64_t structs_union_hash(const struct structs_type *type, const void *data)
 {
-	const struct structs_union *const un = data;
 	const struct structs_ufield *const fields = type->args[0].v;
 	const struct structs_ufield *field;
-	struct structs_data ncode;
-	struct structs_data fcode;
+	uint64_t hash = STRUCTS_HASH_INIT;
+	uint64_t fhash;
+	unsigned int i;
 
 	/* Sanity check */
 	assert(type->tclass == STRUCTS_TYPE_UNION);
 
 	/* Find field */
-	for (field = fields; field->name != NULL
-	     && strcmp(un->field_name, field->name) != 0; field++) ;
-	if (field->name == NULL) {
-		assert(0);
-		errno = EINVAL;
-		return (-1);
-	}
+	if ((field = structs_union_field(type, data)) == NULL)
+		return (0);
 
-	/* Encode name */
-	if (structs_string_encode(&structs_type_string,
-				  &ncode, &field->name) == -1)
-		return (-1);
+	/* Combine field index with hash of contents */
+	i = field - fields;
+	hash = structs_hash_bytes(hash, &i, sizeof(i));
+	fhash = structs_hash_item(field->type, structs_union_body(type, data));
+	return (structs_hash_bytes(hash, &fhash, sizeof(fhash)));
+}
 
-	/* Encode field */
-	if ((*field->type->encode) (field->type, &fcode, un->un) == -1) {
-		free(ncode.data);
-		return (-1);
-	}
+int structs_union_encode(const struct structs_type *type,
+			 struct structs_data *code, const void *data)
+{
+	return (structs_encoder_encode(type, code, data));
+}
 
-	/* Allocate code buffer */
-	code->length = ncode.length + fcode.length;
-	if ((code->data = calloc(1, code->length)) == NULL) {
-		free(fcode.data);
-		free(ncode.data);
-		return (-1);
-	}
+int structs_union_encode_into(const struct structs_type *type,
+			      struct structs_encoder *enc, const void *data)
+{
+	const struct structs_ufield *field;
 
-	/* Copy encoded name and field */
-	memcpy(code->data, ncode.data, ncode.length);
-	memcpy(code->data + ncode.length, fcode.data, fcode.length);
+	/* Sanity check */
+	assert(type->tclass == STRUCTS_TYPE_UNION);
 
-	/* Done */
-	free(ncode.data);
-	free(fcode.data);
-	return (0);
+	/* Find field */
+	if ((field = structs_union_field(type, data)) == NULL)
+		return (-1);
+
+	/* Encode name, then field */
+	if (structs_string_encode_into(&structs_type_string,
+				       enc, &field->name) == -1)
+		return (-1);
+	return (structs_encode_into(field->type, enc,
+				    structs_union_body(type, data)));
 }
 
 int structs_union_decode(const struct structs_type *type,
@@ -240,11 +263,12 @@ int structs_union_decode(const struct structs_type *type,
 			 void *data, char *ebuf, size_t emax)
 {
 	const struct structs_ufield *const fields = type->args[0].v;
-	struct structs_union *const un = data;
 	const struct structs_ufield *field;
 	char *field_name;
+	void *body;
 	int nlen;
 	int flen;
+	int i;
 
 	/* Sanity check */
 	assert(type->tclass == STRUCTS_TYPE_UNION);
@@ -256,55 +280,218 @@ int structs_union_decode(const struct structs_type *type,
 		return (-1);
 
 	/* Find field */
-	for (field = fields; field->name != NULL
-	     && strcmp(field_name, field->name) != 0; field++) ;
-	if (field->name == NULL) {
+	if ((i = structs_field_lookup(type, field_name,
+				      strlen(field_name))) == -1) {
 		snprintf(ebuf, emax, "unknown union field \"%s\"", field_name);
-		free(field_name);
+		structs_mem_free(field_name);
 		return (-1);
 	}
-	free(field_name);
+	field = fields + i;
+	structs_mem_free(field_name);
 
 	/* Allocate field memory */
-	if ((un->un = calloc(1, field->type->size)) == NULL) {
-		memset(un, 0, sizeof(*un));
+	if ((body = structs_union_alloc(type, data, field)) == NULL) {
+		memset(data, 0, type->size);
 		return (-1);
 	}
 
 	/* Decode field */
 	if ((flen = (*field->type->decode) (field->type,
-					    code + nlen, cmax - nlen, un->un,
+					    code + nlen, cmax - nlen, body,
 					    ebuf, emax)) == -1) {
-		free(un->un);
-		memset(un, 0, sizeof(*un));
+		structs_union_dealloc(type, data);
+		memset(data, 0, type->size);
 		return (-1);
 	}
 
 	/* Set field name */
-	*((const char **)&un->field_name) = field->name;
+	structs_union_select(type, data, field);
 	return (nlen + flen);
 }
 
 void structs_union_free(const struct structs_type *type, void *data)
 {
-	const struct structs_union *const un = data;
-	const struct structs_ufield *const fields = type->args[0].v;
 	const struct structs_ufield *field;
 
 	/* Sanity check */
 	assert(type->tclass == STRUCTS_TYPE_UNION);
 
 	/* Find field */
-	for (field = fields; field->name != NULL
-	     && strcmp(un->field_name, field->name) != 0; field++) ;
-	if (field->name == NULL) {
-		assert(0);
+	if ((field = structs_union_field(type, data)) == NULL)
 		return;
-	}
 
 	/* Free it */
-	(*field->type->uninit) (field->type, un->un);
-	free(un->un);
+	(*field->type->uninit) (field->type, structs_union_body(type, data));
+	structs_union_dealloc(type, data);
+}
+
+void structs_union_memsize(const struct structs_type *type, const void *data,
+			   structs_memblock_t *block, void *arg)
+{
+	const struct structs_ufield *field;
+
+	/* Inline unions hold their field directly */
+	if (STRUCTS_UNION_INLINE(type)
+	    || ((const struct structs_union *)data)->un == NULL)
+		return;
+	if ((field = structs_union_field(type, data)) == NULL)
+		return;
+	(*block) (arg, structs_union_body(type, data), field->type->size);
+}
+
+/*******************************************************************************
+ * UNION ACCESS
+ ******************************************************************************/
+
+const struct structs_ufield *structs_union_field(const struct structs_type
+						 *type, const void *data)
+{
+	const struct structs_ufield *const fields = type->args[0].v;
+	const struct structs_typeinfo *info;
+	const char *field_name;
+	int i;
+
+	/* Inline unions record the field index */
+	if (STRUCTS_UNION_INLINE(type)) {
+		if ((info = structs_typeinfo_get(type)) == NULL)
+			return (NULL);
+		i = ((const struct structs_inline_union *)data)->field_index;
+		if ((unsigned int)i >= info->nfields)
+			goto bogus;
+		return (fields + i);
+	}
+
+	/* Others record the field name, normally the field's own */
+	if ((field_name = ((const struct structs_union *)data)->field_name)
+	    == NULL || (i = structs_field_index(type, field_name)) == -1)
+		goto bogus;
+	return (fields + i);
+
+bogus:
+	assert(0);
+	errno = EINVAL;
+	return (NULL);
+}
+
+void *structs_union_body(const struct structs_type *type, const void *data)
+{
+	if (STRUCTS_UNION_INLINE(type))
+		return ((char *)data + STRUCTS_UNION_INLINE(type));
+	return (((const struct structs_union *)data)->un);
+}
+
+const char *const *structs_union_namep(const struct structs_type *type,
+				       const void *data)
+{
+	const struct structs_ufield *field;
+
+	if (!STRUCTS_UNION_INLINE(type))
+		return (&((const struct structs_union *)data)->field_name);
+	if ((field = structs_union_field(type, data)) == NULL)
+		return (NULL);
+	return (&field->name);
+}
+
+void *structs_union_new(const struct structs_type *type,
+			const struct structs_ufield *field,
+			structs_union_buf_t *ubuf)
+{
+	void *new_un;
+
+	/* Build inline fields on the stack if they fit */
+	if (STRUCTS_UNION_INLINE(type)
+	    && field->type->size <= sizeof(ubuf->buf)) {
+		new_un = ubuf->buf;
+		memset(new_un, 0, field->type->size);
+	} else if ((new_un = structs_mem_calloc(1, field->type->size)) == NULL)
+		return (NULL);
+	if ((*field->type->init) (field->type, new_un) == -1) {
+		if (new_un != ubuf->buf)
+			structs_mem_free(new_un);
+		return (NULL);
+	}
+	return (new_un);
+}
+
+void structs_union_discard(const struct structs_ufield *field, void *new_un,
+			   structs_union_buf_t *ubuf)
+{
+	(*field->type->uninit) (field->type, new_un);
+	if (new_un != ubuf->buf)
+		structs_mem_free(new_un);
+}
+
+void *structs_union_replace(const struct structs_type *type, void *data,
+			    const struct structs_ufield *field, void *new_un,
+			    structs_union_buf_t *ubuf)
+{
+	const struct structs_ufield *ofield;
+	void *body;
+
+	/* Free the old field, if it's valid */
+	if ((ofield = structs_union_field(type, data)) != NULL) {
+		(*ofield->type->uninit) (ofield->type,
+					 structs_union_body(type, data));
+	}
+
+	/* Move the new field into place */
+	if (STRUCTS_UNION_INLINE(type)) {
+		body = structs_union_body(type, data);
+		memcpy(body, new_un, field->type->size);
+		if (new_un != ubuf->buf)
+			structs_mem_free(new_un);
+	} else {
+		structs_mem_free(((struct structs_union *)data)->un);
+		((struct structs_union *)data)->un = body = new_un;
+	}
+	structs_union_select(type, data, field);
+	return (body);
+}
+
+/*
+ * Get memory for the body of a new field. Inline unions already have it.
+ */
+static void *structs_union_alloc(const struct structs_type *type, void *data,
+				 const struct structs_ufield *field)
+{
+	void *body;
+
+	if (STRUCTS_UNION_INLINE(type)) {
+		body = structs_union_body(type, data);
+		memset(body, 0, field->type->size);
+		return (body);
+	}
+	if ((body = structs_mem_calloc(1, field->type->size)) == NULL)
+		return (NULL);
+	((struct structs_union *)data)->un = body;
+	return (body);
+}
+
+/*
+ * Release memory obtained by structs_union_alloc().
+ */
+static void structs_union_dealloc(const struct structs_type *type,
+				  void *data)
+{
+	if (!STRUCTS_UNION_INLINE(type))
+		structs_mem_free(((struct structs_union *)data)->un);
+}
+
+/*
+ * Record which field is in use.
+ */
+static void structs_union_select(const struct structs_type *type, void *data,
+				 const struct structs_ufield *field)
+{
+	const struct structs_ufield *const fields = type->args[0].v;
+
+	if (STRUCTS_UNION_INLINE(type)) {
+		((struct structs_inline_union *)data)->field_index =
+		    field - fields;
+		return;
+	}
+	*((const char **)&((struct structs_union *)data)->field_name) =
+	    field->name;
 }
 
 /*******************************************************************************
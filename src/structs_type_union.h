@@ -1,6 +1,13 @@
 #ifndef _STRUCTS_TYPE_UNION_H_
 #define _STRUCTS_TYPE_UNION_H_
 
+/*******************************************************************************
+ * HEADERS
+ ******************************************************************************/
+
+/* Standard Includes */
+#include <stddef.h>
+
 /*******************************************************************************
  * UNION TYPES
  ******************************************************************************/
@@ -30,6 +37,25 @@ typedef struct structs_union {
 		union uname *un;            /* pointer to the field */	\
 	} sname
 
+/*
+ * Inline unions keep the field contents inside the structure, so
+ * selecting a field of up to 256 bytes doesn't allocate memory, and
+ * record the field in use by its index in the list of union fields.
+ *
+ * The data must be a structure defined using DEFINE_STRUCTS_INLINE_UNION(),
+ * where "union uname" has a member for each union field.
+ */
+#define DEFINE_STRUCTS_INLINE_UNION(sname, uname)			\
+	struct sname {							\
+		unsigned int field_index;	/* index of field in use */ \
+		union uname un;		/* the field contents */	\
+	}
+#define DEFINE_STRUCTS_INLINE_UNION_T(sname, uname)			\
+	typedef struct sname {						\
+		unsigned int field_index;	/* index of field in use */ \
+		union uname un;		/* the field contents */	\
+	} sname
+
 /* This structure describes one field in a union */
 typedef struct structs_ufield {
 	const char *name;	/* name of field */
@@ -56,8 +82,12 @@ extern structs_init_t structs_union_init;
 extern structs_copy_t structs_union_copy;
 extern structs_equal_t structs_union_equal;
 extern structs_encode_t structs_union_encode;
+extern structs_encode_into_t structs_union_encode_into;
 extern structs_decode_t structs_union_decode;
 extern structs_uninit_t structs_union_free;
+extern structs_memsize_t structs_union_memsize;
+extern structs_compare_t structs_union_compare;
+extern structs_hash_t structs_union_hash;
 
 #define STRUCTS_UNION_TYPE(uname, flist) {				\
 		sizeof(struct structs_union),				\
@@ -71,7 +101,43 @@ extern structs_uninit_t structs_union_free;
 			structs_union_encode,				\
 			structs_union_decode,				\
 			structs_union_free,				\
-		{ { (void *)(flist) }, { (void *)("union " #uname) }, { NULL } } \
+		{ { (void *)(flist) }, { (void *)("union " #uname) }, { NULL } }, \
+			NULL,						\
+			structs_union_memsize,				\
+			structs_union_compare,				\
+			structs_union_hash,				\
+			structs_union_encode_into			\
+	}
+
+/*
+ * Inline union type. Inline unions support everything other unions do,
+ * including the read-only "field_name" pseudo-field.
+ *
+ * Type-specific arguments:
+ *  [const struct structs_ufield *]  List of union fields, terminated
+ *                      by entry with name == NULL.
+ *  [const char *]          Unused
+ *  [int]                   Offset of the field contents
+ */
+#define STRUCTS_INLINE_UNION_TYPE(sname, flist) {			\
+		sizeof(struct sname),					\
+			"inlineunion",					\
+			STRUCTS_TYPE_UNION,				\
+			structs_union_init,				\
+			structs_union_copy,				\
+			structs_union_equal,				\
+			structs_notsupp_ascify,				\
+			structs_notsupp_binify,				\
+			structs_union_encode,				\
+			structs_union_decode,				\
+			structs_union_free,				\
+		{ { (void *)(flist) }, { NULL },			\
+		  { (void *)offsetof(struct sname, un) } },		\
+			NULL,						\
+			NULL,						\
+			structs_union_compare,				\
+			structs_union_hash,				\
+			structs_union_encode_into			\
 	}
 
 /* Functions */
@@ -0,0 +1,547 @@
+/*******************************************************************************
+ * HEADERS
+ ******************************************************************************/
+
+/* Standard Includes */
+#include <sys/types.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+/* Module Includes */
+#include "structs.h"
+#include "structs_alloc.h"
+#include "structs_type_array.h"
+#include "structs_type_struct.h"
+#include "structs_type_union.h"
+#include "structs_internal.h"
+
+/*******************************************************************************
+ * MACROS/VARIABLES
+ ******************************************************************************/
+
+/* Number of hash buckets for the type information cache */
+#define STRUCTS_TYPEINFO_BUCKETS	256
+
+/* Hash a type pointer into a bucket */
+#define STRUCTS_TYPEINFO_HASH(type)					\
+	((((uintptr_t)(type) >> 4) ^ ((uintptr_t)(type) >> 12))		\
+	    & (STRUCTS_TYPEINFO_BUCKETS - 1))
+
+/* Empty slot in a field name hash table */
+#define STRUCTS_FIELD_EMPTY	(-1)
+
+/* Hash a field name pointer */
+#define STRUCTS_FIELD_PHASH(name)					\
+	((uint32_t)(((uintptr_t)(name) >> 3) * 2654435761U))
+
+/*
+ * Type information cache. Entries are never modified once they
+ * are visible in a bucket, so lookups need no locking; the mutex
+ * only serializes the addition of new entries.
+ */
+static struct structs_typeinfo *structs_typeinfo_buckets
+    [STRUCTS_TYPEINFO_BUCKETS];
+static pthread_mutex_t structs_typeinfo_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ * FUNCTION DECLARATIONS
+ ******************************************************************************/
+
+static struct structs_typeinfo *structs_typeinfo_build(const struct
+						       structs_type *type);
+static void structs_typeinfo_free(struct structs_typeinfo *info);
+static int structs_typeinfo_pod(const struct structs_type *type,
+				unsigned int nfields);
+static int structs_struct_packed(const struct structs_type *type,
+				 unsigned int nfields);
+static int structs_field_cmp(const void *v1, const void *v2);
+static const char *structs_field_name(const struct structs_type *type,
+				      unsigned int index);
+static uint32_t structs_field_hash(const char *name, size_t len);
+
+/*******************************************************************************
+ * FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+/*
+ * Get the cached information for a type, building it if necessary.
+ */
+const struct structs_typeinfo *structs_typeinfo_get(const struct structs_type
+						    *type)
+{
+	struct structs_typeinfo **const bucket =
+	    &structs_typeinfo_buckets[STRUCTS_TYPEINFO_HASH(type)];
+	struct structs_typeinfo *info;
+	struct structs_typeinfo *scan;
+	int r;
+
+	/* Look for an existing entry */
+	for (info = __atomic_load_n(bucket, __ATOMIC_ACQUIRE);
+	     info != NULL; info = info->next) {
+		if (info->type == type)
+			return (info);
+	}
+
+	/* Build a new entry outside the lock */
+	if ((info = structs_typeinfo_build(type)) == NULL)
+		return (NULL);
+
+	/* Add it, unless another thread beat us to it */
+	r = pthread_mutex_lock(&structs_typeinfo_mutex);
+	assert(r == 0);
+	for (scan = *bucket; scan != NULL; scan = scan->next) {
+		if (scan->type == type)
+			break;
+	}
+	if (scan == NULL) {
+		info->next = *bucket;
+		__atomic_store_n(bucket, info, __ATOMIC_RELEASE);
+	}
+	r = pthread_mutex_unlock(&structs_typeinfo_mutex);
+	assert(r == 0);
+
+	/* Done */
+	if (scan != NULL) {
+		structs_typeinfo_free(info);
+		return (scan);
+	}
+	return (info);
+}
+
+/*
+ * Build the information for a type.
+ */
+static struct structs_typeinfo *structs_typeinfo_build(const struct
+						       structs_type *type)
+{
+	struct structs_typeinfo *info;
+	unsigned int nfields = 0;
+	unsigned int max_seps = 0;
+	unsigned int hsize = 0;
+	unsigned int i;
+
+	/* Count fields and the separators in their names */
+	if (type->tclass == STRUCTS_TYPE_STRUCTURE
+	    || type->tclass == STRUCTS_TYPE_UNION) {
+		const char *fname;
+
+		for (; (fname = structs_field_name(type, nfields)) != NULL;
+		     nfields++) {
+			unsigned int seps = 0;
+
+			for (; *fname != '\0'; fname++) {
+				if (*fname == STRUCTS_SEPARATOR)
+					seps++;
+			}
+			if (seps > max_seps)
+				max_seps = seps;
+		}
+		for (hsize = 1; hsize < nfields * 2; hsize <<= 1) ;
+	}
+
+	/* Allocate entry with the field name hash tables at the end */
+	if ((info = calloc(1, sizeof(*info) + 2 * hsize * sizeof(int)))
+	    == NULL)
+		return (NULL);
+	info->type = type;
+	info->nfields = nfields;
+	info->max_seps = max_seps;
+	info->fmask = hsize - 1;
+	info->ftable = (int *)(info + 1);
+	info->ptable = info->ftable + hsize;
+	for (i = 0; i < 2 * hsize; i++)
+		info->ftable[i] = STRUCTS_FIELD_EMPTY;
+
+	/* Hash field names; with duplicates, the first field wins */
+	for (i = 0; i < nfields; i++) {
+		const char *const fname = structs_field_name(type, i);
+		uint32_t h = structs_field_hash(fname, strlen(fname));
+
+		for (h &= info->fmask; info->ftable[h] != STRUCTS_FIELD_EMPTY;
+		     h = (h + 1) & info->fmask) {
+			if (strcmp(structs_field_name(type,
+						      info->ftable[h]),
+				   fname) == 0)
+				break;
+		}
+		if (info->ftable[h] == STRUCTS_FIELD_EMPTY)
+			info->ftable[h] = i;
+	}
+
+	/* Hash field name pointers the same way */
+	for (i = 0; i < nfields; i++) {
+		const char *const fname = structs_field_name(type, i);
+		uint32_t h = STRUCTS_FIELD_PHASH(fname);
+
+		for (h &= info->fmask; info->ptable[h] != STRUCTS_FIELD_EMPTY;
+		     h = (h + 1) & info->fmask) {
+			if (structs_field_name(type, info->ptable[h]) == fname)
+				break;
+		}
+		if (info->ptable[h] == STRUCTS_FIELD_EMPTY)
+			info->ptable[h] = i;
+	}
+
+	/* Determine which methods just operate on memory */
+	info->pod = structs_typeinfo_pod(type, nfields);
+
+	/* Compile the execution plan; without one, we just recurse */
+	if (type->tclass == STRUCTS_TYPE_STRUCTURE
+	    && type->init == structs_struct_init)
+		info->plan = structs_plan_compile(type);
+
+	/* Done */
+	return (info);
+}
+
+/*
+ * Free a type information entry.
+ */
+static void structs_typeinfo_free(struct structs_typeinfo *info)
+{
+	structs_plan_destroy(&info->plan);
+	free(info);
+}
+
+/*
+ * Get the STRUCTS_POD_* flags for a type.
+ */
+int structs_pod_flags(const struct structs_type *type)
+{
+	const int errno_save = errno;
+	const struct structs_typeinfo *info;
+
+	if ((info = structs_typeinfo_get(type)) == NULL) {
+		errno = errno_save;
+		return (0);
+	}
+	return (info->pod);
+}
+
+/*
+ * Get the default instance of a type, creating it if necessary.
+ */
+const void *structs_default(const struct structs_type *type)
+{
+	const struct structs_allocator *prev;
+	struct structs_typeinfo *info;
+	void *expected = NULL;
+	void *dflt;
+
+	/* Get type information */
+	if ((info = (struct structs_typeinfo *)structs_typeinfo_get(type))
+	    == NULL)
+		return (NULL);
+
+	/* Already created? */
+	if ((dflt = __atomic_load_n(&info->dflt, __ATOMIC_ACQUIRE)) != NULL)
+		return (dflt);
+
+	/* Create a new one; it outlives any caller's allocator */
+	if ((dflt = calloc(1, type->size)) == NULL)
+		return (NULL);
+	prev = structs_set_thread_allocator(&structs_allocator_default);
+	if ((*type->init) (type, dflt) == -1) {
+		structs_set_thread_allocator(prev);
+		free(dflt);
+		return (NULL);
+	}
+
+	/* Install it, unless another thread beat us to it */
+	if (!__atomic_compare_exchange_n(&info->dflt, &expected, dflt, 0,
+					 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		(*type->uninit) (type, dflt);
+		free(dflt);
+		dflt = expected;
+	}
+	structs_set_thread_allocator(prev);
+	return (dflt);
+}
+
+/*
+ * Compute the STRUCTS_POD_* flags for a type. Flags for structure
+ * fields and array elements come from their own cached information.
+ */
+static int structs_typeinfo_pod(const struct structs_type *type,
+				unsigned int nfields)
+{
+	const struct structs_field *field;
+	const struct structs_type *etype;
+	int pod = 0;
+
+	switch (type->tclass) {
+	case STRUCTS_TYPE_STRUCTURE:
+		if (type->init == structs_struct_init)
+			pod |= STRUCTS_POD_INIT;
+		if (type->copy == structs_struct_copy)
+			pod |= STRUCTS_POD_COPY;
+		if (type->equal == structs_struct_equal
+		    && structs_struct_packed(type, nfields))
+			pod |= STRUCTS_POD_EQUAL;
+		if (type->uninit == structs_struct_free)
+			pod |= STRUCTS_POD_FREE;
+		for (field = type->args[0].v;
+		     pod != 0 && field->name != NULL; field++)
+			pod &= structs_pod_flags(field->type);
+		break;
+	case STRUCTS_TYPE_FIXEDARRAY:
+		etype = type->args[0].v;
+		if (type->size != etype->size * type->args[2].i)
+			break;
+		if (type->init == structs_fixedarray_init)
+			pod |= STRUCTS_POD_INIT;
+		if (type->copy == structs_fixedarray_copy)
+			pod |= STRUCTS_POD_COPY;
+		if (type->equal == structs_fixedarray_equal)
+			pod |= STRUCTS_POD_EQUAL;
+		if (type->uninit == structs_fixedarray_free)
+			pod |= STRUCTS_POD_FREE;
+		pod &= structs_pod_flags(etype);
+		break;
+	default:
+		if (type->init == structs_region_init)
+			pod |= STRUCTS_POD_INIT;
+		if (type->copy == structs_region_copy)
+			pod |= STRUCTS_POD_COPY;
+		if (type->equal == structs_region_equal)
+			pod |= STRUCTS_POD_EQUAL;
+		if (type->uninit == structs_nothing_free)
+			pod |= STRUCTS_POD_FREE;
+		break;
+	}
+
+	/* Initializing or copying must not need un-doing */
+	if ((pod & STRUCTS_POD_FREE) == 0)
+		pod &= ~(STRUCTS_POD_INIT | STRUCTS_POD_COPY);
+	return (pod);
+}
+
+/*
+ * Determine whether the fields of a structure exactly cover it,
+ * with no padding and no overlap.
+ */
+static int structs_struct_packed(const struct structs_type *type,
+				 unsigned int nfields)
+{
+	const struct structs_field *const fields = type->args[0].v;
+	const struct structs_field **sorted;
+	size_t end = 0;
+	unsigned int i;
+
+	/* Sort fields by offset */
+	if ((sorted = malloc(nfields * sizeof(*sorted) + 1)) == NULL)
+		return (0);
+	for (i = 0; i < nfields; i++)
+		sorted[i] = &fields[i];
+	qsort(sorted, nfields, sizeof(*sorted), structs_field_cmp);
+
+	/* Look for gaps */
+	for (i = 0; i < nfields && sorted[i]->offset == end; i++)
+		end += sorted[i]->size;
+	free(sorted);
+	return (i == nfields && end == type->size);
+}
+
+/*
+ * Compare structure fields by offset.
+ */
+static int structs_field_cmp(const void *v1, const void *v2)
+{
+	const struct structs_field *const f1
+	    = *((const struct structs_field *const *)v1);
+	const struct structs_field *const f2
+	    = *((const struct structs_field *const *)v2);
+
+	return ((f1->offset > f2->offset) - (f1->offset < f2->offset));
+}
+
+/*
+ * Find the field of a structure or union type whose name is
+ * exactly the first "len" characters of "name".
+ *
+ * Returns the field index, or -1 and sets errno to ENOENT.
+ */
+int structs_field_lookup(const struct structs_type *type,
+			 const char *name, size_t len)
+{
+	const struct structs_typeinfo *const info = structs_typeinfo_get(type);
+	const char *fname;
+	uint32_t h;
+	int i;
+
+	/* If we couldn't get the index, do it the slow way */
+	if (info == NULL) {
+		for (i = 0; (fname = structs_field_name(type, i)) != NULL; i++) {
+			if (strncmp(fname, name, len) == 0
+			    && fname[len] == '\0')
+				return (i);
+		}
+		errno = ENOENT;
+		return (-1);
+	}
+
+	/* Search hash table */
+	if (info->nfields == 0)
+		goto not_found;
+	h = structs_field_hash(name, len);
+	for (h &= info->fmask; (i = info->ftable[h]) != STRUCTS_FIELD_EMPTY;
+	     h = (h + 1) & info->fmask) {
+		fname = structs_field_name(type, i);
+		if (strncmp(fname, name, len) == 0 && fname[len] == '\0')
+			return (i);
+	}
+
+not_found:
+	errno = ENOENT;
+	return (-1);
+}
+
+/*
+ * Find the field of a structure or union type whose name is "name",
+ * trying the name pointer itself first.
+ *
+ * Returns the field index, or -1 and sets errno to ENOENT.
+ */
+int structs_field_index(const struct structs_type *type, const char *name)
+{
+	const struct structs_typeinfo *const info = structs_typeinfo_get(type);
+	uint32_t h;
+	int i;
+
+	/* Usually the name is one of the field names themselves */
+	if (info != NULL && info->nfields > 0) {
+		h = STRUCTS_FIELD_PHASH(name);
+		for (h &= info->fmask;
+		     (i = info->ptable[h]) != STRUCTS_FIELD_EMPTY;
+		     h = (h + 1) & info->fmask) {
+			if (structs_field_name(type, i) == name)
+				return (i);
+		}
+	}
+
+	/* Otherwise, compare names */
+	return (structs_field_lookup(type, name, strlen(name)));
+}
+
+/*
+ * Find the field of a structure or union type named by the first
+ * component(s) of "name". Because field names may contain the separator
+ * character, more than one field may match; the one that comes first
+ * in the type's field list is chosen, which is what a linear scan of
+ * the fields would find.
+ *
+ * Returns the field index and sets *nextp to point to the remainder
+ * of "name" after the field name and separator (or NULL if none),
+ * or returns -1 and sets errno to ENOENT if no field matches.
+ */
+int structs_field_find(const struct structs_type *type,
+		       const char *name, const char **nextp)
+{
+	const struct structs_typeinfo *const info = structs_typeinfo_get(type);
+	const unsigned int max_seps = (info != NULL) ? info->max_seps : ~0U;
+	const char *end = name;
+	size_t best_len = 0;
+	unsigned int seps;
+	int best = -1;
+	int i;
+
+	/* Try each run of components that could be a field name */
+	for (seps = 0;; seps++) {
+		if ((end = strchr(end, STRUCTS_SEPARATOR)) == NULL)
+			end = name + strlen(name);
+		if ((i = structs_field_lookup(type, name, end - name)) != -1
+		    && (best == -1 || i < best)) {
+			best = i;
+			best_len = end - name;
+		}
+		if (*end == '\0' || seps == max_seps)
+			break;
+		end++;
+	}
+
+	/* Found it? */
+	if (best == -1) {
+		errno = ENOENT;
+		return (-1);
+	}
+	*nextp = (name[best_len] != '\0') ? name + best_len + 1 : NULL;
+	return (best);
+}
+
+/*
+ * Get the name of a structure or union field by index.
+ *
+ * Returns NULL for the terminating entry.
+ */
+static const char *structs_field_name(const struct structs_type *type,
+				      unsigned int index)
+{
+	if (type->tclass == STRUCTS_TYPE_STRUCTURE)
+		return (((const struct structs_field *)type->args[0].v)
+			[index].name);
+	return (((const struct structs_ufield *)type->args[0].v)[index].name);
+}
+
+/*
+ * FNV-1a hash of a field name.
+ */
+static uint32_t structs_field_hash(const char *name, size_t len)
+{
+	uint32_t h = 2166136261U;
+
+	while (len-- > 0) {
+		h ^= (unsigned char)*name++;
+		h *= 16777619U;
+	}
+	return (h);
+}
+
+/*
+ * Free all cached type information.
+ */
+void structs_cleanup(void)
+{
+	const struct structs_allocator *prev;
+	struct structs_typeinfo *info;
+	int r;
+	int i;
+
+	/*
+	 * Free default instances first. Freeing them uses the cache,
+	 * which may even grow, so it must still be intact and unlocked.
+	 */
+	prev = structs_set_thread_allocator(&structs_allocator_default);
+	for (i = 0; i < STRUCTS_TYPEINFO_BUCKETS; i++) {
+		for (info = structs_typeinfo_buckets[i];
+		     info != NULL; info = info->next) {
+			if (info->dflt != NULL) {
+				(*info->type->uninit) (info->type, info->dflt);
+				free(info->dflt);
+				info->dflt = NULL;
+			}
+		}
+	}
+	structs_set_thread_allocator(prev);
+
+	/* Free entries */
+	r = pthread_mutex_lock(&structs_typeinfo_mutex);
+	assert(r == 0);
+	for (i = 0; i < STRUCTS_TYPEINFO_BUCKETS; i++) {
+		while ((info = structs_typeinfo_buckets[i]) != NULL) {
+			structs_typeinfo_buckets[i] = info->next;
+			structs_typeinfo_free(info);
+		}
+	}
+	r = pthread_mutex_unlock(&structs_typeinfo_mutex);
+	assert(r == 0);
+}
+
+/*******************************************************************************
+ * END OF FILE
+ ******************************************************************************/
@@ -22,10 +22,12 @@
 
 /* Module Includes */
 #include "structs.h"
+#include "structs_alloc.h"
 #include "structs_xml.h"
 #include "structs_type_array.h"
 #include "structs_type_struct.h"
 #include "structs_type_union.h"
+#include "structs_internal.h"
 
 /*******************************************************************************
  * MACROS/VARIABLES
@@ -145,7 +147,7 @@ int structs_xml_input(const struct structs_type *type,
 		logger = structs_null_logger;
 
 	/* Create context */
-	if ((ctx = calloc(1, sizeof(*ctx))) == NULL)
+	if ((ctx = structs_mem_calloc(1, sizeof(*ctx))) == NULL)
 		return (-1);
 	memset(ctx, 0, sizeof(*ctx));
 	ctx->attrp = attrp;
@@ -155,7 +157,8 @@ int structs_xml_input(const struct structs_type *type,
 	pthread_cleanup_push(structs_xml_input_cleanup, ctx);
 
 	/* Initialize attributes */
-	if (ctx->attrp != NULL && (*ctx->attrp = strdup("")) == NULL)
+	if (ctx->attrp != NULL && (*ctx->attrp = structs_mem_strdup(""))
+	    == NULL)
 		goto done;
 
 	/* Initialize data object if desired */
@@ -171,7 +174,7 @@ int structs_xml_input(const struct structs_type *type,
 	}
 
 	/* Allocate info structure */
-	if ((ctx->info = calloc(1, sizeof(*ctx->info))) == NULL) {
+	if ((ctx->info = structs_mem_calloc(1, sizeof(*ctx->info))) == NULL) {
 		esave = errno;
 		(*logger) (LOG_ERR, "%s: %s", "malloc", strerror(errno));
 		errno = esave;
@@ -266,7 +269,7 @@ static void structs_xml_input_cleanup(void *arg)
 	if (ctx->info != NULL) {
 		while (ctx->info->depth >= 0)
 			structs_xml_pop(ctx->info);
-		free(ctx->info);
+		structs_mem_free(ctx->info);
 	}
 
 	/* Free parser */
@@ -276,7 +279,7 @@ static void structs_xml_input_cleanup(void *arg)
 	/* If error, free returned attributes and initialized data */
 	if (ctx->rtn != 0) {
 		if (ctx->attrp != NULL && *ctx->attrp != NULL) {
-			free(*ctx->attrp);
+			structs_mem_free(*ctx->attrp);
 			*ctx->attrp = NULL;
 		}
 		if (ctx->data_init)
@@ -284,7 +287,7 @@ static void structs_xml_input_cleanup(void *arg)
 	}
 
 	/* Free context */
-	free(ctx);
+	structs_mem_free(ctx);
 	errno = esave;
 }
 
@@ -335,7 +338,7 @@ static void structs_xml_input_start(void *userData,
 			void *mem;
 
 			if ((mem =
-			     realloc(*info->attrp,
+			     structs_mem_realloc(*info->attrp,
 				     info->attr_len + strlen(name) + 1 +
 				     strlen(value) + 1 + 1)) == NULL) {
 				info->error = errno;
@@ -391,25 +394,10 @@ static void structs_xml_input_start(void *userData,
 	if (strchr(name, STRUCTS_SEPARATOR) != NULL) {
 		switch (type->tclass) {
 		case STRUCTS_TYPE_STRUCTURE:
-		{
-			const struct structs_field *field;
-
-			for (field = frame->type->args[0].v;
-			     field->name != NULL; field++) {
-				if (strcmp(field->name, name) == 0)
-					goto not_combined;
-			}
-		}
 		case STRUCTS_TYPE_UNION:
-		{
-			const struct structs_ufield *field;
-
-			for (field = frame->type->args[0].v;
-			     field->name != NULL; field++) {
-				if (strcmp(field->name, name) == 0)
-					goto not_combined;
-			}
-		}
+			if (structs_field_lookup(type, name, strlen(name)) != -1)
+				goto not_combined;
+			break;
 		default:
 			break;
 		}
@@ -433,7 +421,7 @@ static void structs_xml_input_start(void *userData,
 	}
 
 	/* Copy XML tag so we can parse it */
-	if ((namebuf = strdup(name)) == NULL) {
+	if ((namebuf = structs_mem_strdup(name)) == NULL) {
 		info->error = errno;
 		return;
 	}
@@ -448,16 +436,16 @@ static void structs_xml_input_start(void *userData,
 		data = frame->data;
 		structs_xml_input_nest(info, s, &type, &data);
 		if (info->error != 0) {
-			free(namebuf);
+			structs_mem_free(namebuf);
 			return;
 		}
 		structs_xml_input_prep(info, type, data, !first);
 		if (info->error != 0) {
-			free(namebuf);
+			structs_mem_free(namebuf);
 			return;
 		}
 	}
-	free(namebuf);
+	structs_mem_free(namebuf);
 	return;
 
 not_combined:
@@ -493,8 +481,9 @@ static void structs_xml_input_nest(struct xml_input_info *info,
 		type = frame->type;
 		data = frame->data;
 		if ((type =
-		     structs_find(type, name, (const void **)&data,
-				  1)) == NULL) {
+		     structs_find_flags(type, name, (const void **)&data,
+				  STRUCTS_FIND_UNION
+				  | STRUCTS_FIND_UNSHARE)) == NULL) {
 			if (errno == ENOENT) {
 				sev = (info->flags & STRUCTS_XML_LOOSE)
 					== 0 ? LOG_ERR : LOG_WARNING;
@@ -531,7 +520,6 @@ static void structs_xml_input_nest(struct xml_input_info *info,
 			frame->type->args[0].v;
 		const char *elem_name = frame->type->args[1].s;
 		struct structs_array *const ary = frame->data;
-		void *mem;
 
 		/* Check tag name */
 		if (strcmp(name, elem_name) != 0) {
@@ -547,10 +535,8 @@ static void structs_xml_input_nest(struct xml_input_info *info,
 		}
 
 		/* Expand the array by one */
-		if ((mem =
-		     realloc(ary->elems,
-			     (ary->length + 1) * etype->size)) ==
-		    NULL) {
+		if (structs_array_grow(frame->type, ary,
+				       ary->length + 1) == -1) {
 			info->error = errno;
 			(*info->logger) (LOG_ERR, "line %d:%d: %s: %s",
 					 XML_GetCurrentLineNumber
@@ -560,7 +546,6 @@ static void structs_xml_input_nest(struct xml_input_info *info,
 					 strerror(errno));
 			return;
 		}
-		ary->elems = mem;
 
 		/* Initialize the new element */
 		memset((char *)ary->elems + (ary->length * etype->size),
@@ -681,7 +666,7 @@ static void structs_xml_input_prep(struct xml_input_info *info,
 		void *mem;
 
 		/* Get temporary region for newly initialized array */
-		if ((mem = calloc(1, type->size)) == NULL) {
+		if ((mem = structs_mem_calloc(1, type->size)) == NULL) {
 			info->error = errno;
 			(*info->logger) (LOG_ERR, "line %d:%d: %s: %s",
 					 XML_GetCurrentLineNumber
@@ -703,14 +688,14 @@ static void structs_xml_input_prep(struct xml_input_info *info,
 					 (info->p),
 					 "error initializing new array",
 					 strerror(errno));
-			free(mem);
+			structs_mem_free(mem);
 			return;
 		}
 
 		/* Replace existing array with fresh one */
 		(*type->uninit) (type, data);
 		memcpy(data, mem, type->size);
-		free(mem);
+		structs_mem_free(mem);
 
 		/* Remember that we're on the first element */
 		info->stack[info->depth + 1].index = 0;
@@ -753,7 +738,8 @@ static void structs_xml_input_chardata(void *userData,
 		return;
 
 	/* Expand buffer and append character data */
-	if ((mem = realloc(frame->s, frame->s_len + len + 1)) == NULL) {
+	if ((mem = structs_mem_realloc(frame->s, frame->s_len + len + 1))
+	    == NULL) {
 		info->error = errno;
 		(*info->logger) (LOG_ERR, "%s: %s", "realloc", strerror(errno));
 		return;
@@ -838,8 +824,8 @@ static void structs_xml_unnest(struct xml_input_info *info,
 		}
 
 		/* Point at the field instead of the union */
+		data = structs_union_body(type, data);
 		type = field->type;
-		data = ((const struct structs_union *)data)->un;
 
 		/* FALLTHROUGH */
 	}
@@ -890,7 +876,7 @@ static void structs_xml_pop(struct xml_input_info *info)
 
 	assert(info->depth >= 0);
 	if (frame->s != NULL)
-		free(frame->s);
+		structs_mem_free(frame->s);
 	memset(frame, 0, sizeof(*frame));
 	info->depth--;
 }
@@ -976,19 +962,11 @@ static int structs_xml_output_sub(const struct structs_type *type,
 	/* If doing abbreviated version, compare with default value */
 	if (depth > 0
 	    && (flags & (STRUCTS_XML_FULL | STRUCTS_XML_SHOWONE)) == 0) {
-		void *init_value;
-		int equal;
+		const void *init_value;
 
-		if ((init_value = calloc(1, type->size)) == NULL)
-			return (-1);
-		if ((*type->init) (type, init_value) == -1) {
-			free(init_value);
+		if ((init_value = structs_default(type)) == NULL)
 			return (-1);
-		}
-		equal = (*type->equal) (type, data, init_value);
-		(*type->uninit) (type, init_value);
-		free(init_value);
-		if (equal)
+		if ((*type->equal) (type, data, init_value))
 			return (0);
 	}
 
@@ -999,23 +977,19 @@ static int structs_xml_output_sub(const struct structs_type *type,
 	switch (type->tclass) {
 	case STRUCTS_TYPE_UNION:
 	{
-		const struct structs_union *const un = data;
 		const struct structs_ufield *const fields =
 			type->args[0].v;
 		const struct structs_ufield *field;
 		char *sposn;
 
 		/* Find field */
-		for (field = fields; field->name != NULL
-			     && strcmp(un->field_name, field->name) != 0;
-		     field++) ;
-		if (field->name == NULL)
-			assert(0);
+		if ((field = structs_union_field(type, data)) == NULL)
+			return (-1);
 
 		/* Generate new position tag */
-		asprintf(&sposn, "%s%s%s", posn,
-			 *posn != '\0' ? separator_string : "",
-			 field->name);
+		structs_mem_asprintf(&sposn, "%s%s%s", posn,
+				     *posn != '\0' ? separator_string : "",
+				     field->name);
 		if (sposn == NULL)
 			return (-1);
 		pthread_cleanup_push(structs_xml_output_cleanup, sposn);
@@ -1028,11 +1002,12 @@ static int structs_xml_output_sub(const struct structs_type *type,
 		 * If the union field is not the default choice for this union,
 		 * then it must always be shown so the recipient knows that.
 		 */
-		if (strcmp(un->field_name, fields[0].name) != 0)
+		if (field != fields)
 			flags |= STRUCTS_XML_SHOWONE;
 
 		/* Output chosen union field */
-		r = structs_xml_output_sub(field->type, un->un,
+		r = structs_xml_output_sub(field->type,
+					   structs_union_body(type, data),
 					   field->name, NULL, fp,
 					   elems, sposn, flags,
 					   depth + 1);
@@ -1064,9 +1039,10 @@ static int structs_xml_output_sub(const struct structs_type *type,
 			char *sposn;
 
 			/* Generate new position tag */
-			asprintf(&sposn, "%s%s%s", posn,
-				 *posn != '\0' ? separator_string : "",
-				 field->name);
+			structs_mem_asprintf(&sposn, "%s%s%s", posn,
+					     *posn != '\0' ?
+					     separator_string : "",
+					     field->name);
 			if (sposn == NULL)
 				return (-1);
 			pthread_cleanup_push
@@ -1114,10 +1090,11 @@ static int structs_xml_output_sub(const struct structs_type *type,
 			char *sposn;
 
 			/* Generate new position tag */
-			asprintf(&sposn, "%s%s%u",
-				 posn,
-				 *posn != '\0' ? separator_string : "",
-				 i);
+			structs_mem_asprintf(&sposn, "%s%s%u",
+					     posn,
+					     *posn != '\0' ?
+					     separator_string : "",
+					     i);
 			if (sposn == NULL)
 				return (-1);
 			pthread_cleanup_push
@@ -1165,10 +1142,11 @@ static int structs_xml_output_sub(const struct structs_type *type,
 			char *sposn;
 
 			/* Generate new position tag */
-			asprintf(&sposn, "%s%s%u",
-				 posn,
-				 *posn != '\0' ? separator_string : "",
-				 i);
+			structs_mem_asprintf(&sposn, "%s%s%u",
+					     posn,
+					     *posn != '\0' ?
+					     separator_string : "",
+					     i);
 			if (sposn == NULL)
 				return (-1);
 			pthread_cleanup_push
@@ -1197,14 +1175,17 @@ static int structs_xml_output_sub(const struct structs_type *type,
 
 	case STRUCTS_TYPE_PRIMITIVE:
 	{
+		char buf[STRUCTS_ASCII_BUFSIZE];
 		char *ascii;
 
 		/* Get ascii string */
-		if ((ascii = (*type->ascify) (type, data)) == NULL)
+		if ((ascii = structs_ascify_buf(type, data, buf,
+						sizeof(buf))) == NULL)
 			return (-1);
 
 		/* Push cleanup hook to handle cancellation */
-		pthread_cleanup_push(structs_xml_output_cleanup, ascii);
+		pthread_cleanup_push(structs_xml_output_cleanup,
+				     ascii != buf ? ascii : NULL);
 
 		/* Output element */
 		structs_xml_output_openelem(fp, depth, tag, attrs);
@@ -1227,7 +1208,7 @@ static int structs_xml_output_sub(const struct structs_type *type,
  */
 static void structs_xml_output_cleanup(void *arg)
 {
-	free(arg);
+	structs_mem_free(arg);
 }
 
 /*
@@ -1310,17 +1291,17 @@ static void structs_xml_encode(FILE * fp, const char *s)
 
 static void *structs_xml_malloc(size_t size)
 {
-	return (calloc(1, size));
+	return (structs_mem_calloc(1, size));
 }
 
 static void *structs_xml_realloc(void *ptr, size_t size)
 {
-	return (realloc(ptr, size));
+	return (structs_mem_realloc(ptr, size));
 }
 
 static void structs_xml_free(void *ptr)
 {
-	free(ptr);
+	structs_mem_free(ptr);
 }
 
 /*******************************************************************************